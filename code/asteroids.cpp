@@ -7,38 +7,93 @@
 // SOUND
 // =================================================================================================
 
-internal SoundStream *PlaySound(GameState *game_state,
-                                GameSoundOutput *game_sound,
-                                SoundID sound_id,
-                                float32 volume = 0.5f,
-                                bool is_loop = false)
+// NOTE(mara): SoundStreams live in a small ring in the TransientState, and the GameState only keeps
+// their ids, so copying the GameState somewhere else never leaves it pointing at somebody else's
+// streams. A slot is reused once the ring comes back around to it, unless the platform is still
+// playing it, it's a loop nobody stopped, or it's waiting in this frame's list.
+internal bool32 IsSoundStreamInUse(GameSoundOutput *game_sound, SoundStream *sound_stream)
 {
-    if (!game_sound->first_free_playing_sound)
+    if (sound_stream->is_initialized)
     {
-        game_sound->first_free_playing_sound = PushStruct(&game_state->sound_arena, SoundStream);
-        game_sound->first_free_playing_sound->next = 0;
+        return !sound_stream->is_finished;
+    }
+    if (sound_stream->id && sound_stream->is_loop && !sound_stream->force_stop)
+    {
+        return true;
+    }
+    for (SoundStream *queued = game_sound->first_playing_sound; queued; queued = queued->next)
+    {
+        if (queued == sound_stream)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns 0, and the sound is dropped, when every slot is in use.
+internal uint32 PlaySound(GameState *game_state,
+                          TransientState *transient_state,
+                          GameSoundOutput *game_sound,
+                          SoundID sound_id,
+                          float32 volume = 0.5f,
+                          bool is_loop = false)
+{
+    SoundStream *sound_stream = 0;
+    for (int32 i = 0; i < MAX_SOUND_STREAMS; ++i)
+    {
+        SoundStream *candidate = &transient_state->sound_streams[transient_state->next_sound_stream_index];
+        transient_state->next_sound_stream_index = ((transient_state->next_sound_stream_index + 1) %
+                                                    MAX_SOUND_STREAMS);
+
+        if (!IsSoundStreamInUse(game_sound, candidate))
+        {
+            sound_stream = candidate;
+            break;
+        }
+    }
+
+    if (!sound_stream)
+    {
+        return 0;
+    }
+
+    if (++game_state->last_sound_stream_id == 0)
+    {
+        ++game_state->last_sound_stream_id;
     }
 
-    SoundStream *sound_stream = game_sound->first_free_playing_sound;
-    game_sound->first_free_playing_sound = sound_stream->next;
+    WAVESoundData *sound = &game_state->sounds[sound_id];
 
+    *sound_stream = {};
+    sound_stream->id = game_state->last_sound_stream_id;
     sound_stream->volume = volume;
     sound_stream->loaded_sound_id = sound_id;
     sound_stream->is_loop = is_loop;
     sound_stream->force_stop = false;
 
-    sound_stream->buffer_size = game_state->sounds[sound_id].buffer_size;
-    sound_stream->samples = game_state->sounds[sound_id].samples;
+    sound_stream->buffer_size = sound->buffer_size;
+    sound_stream->samples = (int16 *)GetStateMemory(game_state, sound->samples_offset);
 
     sound_stream->next = game_sound->first_playing_sound;
     game_sound->first_playing_sound = sound_stream;
 
-    return sound_stream;
+    return sound_stream->id;
 }
 
-internal void StopSound(SoundStream *stream)
+internal void StopSound(TransientState *transient_state, uint32 id)
 {
-    stream->force_stop = true;
+    if (id)
+    {
+        for (int32 i = 0; i < MAX_SOUND_STREAMS; ++i)
+        {
+            SoundStream *sound_stream = &transient_state->sound_streams[i];
+            if (sound_stream->id == id)
+            {
+                sound_stream->force_stop = true;
+            }
+        }
+    }
 }
 
 // =================================================================================================
@@ -64,92 +119,473 @@ internal void DrawPixel(GameOffscreenBuffer *buffer,
     *pixel = color;
 }
 
-// Bresenham's line algorithm.
-internal void DrawLine(GameOffscreenBuffer *buffer,
-                       float32 x0, float32 y0,
-                       float32 x1, float32 y1,
-                       float32 r, float32 g, float32 b)
+// NOTE(mara): Only pays for the divides when the coordinate is actually off the buffer.
+inline int32 WrapCoordinate(int32 value, int32 size)
 {
-    bool32 is_steep = (Abs(y1 - y0) > Abs(x1 - x0));
+    return ((uint32)value < (uint32)size) ? value : WrapIndex(value, size);
+}
 
-    if (is_steep)
+// Splits [min, max) on a torus of the given size into at most two ranges inside [0, size).
+internal int32 SplitWrappedRange(int32 min, int32 max, int32 size, int32 ranges[2][2])
+{
+    if (min >= max)
     {
-        Swap(float32, x0, y0);
-        Swap(float32, x1, y1);
+        return 0;
+    }
+    if (max - min >= size)
+    {
+        ranges[0][0] = 0;
+        ranges[0][1] = size;
+        return 1;
     }
 
-    // Flip values around if the start is greater than the end.
-    if (x0 > x1)
+    int32 start = WrapCoordinate(min, size);
+    int32 end = start + (max - min);
+    if (end <= size)
     {
-        Swap(float32, x0, x1);
-        Swap(float32, y0, y1);
+        ranges[0][0] = start;
+        ranges[0][1] = end;
+        return 1;
     }
 
-    float32 dx = x1 - x0;
-    float32 dy = Abs(y1 - y0);
+    ranges[0][0] = start;
+    ranges[0][1] = size;
+    ranges[1][0] = 0;
+    ranges[1][1] = end - size;
+    return 2;
+}
+
+inline GameRect GetBufferRect(GameOffscreenBuffer *buffer)
+{
+    GameRect result = { 0, 0, buffer->width, buffer->height };
+    return result;
+}
+
+inline GameRect IntersectRects(GameRect *a, GameRect *b)
+{
+    GameRect result;
+    result.min_x = MaxInt32(a->min_x, b->min_x);
+    result.min_y = MaxInt32(a->min_y, b->min_y);
+    result.max_x = MinInt32(a->max_x, b->max_x);
+    result.max_y = MinInt32(a->max_y, b->max_y);
+    return result;
+}
 
-    float32 error = dx / 2.0f;
-    int32 y_step = (y0 < y1) ? 1 : -1;
-    int32 y = RoundFloat32ToInt32(y0);
+inline bool32 IsRectEmpty(GameRect *rect)
+{
+    return (rect->min_x >= rect->max_x || rect->min_y >= rect->max_y);
+}
 
-    int32 start_x = RoundFloat32ToInt32(x0);
-    int32 end_x = RoundFloat32ToInt32(x1);
+// NOTE(mara): Every command reports the rectangle it may write to when it's recorded (already
+// clipped to the buffer), so GameRender knows what to erase next frame and the platform what to
+// upload.
+internal void MarkDirtyRectangle(GameOffscreenBuffer *buffer,
+                                 int32 min_x, int32 min_y, int32 max_x, int32 max_y)
+{
+    GameDirtyRects *dirty = &buffer->dirty;
+    if (dirty->is_everything || min_x >= max_x || min_y >= max_y)
+    {
+        return;
+    }
 
-    uint32 color = MakeColor(r, g, b);
+    // Things are mostly drawn a piece at a time (the edges of an asteroid, the letters of a string),
+    // so a rectangle touching the one before it is folded into it.
+    if (dirty->count > 0)
+    {
+        GameRect *last = &dirty->rects[dirty->count - 1];
+        if (min_x <= last->max_x && max_x >= last->min_x &&
+            min_y <= last->max_y && max_y >= last->min_y)
+        {
+            last->min_x = MinInt32(last->min_x, min_x);
+            last->min_y = MinInt32(last->min_y, min_y);
+            last->max_x = MaxInt32(last->max_x, max_x);
+            last->max_y = MaxInt32(last->max_y, max_y);
+            return;
+        }
+    }
 
-    for (int32 x = start_x; x <= end_x; ++x)
+    if (dirty->count < MAX_DIRTY_RECTS)
+    {
+        dirty->rects[dirty->count++] = { min_x, min_y, max_x, max_y };
+    }
+    else
     {
-        int32 final_x = is_steep ? y : x;
-        int32 final_y = is_steep ? x : y;
-        WrapInt32PointAroundBuffer(buffer, &final_x, &final_y);
+        dirty->is_everything = true;
+    }
+}
 
-        DrawPixel(buffer, final_x, final_y, color);
+// Same, for a rectangle that may hang off any edge of the torus: it's marked in up to four pieces.
+internal void MarkDirtyWrappedRectangle(GameOffscreenBuffer *buffer,
+                                        int32 min_x, int32 min_y, int32 max_x, int32 max_y)
+{
+    int32 x_ranges[2][2];
+    int32 y_ranges[2][2];
+    int32 x_range_count = SplitWrappedRange(min_x, max_x, buffer->width, x_ranges);
+    int32 y_range_count = SplitWrappedRange(min_y, max_y, buffer->height, y_ranges);
 
-        error -= dy;
-        if (error < 0)
+    for (int32 y = 0; y < y_range_count; ++y)
+    {
+        for (int32 x = 0; x < x_range_count; ++x)
         {
-            y += y_step;
-            error += dx;
+            MarkDirtyRectangle(buffer, x_ranges[x][0], y_ranges[y][0], x_ranges[x][1], y_ranges[y][1]);
         }
     }
 }
 
-internal void DrawPoints(GameOffscreenBuffer *buffer,
-                         Vector2 *points, int32 array_length,
-                         float32 r, float32 g, float32 b,
-                         float32 x_offset = 0.0f, float32 y_offset = 0.0f)
+// =================================================================================================
+// RASTERIZERS
+// =================================================================================================
+
+// NOTE(mara): These are the only functions that write pixels. Each one only writes inside clip
+// (which is always inside the buffer), and which pixels it writes never depends on the clip. So a
+// command drawn once with the whole buffer as its clip comes out exactly the same as one drawn tile
+// by tile.
+
+#define LINE_SUBPIXEL_BITS 8
+
+inline int32 SnapToLineSubpixels(float32 value)
 {
-    for (int i = 0; i < array_length; ++i)
+    return RoundFloat32ToInt32(value * (float32)(1 << LINE_SUBPIXEL_BITS));
+}
+
+// How many pixels along a line it takes until it has made the given number of minor steps, given
+// where its error term starts. Lines that never step (slope 0) never get there.
+inline int64 GetLinePixelsToMinorSteps(int32 minor_steps, uint32 error, uint32 slope)
+{
+    int64 result = 0;
+    if (minor_steps > 0)
     {
-        int32 next_i = (i + 1) % array_length;
-        DrawLine(buffer,
-                 points[i].x      + x_offset, points[i].y      + y_offset,
-                 points[next_i].x + x_offset, points[next_i].y + y_offset,
-                 r, g, b);
+        result = ((int64)1 << 62);
+        if (slope > 0)
+        {
+            uint64 distance = ((uint64)minor_steps << 32) - error;
+            result = (int64)((distance + slope - 1) / slope);
+        }
     }
+    return result;
 }
 
-// Jesko's midpoint circle algorithm.
-internal void DrawCircle(GameOffscreenBuffer *buffer,
-                         float32 real_x, float32 real_y, float32 real_radius,
-                         float32 r, float32 g, float32 b)
+// Bresenham's line algorithm, on a torus.
+// NOTE(mara): The endpoints are in 1/256ths of a pixel and may lie anywhere; the line wraps around
+// the buffer edges. Rather than wrapping every pixel, the line is cut where it crosses an edge (at
+// most four pieces for a line shorter than the screen). Each piece lies entirely inside the buffer,
+// so it's walked with a pointer and no bounds checks or branches.
+// The error term is the fractional part of the minor coordinate in 1/2^32ths of a pixel, so
+// stepping it is a plain add and the carry out of it says when to take a minor step. Unlike the
+// usual "subtract, and add back when it goes negative" error, nothing in the loop waits on the
+// previous pixel's decision, and where a line is after n pixels is just a multiply. That's also
+// what clips a piece: the first and last pixel inside the clip come straight out of the error term.
+// NOTE(mara): In cache a line costs less than half what the old per-pixel DrawLine did (see
+// asteroids_bench), and most of that is per line now: the setup, and the end of the loop, which
+// can't be predicted for lines of every length. On a 1366x768 buffer steep lines miss the cache on
+// nearly every store, and the old version's float work per pixel hid those misses about as well,
+// so it's only a little ahead there. Neither a fast path for lines inside the clip nor an unrolled
+// loop moved either number.
+internal void RasterizeLine(GameOffscreenBuffer *buffer, GameRect *clip,
+                            int32 x0, int32 y0,
+                            int32 x1, int32 y1,
+                            uint32 color)
 {
-    uint32 color = MakeColor(r, g, b);
+    // NOTE(mara): The axes are picked by indexing rather than branching: lines come in every
+    // direction, so a branch on the direction would be mispredicted half the time.
+    int32 points[2][2] =
+    {
+        { x0, y0 },
+        { x1, y1 },
+    };
+
+    int32 delta_x = points[1][0] - points[0][0];
+    int32 delta_y = points[1][1] - points[0][1];
+    int32 major_axis = (AbsInt32(delta_y) > AbsInt32(delta_x)); // 0 = x, 1 = y.
+    int32 minor_axis = major_axis ^ 1;
+
+    // Walk from the lower end of the major axis.
+    int32 first = (points[0][major_axis] > points[1][major_axis]);
+    int32 last = first ^ 1;
+    int32 start_major = points[first][major_axis];
+    int32 start_minor = points[first][minor_axis];
+    int32 minor_delta = points[last][minor_axis] - start_minor;
+
+    uint32 dx = (uint32)(points[last][major_axis] - start_major);
+    uint32 dy = (uint32)AbsInt32(minor_delta);
+    int32 minor_direction = (minor_delta >> 31) | 1;
+
+    uint32 slope = 0;
+    if (dx > 0)
+    {
+        uint64 exact_slope = ((uint64)dy << 32) / dx;
+        slope = (exact_slope > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32)exact_slope;
+    }
 
-    int32 pos_x = RoundFloat32ToInt32(real_x);
-    int32 pos_y = RoundFloat32ToInt32(real_y);
+    // Start half a pixel in (less one ulp), so the minor coordinate rounds to the nearest pixel and
+    // exact ties stay put the way Bresenham's do.
+    uint32 error = 0x7FFFFFFF;
 
-    int32 radius = RoundFloat32ToInt32(real_radius);
+    int32 sizes[2] = { buffer->width, buffer->height };
+    int64 strides[2] = { buffer->bytes_per_pixel, buffer->pitch };
+    int32 major_size = sizes[major_axis];
+    int32 minor_size = sizes[minor_axis];
+    int64 major_stride = strides[major_axis];
+    int64 minor_stride = strides[minor_axis] * minor_direction;
+
+    int32 clip_min[2] = { clip->min_x, clip->min_y };
+    int32 clip_max[2] = { clip->max_x, clip->max_y };
+
+    int32 half_pixel = 1 << (LINE_SUBPIXEL_BITS - 1);
+    int32 first_major = (start_major + half_pixel) >> LINE_SUBPIXEL_BITS;
+    int32 remaining = ((points[last][major_axis] + half_pixel) >> LINE_SUBPIXEL_BITS) - first_major + 1;
+    int32 major = WrapCoordinate(first_major, major_size);
+    int32 minor = WrapCoordinate((start_minor + half_pixel) >> LINE_SUBPIXEL_BITS, minor_size);
+
+    // More minor steps than the line can possibly take, to tell whether it could reach an edge.
+    int32 minor_extent = (int32)(dy >> LINE_SUBPIXEL_BITS) + 2;
+
+    while (remaining > 0)
+    {
+        // Clip the piece at whichever edge comes first.
+        int32 count = major_size - major;
+        if (count > remaining)
+        {
+            count = remaining;
+        }
+        int32 minor_steps_to_edge = (minor_direction > 0) ? (minor_size - minor) : (minor + 1);
+        if (slope > 0 && minor_steps_to_edge <= minor_extent)
+        {
+            int64 pixels_to_edge = GetLinePixelsToMinorSteps(minor_steps_to_edge, error, slope);
+            if (pixels_to_edge < (int64)count)
+            {
+                count = (int32)pixels_to_edge;
+            }
+        }
+
+        // The piece ends count - 1 pixels along, however many minor steps that took.
+        int32 last_minor = minor + (int32)(((uint64)error + (uint64)(count - 1) * slope) >> 32) * minor_direction;
+        int32 piece_min[2];
+        int32 piece_max[2];
+        piece_min[major_axis] = major;
+        piece_max[major_axis] = major + count;
+        piece_min[minor_axis] = MinInt32(minor, last_minor);
+        piece_max[minor_axis] = MaxInt32(minor, last_minor) + 1;
+
+        // Then cut it down to the pixels inside the clip, unless it's all in there anyway.
+        int64 begin = 0;
+        int64 end = count;
+        if (piece_min[0] < clip_min[0] || piece_min[1] < clip_min[1] ||
+            piece_max[0] > clip_max[0] || piece_max[1] > clip_max[1])
+        {
+            begin = MaxInt32(0, clip_min[major_axis] - major);
+            end = MinInt32(count, clip_max[major_axis] - major);
+
+            // Minor steps taken when the piece enters the clip and when it leaves it again.
+            int32 enter_steps = clip_min[minor_axis] - minor;
+            int32 leave_steps = clip_max[minor_axis] - minor;
+            if (minor_direction < 0)
+            {
+                enter_steps = minor - clip_max[minor_axis] + 1;
+                leave_steps = minor - clip_min[minor_axis] + 1;
+            }
+
+            int64 enter = GetLinePixelsToMinorSteps(enter_steps, error, slope);
+            int64 leave = GetLinePixelsToMinorSteps(leave_steps, error, slope);
+            if (enter > begin)
+            {
+                begin = enter;
+            }
+            if (leave < end)
+            {
+                end = leave;
+            }
+        }
+
+        if (begin < end)
+        {
+            uint64 begin_position = (uint64)error + (uint64)begin * slope;
+            int32 begin_minor = minor + (int32)(begin_position >> 32) * minor_direction;
+            uint8 *pixel = ((uint8 *)buffer->memory +
+                            (major + begin) * major_stride +
+                            begin_minor * strides[minor_axis]);
+
+            uint32 piece_error = (uint32)begin_position;
+            for (int64 i = end - begin; i > 0; --i)
+            {
+                *(uint32 *)pixel = color;
+
+                uint32 next_error = piece_error + slope;
+                int64 step_mask = -(int64)(next_error < piece_error); // All ones when the add carried.
+                pixel += major_stride + (minor_stride & step_mask);
+                piece_error = next_error;
+            }
+        }
+
+        remaining -= count;
+        if (remaining > 0)
+        {
+            // Step onto the next piece, which starts across whichever edge this one stopped at.
+            uint64 position = (uint64)error + (uint64)count * slope;
+            error = (uint32)position;
+
+            major += count;
+            if (major >= major_size)
+            {
+                major -= major_size;
+            }
+            minor += (int32)(position >> 32) * minor_direction;
+            if (minor < 0)
+            {
+                minor += minor_size;
+            }
+            else if (minor >= minor_size)
+            {
+                minor -= minor_size;
+            }
+        }
+    }
+}
+
+// NOTE(mara): Blends color into two pixels at once, 16 bits a channel: pixel0 gets 256 - coverage
+// of it, pixel1 gets coverage (both out of 256). Either pointer may be 0 when that pixel is clipped;
+// the other one comes out exactly as it would have with both there.
+inline void BlendSmoothLinePixels(uint32 *pixel0, uint32 *pixel1, __m128i color, int32 coverage)
+{
+    __m128i weights = _mm_unpacklo_epi64(_mm_set1_epi16((int16)(256 - coverage)),
+                                         _mm_set1_epi16((int16)coverage));
+    __m128i inverse_weights = _mm_sub_epi16(_mm_set1_epi16(256), weights);
+
+    __m128i dest = _mm_unpacklo_epi32(_mm_cvtsi32_si128(pixel0 ? (int32)*pixel0 : 0),
+                                      _mm_cvtsi32_si128(pixel1 ? (int32)*pixel1 : 0));
+    dest = _mm_unpacklo_epi8(dest, _mm_setzero_si128());
 
+    // dest * (256 - w) + color * w never goes over 255 * 256, so it fits in 16 unsigned bits.
+    __m128i blended = _mm_add_epi16(_mm_mullo_epi16(dest, inverse_weights), _mm_mullo_epi16(color, weights));
+    blended = _mm_srli_epi16(blended, 8);
+    blended = _mm_packus_epi16(blended, blended);
+
+    if (pixel0)
+    {
+        *pixel0 = (uint32)_mm_cvtsi128_si32(blended);
+    }
+    if (pixel1)
+    {
+        *pixel1 = (uint32)_mm_cvtsi128_si32(_mm_srli_si128(blended, 4));
+    }
+}
+
+// Xiaolin Wu's anti-aliased lines, on a torus.
+// NOTE(mara): Every column a line crosses along its major axis (whose centre lies between the
+// endpoints) gets the two pixels on either side of where the line passes through the centre, split
+// by how close each one is. The minor coordinate is in 1/65536ths of a pixel and only ever has the
+// slope added to it, so each pixel's coverage depends on where it is along the line and nothing
+// else; the clip just decides which of them get written, and tiles still come out the same.
+// Unlike RasterizeLine, every column is wrapped on its own: smooth lines are opt-in, and what they
+// cost is mostly the blending anyway.
+internal void RasterizeSmoothLine(GameOffscreenBuffer *buffer, GameRect *clip,
+                                  int32 x0, int32 y0,
+                                  int32 x1, int32 y1,
+                                  uint32 color)
+{
+    int32 points[2][2] =
+    {
+        { x0, y0 },
+        { x1, y1 },
+    };
+
+    int32 delta_x = points[1][0] - points[0][0];
+    int32 delta_y = points[1][1] - points[0][1];
+    int32 major_axis = (AbsInt32(delta_y) > AbsInt32(delta_x)); // 0 = x, 1 = y.
+    int32 minor_axis = major_axis ^ 1;
+
+    int32 first = (points[0][major_axis] > points[1][major_axis]);
+    int32 last = first ^ 1;
+    int32 start_major = points[first][major_axis];
+    int32 major_delta = points[last][major_axis] - start_major;
+    int32 minor_delta = points[last][minor_axis] - points[first][minor_axis];
+    if (major_delta == 0)
+    {
+        return;
+    }
+
+    // The columns whose centres lie in [start, end), so two lines that share an endpoint don't both
+    // blend into the column there.
+    int32 half_pixel = 1 << (LINE_SUBPIXEL_BITS - 1);
+    int32 pixel_round_up = (1 << LINE_SUBPIXEL_BITS) - 1;
+    int32 first_column = (start_major - half_pixel + pixel_round_up) >> LINE_SUBPIXEL_BITS;
+    int32 end_column = (start_major + major_delta - half_pixel + pixel_round_up) >> LINE_SUBPIXEL_BITS;
+
+    // Minor pixels per major pixel, and where the line is at the first column's centre. Shifted down
+    // half a pixel, so the integer part is the pixel above (or left of) the line.
+    int64 slope = ((int64)minor_delta << 16) / major_delta;
+    int64 first_centre = ((int64)first_column << LINE_SUBPIXEL_BITS) + half_pixel;
+    int64 minor = ((((int64)points[first][minor_axis] << 16) +
+                    (first_centre - start_major) * slope) >> LINE_SUBPIXEL_BITS) - (1 << 15);
+
+    int32 sizes[2] = { buffer->width, buffer->height };
+    int64 strides[2] = { buffer->bytes_per_pixel, buffer->pitch };
+    int32 clip_mins[2] = { clip->min_x, clip->min_y };
+    int32 clip_maxes[2] = { clip->max_x, clip->max_y };
+    int32 major_size = sizes[major_axis];
+    int32 minor_size = sizes[minor_axis];
+    int64 major_stride = strides[major_axis];
+    int64 minor_stride = strides[minor_axis];
+    int32 major_clip_min = clip_mins[major_axis];
+    int32 major_clip_max = clip_maxes[major_axis];
+    int32 minor_clip_min = clip_mins[minor_axis];
+    int32 minor_clip_max = clip_maxes[minor_axis];
+
+    __m128i wide_color = _mm_unpacklo_epi8(_mm_set1_epi32((int32)color), _mm_setzero_si128());
+
+    uint8 *memory = (uint8 *)buffer->memory;
+    for (int32 column = first_column; column < end_column; ++column, minor += slope)
+    {
+        int32 major = WrapCoordinate(column, major_size);
+        if (major >= major_clip_min && major < major_clip_max)
+        {
+            int32 minor_pixel = (int32)(minor >> 16);
+            int32 coverage = (int32)((minor >> 8) & 0xFF);
+
+            int32 minor0 = WrapCoordinate(minor_pixel, minor_size);
+            int32 minor1 = WrapCoordinate(minor_pixel + 1, minor_size);
+
+            uint8 *column_memory = memory + major * major_stride;
+            uint32 *pixel0 = 0;
+            uint32 *pixel1 = 0;
+            if (minor0 >= minor_clip_min && minor0 < minor_clip_max)
+            {
+                pixel0 = (uint32 *)(column_memory + minor0 * minor_stride);
+            }
+            if (minor1 >= minor_clip_min && minor1 < minor_clip_max)
+            {
+                pixel1 = (uint32 *)(column_memory + minor1 * minor_stride);
+            }
+
+            if (pixel0 || pixel1)
+            {
+                BlendSmoothLinePixels(pixel0, pixel1, wide_color, coverage);
+            }
+        }
+    }
+}
+
+inline void RasterizeWrappedPixel(GameOffscreenBuffer *buffer, GameRect *clip,
+                                  int32 x, int32 y, uint32 color)
+{
+    WrapInt32PointAroundBuffer(buffer, &x, &y);
+    if (x >= clip->min_x && x < clip->max_x && y >= clip->min_y && y < clip->max_y)
+    {
+        DrawPixel(buffer, x, y, color);
+    }
+}
+
+// Jesko's midpoint circle algorithm.
+internal void RasterizeCircle(GameOffscreenBuffer *buffer, GameRect *clip,
+                              int32 pos_x, int32 pos_y, int32 radius,
+                              uint32 color)
+{
     int32 x = radius;
     int32 y = 0;
     int32 p = 1 - radius;
 
     // Draw the first point.
-    int32 final_x = pos_x + x;
-    int32 final_y = pos_y + y;
-    WrapInt32PointAroundBuffer(buffer, &final_x, &final_y);
-    DrawPixel(buffer, final_x, final_y, color);
+    RasterizeWrappedPixel(buffer, clip, pos_x + x, pos_y + y, color);
 
     while (x > y)
     {
@@ -169,134 +605,214 @@ internal void DrawCircle(GameOffscreenBuffer *buffer,
             break;
         }
 
-        final_x = pos_x + x;
-        final_y = pos_y + y;
-        WrapInt32PointAroundBuffer(buffer, &final_x, &final_y);
-        DrawPixel(buffer, final_x, final_y, color);
-
-        final_x = pos_x + -x;
-        final_y = pos_y + y;
-        WrapInt32PointAroundBuffer(buffer, &final_x, &final_y);
-        DrawPixel(buffer, final_x, final_y, color);
+        RasterizeWrappedPixel(buffer, clip, pos_x + x, pos_y + y, color);
+        RasterizeWrappedPixel(buffer, clip, pos_x - x, pos_y + y, color);
+        RasterizeWrappedPixel(buffer, clip, pos_x + x, pos_y - y, color);
+        RasterizeWrappedPixel(buffer, clip, pos_x - x, pos_y - y, color);
 
-        final_x = pos_x + x;
-        final_y = pos_y + -y;
-        WrapInt32PointAroundBuffer(buffer, &final_x, &final_y);
-        DrawPixel(buffer, final_x, final_y, color);
+        if (x != y)
+        {
+            RasterizeWrappedPixel(buffer, clip, pos_x + y, pos_y + x, color);
+            RasterizeWrappedPixel(buffer, clip, pos_x - y, pos_y + x, color);
+            RasterizeWrappedPixel(buffer, clip, pos_x + y, pos_y - x, color);
+            RasterizeWrappedPixel(buffer, clip, pos_x - y, pos_y - x, color);
+        }
+    }
+}
 
-        final_x = pos_x + -x;
-        final_y = pos_y + -y;
-        WrapInt32PointAroundBuffer(buffer, &final_x, &final_y);
-        DrawPixel(buffer, final_x, final_y, color);
+internal void RasterizeRectangle(GameOffscreenBuffer *buffer, GameRect *clip,
+                                 GameRect *rect, uint32 color)
+{
+    GameRect area = IntersectRects(rect, clip);
 
-        if (x != y)
+    // Start with the top left pixel.
+    uint8 *row = ((uint8 *)buffer->memory +
+                  area.min_x * buffer->bytes_per_pixel +
+                  area.min_y * buffer->pitch);
+    for (int y = area.min_y; y < area.max_y; ++y)
+    {
+        uint32 *pixel = (uint32 *)row;
+        for (int x = area.min_x; x < area.max_x; ++x)
         {
-            final_x = pos_x + y;
-            final_y = pos_y + x;
-            WrapInt32PointAroundBuffer(buffer, &final_x, &final_y);
-            DrawPixel(buffer, final_x, final_y, color);
+            *pixel++ = color;
+        }
+        row += buffer->pitch;
+    }
+}
 
-            final_x = pos_x + -y;
-            final_y = pos_y + x;
-            WrapInt32PointAroundBuffer(buffer, &final_x, &final_y);
-            DrawPixel(buffer, final_x, final_y, color);
+#define CLEAR_STREAMING_MIN_SIZE MEGABYTES(16)
 
-            final_x = pos_x + y;
-            final_y = pos_y + -x;
-            WrapInt32PointAroundBuffer(buffer, &final_x, &final_y);
-            DrawPixel(buffer, final_x, final_y, color);
+// NOTE(mara): Each kernel fills one span of pixels. The scalar head brings the pointer up to the
+// vector alignment, so every vector store is aligned (streaming stores require it), and the scalar
+// tail finishes off whatever doesn't fill a whole vector.
+internal void ClearSpanSSE2(uint32 *pixel, memsize count, uint32 color, bool32 is_streaming)
+{
+    while (count > 0 && ((memsize)pixel & 15))
+    {
+        *pixel++ = color;
+        --count;
+    }
 
-            final_x = pos_x + -y;
-            final_y = pos_y + -x;
-            WrapInt32PointAroundBuffer(buffer, &final_x, &final_y);
-            DrawPixel(buffer, final_x, final_y, color);
+    __m128i wide_color = _mm_set1_epi32((int32)color);
+    memsize vector_count = count / 4;
+    if (is_streaming)
+    {
+        for (memsize i = 0; i < vector_count; ++i)
+        {
+            _mm_stream_si128((__m128i *)pixel, wide_color);
+            pixel += 4;
+        }
+    }
+    else
+    {
+        for (memsize i = 0; i < vector_count; ++i)
+        {
+            _mm_store_si128((__m128i *)pixel, wide_color);
+            pixel += 4;
         }
     }
+
+    for (memsize i = vector_count * 4; i < count; ++i)
+    {
+        *pixel++ = color;
+    }
 }
 
-internal void DrawFilledRectangle(GameOffscreenBuffer *buffer,
-                                  float32 real_min_x, float32 real_min_y,
-                                  float32 real_max_x, float32 real_max_y,
-                                  float32 r, float32 g, float32 b) // 0 - 1 values.
+SIMD_TARGET_AVX2
+internal void ClearSpanAVX2(uint32 *pixel, memsize count, uint32 color, bool32 is_streaming)
 {
-    int32 min_x = RoundFloat32ToInt32(real_min_x);
-    int32 min_y = RoundFloat32ToInt32(real_min_y);
-    int32 max_x = RoundFloat32ToInt32(real_max_x);
-    int32 max_y = RoundFloat32ToInt32(real_max_y);
-
-    if (min_x < 0)
+    while (count > 0 && ((memsize)pixel & 31))
     {
-        min_x = 0;
+        *pixel++ = color;
+        --count;
     }
-    if (min_y < 0)
+
+    __m256i wide_color = _mm256_set1_epi32((int32)color);
+    memsize vector_count = count / 8;
+    if (is_streaming)
     {
-        min_y = 0;
+        for (memsize i = 0; i < vector_count; ++i)
+        {
+            _mm256_stream_si256((__m256i *)pixel, wide_color);
+            pixel += 8;
+        }
     }
-    if (max_x > buffer->width)
+    else
     {
-        max_x = buffer->width;
+        for (memsize i = 0; i < vector_count; ++i)
+        {
+            _mm256_store_si256((__m256i *)pixel, wide_color);
+            pixel += 8;
+        }
     }
-    if (max_y > buffer->height)
+
+    for (memsize i = vector_count * 8; i < count; ++i)
     {
-        max_y = buffer->height;
+        *pixel++ = color;
     }
+}
 
-    uint32 color = MakeColor(r, g, b);
+// NOTE(mara): Clearing touches every byte of the buffer and reads none of them, so once the buffer
+// is too big to stay in the cache anyway, the stores stream straight to memory instead of dragging
+// every line into the cache first and evicting everything else on the way.
+internal void ClearBuffer(GameOffscreenBuffer *buffer, uint32 color, SimdLevel simd_level)
+{
+    memsize buffer_size = (memsize)buffer->pitch * (memsize)buffer->height;
+    bool32 is_streaming = (buffer_size >= CLEAR_STREAMING_MIN_SIZE);
 
-    // Start with the top left pixel.
-    uint8 *row = ((uint8 *)buffer->memory +
-                  min_x * buffer->bytes_per_pixel +
-                  min_y * buffer->pitch);
-    for (int y = min_y; y < max_y; ++y)
+    // Rows without padding between them are cleared as one long span.
+    int32 span_count = buffer->height;
+    memsize span_length = (memsize)buffer->width;
+    if (buffer->pitch == buffer->width * buffer->bytes_per_pixel)
     {
-        uint32 *pixel = (uint32 *)row;
-        for (int x = min_x; x < max_x; ++x)
+        span_count = 1;
+        span_length *= (memsize)buffer->height;
+    }
+
+    uint8 *row = (uint8 *)buffer->memory;
+    for (int32 i = 0; i < span_count; ++i)
+    {
+        if (simd_level >= SIMD_LEVEL_AVX2)
         {
-            *pixel++ = color;
+            ClearSpanAVX2((uint32 *)row, span_length, color, is_streaming);
+        }
+        else
+        {
+            ClearSpanSSE2((uint32 *)row, span_length, color, is_streaming);
         }
         row += buffer->pitch;
     }
+
+    if (is_streaming)
+    {
+        // Streaming stores are weakly ordered. Make sure they've all landed before the platform
+        // layer (possibly on another thread) reads the buffer.
+        _mm_sfence();
+    }
 }
 
-internal void DrawUnfilledRectangle(GameOffscreenBuffer *buffer,
-                                    float32 real_min_x, float32 real_min_y,
-                                    float32 real_max_x, float32 real_max_y,
-                                    float32 r, float32 g, float32 b)
+// NOTE(mara): Clears one rectangle that's already inside the buffer. Streaming only pays off when
+// it's part of clearing a buffer too big for the cache; the caller has to _mm_sfence afterwards.
+internal void ClearRectangle(GameOffscreenBuffer *buffer, GameRect *rect, uint32 color, bool32 is_streaming,
+                              SimdLevel simd_level)
 {
-    int32 min_x = RoundFloat32ToInt32(real_min_x);
-    int32 min_y = RoundFloat32ToInt32(real_min_y);
-    int32 max_x = RoundFloat32ToInt32(real_max_x);
-    int32 max_y = RoundFloat32ToInt32(real_max_y);
+    memsize span_length = (memsize)(rect->max_x - rect->min_x);
 
-    if (min_x < 0)
-    {
-        min_x = 0;
-    }
-    if (min_y < 0)
+    uint8 *row = ((uint8 *)buffer->memory +
+                  rect->min_x * buffer->bytes_per_pixel +
+                  rect->min_y * buffer->pitch);
+    for (int32 y = rect->min_y; y < rect->max_y; ++y)
     {
-        min_y = 0;
+        if (simd_level >= SIMD_LEVEL_AVX2)
+        {
+            ClearSpanAVX2((uint32 *)row, span_length, color, is_streaming);
+        }
+        else
+        {
+            ClearSpanSSE2((uint32 *)row, span_length, color, is_streaming);
+        }
+        row += buffer->pitch;
     }
-    if (max_x > buffer->width)
+}
+
+// NOTE(mara): A whole-buffer clear drawn in tiles streams each tile just like ClearBuffer would;
+// erasing last frame's rectangles never does, since they're about to be drawn over again.
+internal void RasterizeClear(GameOffscreenBuffer *buffer, GameRect *clip,
+                             GameRect *rect, uint32 color, SimdLevel simd_level)
+{
+    bool32 is_whole_buffer = (rect->min_x == 0 && rect->min_y == 0 &&
+                              rect->max_x == buffer->width && rect->max_y == buffer->height);
+    GameRect area = IntersectRects(rect, clip);
+    if (is_whole_buffer && area.min_x == 0 && area.min_y == 0 &&
+        area.max_x == buffer->width && area.max_y == buffer->height)
     {
-        max_x = buffer->width;
+        ClearBuffer(buffer, color, simd_level);
     }
-    if (max_y > buffer->height)
+    else if (!IsRectEmpty(&area))
     {
-        max_y = buffer->height;
+        memsize buffer_size = (memsize)buffer->pitch * (memsize)buffer->height;
+        ClearRectangle(buffer, &area, color, is_whole_buffer && buffer_size >= CLEAR_STREAMING_MIN_SIZE,
+                       simd_level);
     }
+}
 
-    uint32 color = MakeColor(r, g, b);
+// NOTE(mara): rect is already clipped to the buffer, so a rectangle hanging off the screen gets its
+// border drawn along the screen edge instead.
+internal void RasterizeRectangleOutline(GameOffscreenBuffer *buffer, GameRect *clip,
+                                        GameRect *rect, uint32 color)
+{
+    GameRect area = IntersectRects(rect, clip);
 
     // Start with the top left pixel.
     uint8 *row = ((uint8 *)buffer->memory +
-                  min_x * buffer->bytes_per_pixel +
-                  min_y * buffer->pitch);
-    for (int y = min_y; y < max_y; ++y)
+                  area.min_x * buffer->bytes_per_pixel +
+                  area.min_y * buffer->pitch);
+    for (int y = area.min_y; y < area.max_y; ++y)
     {
         uint32 *pixel = (uint32 *)row;
-        for (int x = min_x; x < max_x; ++x)
+        for (int x = area.min_x; x < area.max_x; ++x)
         {
-            if (x == min_x || y == min_y || x == max_x - 1 || y == max_y - 1)
+            if (x == rect->min_x || y == rect->min_y || x == rect->max_x - 1 || y == rect->max_y - 1)
             {
                 *pixel++ = color;
             }
@@ -309,270 +825,2032 @@ internal void DrawUnfilledRectangle(GameOffscreenBuffer *buffer,
     }
 }
 
-internal void DrawLetterFromFont(GameOffscreenBuffer *buffer, FontData *font,
-                                 char letter, float32 scale,
-                                 int32 x, int32 y,
-                                 float32 r, float32 g, float32 b)
+// NOTE(mara): Glyph coverage is blended "over" the buffer: dest + (color - dest) * coverage / 255,
+// worked out as (dest * (255 - a) + color * a) / 255 rounded to nearest, which is exact for 0 and
+// 255 and never goes over 16 bits. Every kernel below does exactly that arithmetic, so which of them
+// a pixel ends up in (that depends on where a tile cuts the glyph) never changes the result.
+inline uint32 BlendGlyphPixel(uint32 dest, uint32 color, uint32 alpha)
 {
-    int width, height, x_offset, y_offset;
-    uchar8 *bitmap = stbtt_GetCodepointBitmap(&font->stb_font_info, 0, scale,
-                                              letter, &width, &height, &x_offset, &y_offset);
-
-    x += x_offset;
-    y += y_offset;
-
-    int32 max_x = x + width;
-    int32 max_y = y + height;
-
-    if (x < 0)
-    {
-        x = 0;
-    }
-    if (y < 0)
-    {
-        y = 0;
-    }
-    if (max_x > buffer->width)
+    uint32 result = 0;
+    for (int32 shift = 0; shift < 32; shift += 8)
     {
-        max_x = buffer->width;
+        uint32 value = ((dest >> shift) & 0xFF) * (255 - alpha) + ((color >> shift) & 0xFF) * alpha + 128;
+        result |= ((value + (value >> 8)) >> 8) << shift;
     }
-    if (max_y > buffer->height)
+    return result;
+}
+
+// 16-bit channels, with each pixel's coverage repeated across its four of them.
+inline __m128i BlendGlyphChannelsSSE2(__m128i dest, __m128i color, __m128i alpha)
+{
+    __m128i inverse_alpha = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+    __m128i value = _mm_add_epi16(_mm_mullo_epi16(dest, inverse_alpha), _mm_mullo_epi16(color, alpha));
+    value = _mm_add_epi16(value, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(value, _mm_srli_epi16(value, 8)), 8);
+}
+
+// NOTE(mara): Glyphs are small and land anywhere on a buffer that was just cleared out of the
+// cache, so most of their time goes to waiting for the destination rows. Asking for all of them up
+// front lets those misses overlap instead of coming one row at a time.
+inline void PrefetchGlyphRows(uint8 *dest_row, memsize dest_pitch, int32 width, int32 height)
+{
+    memsize last_pixel_offset = (memsize)(width - 1) * sizeof(uint32);
+    for (int32 row = 0; row < height; ++row)
     {
-        max_y = buffer->height;
+        _mm_prefetch((char *)dest_row, _MM_HINT_T0);
+        _mm_prefetch((char *)dest_row + last_pixel_offset, _MM_HINT_T0);
+        dest_row += dest_pitch;
     }
+}
 
-    uint32 color = MakeColor(r, g, b);
+// Four pixels' coverage (alpha_bytes, one byte each) repeated across their channels.
+inline __m128i BlendGlyphPixelsSSE2(__m128i pixels, uint32 alpha_bytes, __m128i color)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i alpha = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int32)alpha_bytes), zero);
+    alpha = _mm_unpacklo_epi16(alpha, alpha);
+
+    __m128i low = BlendGlyphChannelsSSE2(_mm_unpacklo_epi8(pixels, zero), color,
+                                         _mm_unpacklo_epi32(alpha, alpha));
+    __m128i high = BlendGlyphChannelsSSE2(_mm_unpackhi_epi8(pixels, zero), color,
+                                          _mm_unpackhi_epi32(alpha, alpha));
+    return _mm_packus_epi16(low, high);
+}
+
+// NOTE(mara): Four pixels at a time. Runs of four with no coverage at all (most of a glyph's box)
+// are skipped, and runs of four fully covered ones are just the colour. The last one to three
+// pixels of a row are loaded and stored one by one, but blended all at once. Their coverage is read
+// four bytes at a time as well, which is what GLYPH_COVERAGE_PADDING is for.
+internal void BlendGlyphSSE2(uint8 *dest_row, memsize dest_pitch, uint8 *src_row, int32 src_pitch,
+                             int32 width, int32 height, uint32 color)
+{
+    __m128i wide_color = _mm_unpacklo_epi8(_mm_set1_epi32((int32)color), _mm_setzero_si128());
+    __m128i solid_color = _mm_set1_epi32((int32)color);
+
+    int32 tail_width = width & 3;
+    int32 body_width = width - tail_width;
+    uint32 tail_alpha_mask = (uint32)(((uint64)1 << (8 * tail_width)) - 1);
+
+    PrefetchGlyphRows(dest_row, dest_pitch, width, height);
+    for (int32 row = 0; row < height; ++row)
+    {
+        uint32 *dest = (uint32 *)dest_row;
+        uint8 *coverage = src_row;
+
+        for (int32 i = 0; i < body_width; i += 4)
+        {
+            uint32 alpha_bytes = *(uint32 *)(coverage + i);
+            if (alpha_bytes == 0)
+            {
+                continue;
+            }
+            if (alpha_bytes == 0xFFFFFFFF)
+            {
+                _mm_storeu_si128((__m128i *)(dest + i), solid_color);
+                continue;
+            }
+
+            __m128i pixels = _mm_loadu_si128((__m128i *)(dest + i));
+            _mm_storeu_si128((__m128i *)(dest + i), BlendGlyphPixelsSSE2(pixels, alpha_bytes, wide_color));
+        }
+
+        uint32 tail_alpha_bytes = *(uint32 *)(coverage + body_width) & tail_alpha_mask;
+        if (tail_alpha_bytes != 0)
+        {
+            uint32 *tail = dest + body_width;
+            __m128i pixels = _mm_cvtsi32_si128((int32)tail[0]);
+            if (tail_width > 1)
+            {
+                pixels = _mm_unpacklo_epi32(pixels, _mm_cvtsi32_si128((int32)tail[1]));
+            }
+            if (tail_width > 2)
+            {
+                pixels = _mm_unpacklo_epi64(pixels, _mm_cvtsi32_si128((int32)tail[2]));
+            }
+
+            pixels = BlendGlyphPixelsSSE2(pixels, tail_alpha_bytes, wide_color);
+            tail[0] = (uint32)_mm_cvtsi128_si32(pixels);
+            if (tail_width > 1)
+            {
+                tail[1] = (uint32)_mm_cvtsi128_si32(_mm_srli_si128(pixels, 4));
+            }
+            if (tail_width > 2)
+            {
+                tail[2] = (uint32)_mm_cvtsi128_si32(_mm_srli_si128(pixels, 8));
+            }
+        }
+
+        src_row += src_pitch;
+        dest_row += dest_pitch;
+    }
+}
+
+// NOTE(mara): Eight pixels at a time. The unpacks work within 128-bit lanes, so the low half of
+// each lane holds pixels 0, 1 and 4, 5 and the high half 2, 3 and 6, 7; the coverage is spread out
+// the same way.
+SIMD_TARGET_AVX2
+inline __m256i BlendGlyphPixelsAVX2(__m256i pixels, uint64 alpha_bytes, __m256i color)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i alpha = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128((int64)alpha_bytes));
+    alpha = _mm256_or_si256(alpha, _mm256_slli_epi32(alpha, 16));
+
+    __m256i channels[2] =
+    {
+        _mm256_unpacklo_epi8(pixels, zero),
+        _mm256_unpackhi_epi8(pixels, zero),
+    };
+    __m256i alphas[2] =
+    {
+        _mm256_unpacklo_epi32(alpha, alpha),
+        _mm256_unpackhi_epi32(alpha, alpha),
+    };
+    for (int32 half = 0; half < 2; ++half)
+    {
+        __m256i inverse_alpha = _mm256_sub_epi16(_mm256_set1_epi16(255), alphas[half]);
+        __m256i value = _mm256_add_epi16(_mm256_mullo_epi16(channels[half], inverse_alpha),
+                                         _mm256_mullo_epi16(color, alphas[half]));
+        value = _mm256_add_epi16(value, _mm256_set1_epi16(128));
+        channels[half] = _mm256_srli_epi16(_mm256_add_epi16(value, _mm256_srli_epi16(value, 8)), 8);
+    }
+
+    return _mm256_packus_epi16(channels[0], channels[1]);
+}
+
+// NOTE(mara): Like the SSE2 version, but the last few pixels of a row go through masked loads and
+// stores. Masked-off pixels are never written, so a glyph cut by a tile doesn't touch the tile next
+// to it.
+SIMD_TARGET_AVX2
+internal void BlendGlyphAVX2(uint8 *dest_row, memsize dest_pitch, uint8 *src_row, int32 src_pitch,
+                             int32 width, int32 height, uint32 color)
+{
+    __m256i wide_color = _mm256_unpacklo_epi8(_mm256_set1_epi32((int32)color), _mm256_setzero_si256());
+    __m256i solid_color = _mm256_set1_epi32((int32)color);
+
+    int32 tail_width = width & 7;
+    int32 body_width = width - tail_width;
+    uint64 tail_alpha_mask = ((uint64)1 << (8 * tail_width)) - 1;
+    __m256i tail_mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(tail_width),
+                                           _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+    PrefetchGlyphRows(dest_row, dest_pitch, width, height);
+    for (int32 row = 0; row < height; ++row)
+    {
+        uint32 *dest = (uint32 *)dest_row;
+        uint8 *coverage = src_row;
+
+        for (int32 i = 0; i < body_width; i += 8)
+        {
+            uint64 alpha_bytes = *(uint64 *)(coverage + i);
+            if (alpha_bytes == 0)
+            {
+                continue;
+            }
+            if (alpha_bytes == 0xFFFFFFFFFFFFFFFF)
+            {
+                _mm256_storeu_si256((__m256i *)(dest + i), solid_color);
+                continue;
+            }
+
+            __m256i pixels = _mm256_loadu_si256((__m256i *)(dest + i));
+            _mm256_storeu_si256((__m256i *)(dest + i), BlendGlyphPixelsAVX2(pixels, alpha_bytes, wide_color));
+        }
+
+        uint64 tail_alpha_bytes = *(uint64 *)(coverage + body_width) & tail_alpha_mask;
+        if (tail_alpha_bytes != 0)
+        {
+            __m256i pixels = _mm256_maskload_epi32((int32 *)(dest + body_width), tail_mask);
+            _mm256_maskstore_epi32((int32 *)(dest + body_width), tail_mask,
+                                   BlendGlyphPixelsAVX2(pixels, tail_alpha_bytes, wide_color));
+        }
+
+        src_row += src_pitch;
+        dest_row += dest_pitch;
+    }
+}
+
+internal void RasterizeGlyph(GameOffscreenBuffer *buffer, GameRect *clip,
+                             FontGlyph *glyph, int32 x, int32 y,
+                             uint32 color, SimdLevel simd_level)
+{
+    GameRect glyph_rect;
+    glyph_rect.min_x = x + glyph->x_offset;
+    glyph_rect.min_y = y + glyph->y_offset;
+    glyph_rect.max_x = glyph_rect.min_x + glyph->width;
+    glyph_rect.max_y = glyph_rect.min_y + glyph->height;
+
+    // Clip, remembering where in the coverage the visible part starts.
+    GameRect area = IntersectRects(&glyph_rect, clip);
+    if (IsRectEmpty(&area))
+    {
+        return;
+    }
+    int32 src_x = area.min_x - glyph_rect.min_x;
+    int32 src_y = area.min_y - glyph_rect.min_y;
+
+    uint8 *src_row = glyph->coverage + src_y * glyph->width + src_x;
+    uint8 *dest_row = ((uint8 *)buffer->memory +
+                       area.min_x * buffer->bytes_per_pixel +
+                       area.min_y * buffer->pitch);
+    if (simd_level >= SIMD_LEVEL_AVX2)
+    {
+        BlendGlyphAVX2(dest_row, buffer->pitch, src_row, glyph->width,
+                       area.max_x - area.min_x, area.max_y - area.min_y, color);
+    }
+    else
+    {
+        BlendGlyphSSE2(dest_row, buffer->pitch, src_row, glyph->width,
+                       area.max_x - area.min_x, area.max_y - area.min_y, color);
+    }
+}
+
+// =================================================================================================
+// RENDER COMMANDS
+// =================================================================================================
+
+internal RenderGroup *AllocateRenderGroup(MemoryArena *arena, GameMemory *memory, SimdLevel simd_level,
+                                          GameOffscreenBuffer *buffer, uint32 max_command_count)
+{
+    RenderGroup *group = PushStruct(arena, RenderGroup, 16);
+    group->buffer = buffer;
+    group->arena = arena;
+    group->platform = &memory->platform_api;
+    group->queue = memory->render_queue;
+    group->worker_count = memory->render_worker_count;
+    group->simd_level = simd_level;
+    group->current_layer = RENDER_LAYER_BACKGROUND;
+    group->is_output_skipped = memory->skip_render_output;
+    group->is_line_smoothing = memory->smooth_lines;
+    group->draw_list_dump = memory->draw_list_dump;
+    group->command_count = 0;
+    group->max_command_count = max_command_count;
+    group->commands = PushArray(arena, max_command_count, RenderCommand, 64);
+    group->sorted_commands = PushArray(arena, max_command_count, RenderCommand, 64);
+
+    return group;
+}
+
+internal void RenderGroupToOutput(RenderGroup *group);
+
+inline void SetRenderLayer(RenderGroup *group, RenderLayer layer)
+{
+    group->current_layer = layer;
+}
+
+// NOTE(mara): A frame that records more than max_command_count commands draws what it has so far
+// and starts over; it's slower and the two halves are only sorted among themselves, but nothing goes
+// missing.
+internal RenderCommand *PushRenderCommand(RenderGroup *group, RenderCommandType type, uint32 color,
+                                          int32 min_x, int32 min_y, int32 max_x, int32 max_y)
+{
+    if (group->command_count == group->max_command_count)
+    {
+        RenderGroupToOutput(group);
+    }
+
+    RenderCommand *command = &group->commands[group->command_count++];
+    command->type = (uint16)type;
+    command->layer = (uint16)group->current_layer;
+    command->color = color;
+    command->bounds = { min_x, min_y, max_x, max_y };
+
+    return command;
+}
+
+// NOTE(mara): Erasing isn't marked dirty; GameRender accounts for what it erased itself.
+internal void PushClear(RenderGroup *group, GameRect *rect, uint32 color)
+{
+    GameRect buffer_rect = GetBufferRect(group->buffer);
+    GameRect area = IntersectRects(rect, &buffer_rect);
+    if (!IsRectEmpty(&area))
+    {
+        RenderCommand *command = PushRenderCommand(group, RENDER_COMMAND_CLEAR, color,
+                                                   area.min_x, area.min_y, area.max_x, area.max_y);
+        command->rectangle.rect = area;
+    }
+}
+
+internal void DrawLine(RenderGroup *group,
+                       float32 x0, float32 y0,
+                       float32 x1, float32 y1,
+                       float32 r, float32 g, float32 b)
+{
+    int32 start_x = SnapToLineSubpixels(x0);
+    int32 start_y = SnapToLineSubpixels(y0);
+    int32 end_x = SnapToLineSubpixels(x1);
+    int32 end_y = SnapToLineSubpixels(y1);
+
+    // NOTE(mara): Rounding both ends to whole pixels can add a pixel along the major axis, and with
+    // it up to one more minor step than the line really has. So the rasterizer may end up to two
+    // pixels past either end on the minor axis; the bounds leave that much room rather than working
+    // out the slope here as well. Smooth lines stay within a pixel of their ends either way.
+    int32 min_x = (MinInt32(start_x, end_x) >> LINE_SUBPIXEL_BITS) - 2;
+    int32 min_y = (MinInt32(start_y, end_y) >> LINE_SUBPIXEL_BITS) - 2;
+    int32 max_x = (MaxInt32(start_x, end_x) >> LINE_SUBPIXEL_BITS) + 3;
+    int32 max_y = (MaxInt32(start_y, end_y) >> LINE_SUBPIXEL_BITS) + 3;
+    MarkDirtyWrappedRectangle(group->buffer, min_x, min_y, max_x, max_y);
+
+    RenderCommandType type = group->is_line_smoothing ? RENDER_COMMAND_SMOOTH_LINE : RENDER_COMMAND_LINE;
+    RenderCommand *command = PushRenderCommand(group, type, MakeColor(r, g, b),
+                                               min_x, min_y, max_x, max_y);
+    command->line.x0 = start_x;
+    command->line.y0 = start_y;
+    command->line.x1 = end_x;
+    command->line.y1 = end_y;
+}
+
+internal void DrawPoints(RenderGroup *group,
+                         Vector2 *points, int32 array_length,
+                         float32 r, float32 g, float32 b,
+                         float32 x_offset = 0.0f, float32 y_offset = 0.0f)
+{
+    for (int i = 0; i < array_length; ++i)
+    {
+        int32 next_i = (i + 1) % array_length;
+        DrawLine(group,
+                 points[i].x      + x_offset, points[i].y      + y_offset,
+                 points[next_i].x + x_offset, points[next_i].y + y_offset,
+                 r, g, b);
+    }
+}
+
+internal void DrawCircle(RenderGroup *group,
+                         float32 real_x, float32 real_y, float32 real_radius,
+                         float32 r, float32 g, float32 b)
+{
+    int32 pos_x = RoundFloat32ToInt32(real_x);
+    int32 pos_y = RoundFloat32ToInt32(real_y);
+    int32 radius = RoundFloat32ToInt32(real_radius);
+
+    int32 min_x = pos_x - radius;
+    int32 min_y = pos_y - radius;
+    int32 max_x = pos_x + radius + 1;
+    int32 max_y = pos_y + radius + 1;
+    MarkDirtyWrappedRectangle(group->buffer, min_x, min_y, max_x, max_y);
+
+    RenderCommand *command = PushRenderCommand(group, RENDER_COMMAND_CIRCLE, MakeColor(r, g, b),
+                                               min_x, min_y, max_x, max_y);
+    command->circle.x = pos_x;
+    command->circle.y = pos_y;
+    command->circle.radius = radius;
+}
+
+// A single pixel, wrapped around the buffer.
+internal void DrawPoint(RenderGroup *group,
+                        int32 x, int32 y,
+                        float32 r, float32 g, float32 b)
+{
+    WrapInt32PointAroundBuffer(group->buffer, &x, &y);
+    MarkDirtyWrappedRectangle(group->buffer, x, y, x + 1, y + 1);
+
+    RenderCommand *command = PushRenderCommand(group, RENDER_COMMAND_PIXEL, MakeColor(r, g, b),
+                                               x, y, x + 1, y + 1);
+    command->pixel.x = x;
+    command->pixel.y = y;
+}
+
+internal void DrawRectangle(RenderGroup *group, RenderCommandType type,
+                            float32 real_min_x, float32 real_min_y,
+                            float32 real_max_x, float32 real_max_y,
+                            float32 r, float32 g, float32 b)
+{
+    GameRect rect;
+    rect.min_x = RoundFloat32ToInt32(real_min_x);
+    rect.min_y = RoundFloat32ToInt32(real_min_y);
+    rect.max_x = RoundFloat32ToInt32(real_max_x);
+    rect.max_y = RoundFloat32ToInt32(real_max_y);
+
+    GameRect buffer_rect = GetBufferRect(group->buffer);
+    rect = IntersectRects(&rect, &buffer_rect);
+    if (IsRectEmpty(&rect))
+    {
+        return;
+    }
+    MarkDirtyRectangle(group->buffer, rect.min_x, rect.min_y, rect.max_x, rect.max_y);
+
+    RenderCommand *command = PushRenderCommand(group, type, MakeColor(r, g, b),
+                                               rect.min_x, rect.min_y, rect.max_x, rect.max_y);
+    command->rectangle.rect = rect;
+}
+
+internal void DrawFilledRectangle(RenderGroup *group,
+                                  float32 real_min_x, float32 real_min_y,
+                                  float32 real_max_x, float32 real_max_y,
+                                  float32 r, float32 g, float32 b) // 0 - 1 values.
+{
+    DrawRectangle(group, RENDER_COMMAND_RECTANGLE,
+                  real_min_x, real_min_y, real_max_x, real_max_y,
+                  r, g, b);
+}
+
+internal void DrawUnfilledRectangle(RenderGroup *group,
+                                    float32 real_min_x, float32 real_min_y,
+                                    float32 real_max_x, float32 real_max_y,
+                                    float32 r, float32 g, float32 b)
+{
+    DrawRectangle(group, RENDER_COMMAND_RECTANGLE_OUTLINE,
+                  real_min_x, real_min_y, real_max_x, real_max_y,
+                  r, g, b);
+}
+
+// NOTE(mara): glyph has to stay put until the end of the frame: it's either in an atlas or in the
+// render group's arena.
+internal void DrawGlyph(RenderGroup *group, FontGlyph *glyph,
+                        int32 x, int32 y,
+                        float32 r, float32 g, float32 b)
+{
+    GameRect rect;
+    rect.min_x = x + glyph->x_offset;
+    rect.min_y = y + glyph->y_offset;
+    rect.max_x = rect.min_x + glyph->width;
+    rect.max_y = rect.min_y + glyph->height;
+
+    GameRect buffer_rect = GetBufferRect(group->buffer);
+    rect = IntersectRects(&rect, &buffer_rect);
+    if (IsRectEmpty(&rect))
+    {
+        return;
+    }
+    MarkDirtyRectangle(group->buffer, rect.min_x, rect.min_y, rect.max_x, rect.max_y);
+
+    RenderCommand *command = PushRenderCommand(group, RENDER_COMMAND_GLYPH, MakeColor(r, g, b),
+                                               rect.min_x, rect.min_y, rect.max_x, rect.max_y);
+    command->glyph.glyph = glyph;
+    command->glyph.x = x;
+    command->glyph.y = y;
+}
+
+// NOTE(mara): For letters that aren't in an atlas. The letter is rasterized on the spot into the
+// render group's arena and drawn like any other glyph. If even that doesn't fit, it's skipped.
+internal void DrawLetterFromFont(RenderGroup *group, FontData *font,
+                                 char letter, float32 scale,
+                                 int32 x, int32 y,
+                                 float32 r, float32 g, float32 b)
+{
+    int width, height, x_offset, y_offset;
+    uchar8 *bitmap = stbtt_GetCodepointBitmap(&font->stb_font_info, 0, scale,
+                                              letter, &width, &height, &x_offset, &y_offset);
+    if (!bitmap)
+    {
+        return;
+    }
+
+    memsize coverage_size = (memsize)width * (memsize)height;
+    memsize padded_coverage_size = coverage_size + GLYPH_COVERAGE_PADDING;
+    if (coverage_size > 0 &&
+        GetArenaSizeRemaining(group->arena, 16) >= sizeof(FontGlyph) + padded_coverage_size + 16)
+    {
+        FontGlyph *glyph = PushStruct(group->arena, FontGlyph, 16);
+        glyph->width = width;
+        glyph->height = height;
+        glyph->x_offset = x_offset;
+        glyph->y_offset = y_offset;
+        glyph->advance = 0;
+        glyph->coverage = (uint8 *)PushSize(group->arena, padded_coverage_size, 1);
+        Copy(coverage_size, bitmap, glyph->coverage);
+
+        DrawGlyph(group, glyph, x, y, r, g, b);
+    }
+
+    stbtt_FreeBitmap(bitmap, 0);
+}
+
+// NOTE(mara): Draws from the atlas when the letter is in there and only rasterizes it on the spot
+// when it isn't.
+inline void DrawLetter(RenderGroup *group, FontData *font, FontAtlas *atlas,
+                       char letter, float32 scale,
+                       int32 x, int32 y,
+                       float32 r, float32 g, float32 b)
+{
+    if (atlas && IsInFontAtlas(letter))
+    {
+        FontGlyph *glyph = &atlas->glyphs[letter - FONT_ATLAS_FIRST_CODEPOINT];
+        if (glyph->coverage)
+        {
+            DrawGlyph(group, glyph, x, y, r, g, b);
+        }
+    }
+    else
+    {
+        DrawLetterFromFont(group, font, letter, scale, x, y, r, g, b);
+    }
+}
+
+inline int32 GetLetterAdvance(FontData *font, FontAtlas *atlas, float32 scale,
+                              char letter, char next_letter)
+{
+    int32 result = 0;
+    if (atlas && IsInFontAtlas(letter) && IsInFontAtlas(next_letter))
+    {
+        result = (atlas->glyphs[letter - FONT_ATLAS_FIRST_CODEPOINT].advance +
+                  atlas->kerning[letter - FONT_ATLAS_FIRST_CODEPOINT][next_letter - FONT_ATLAS_FIRST_CODEPOINT]);
+    }
+    else
+    {
+        int32 advance_width, left_side_bearing;
+        stbtt_GetCodepointHMetrics(&font->stb_font_info, letter, &advance_width, &left_side_bearing);
+
+        int32 kern = stbtt_GetCodepointKernAdvance(&font->stb_font_info, letter, next_letter);
+
+        result += RoundFloat32ToInt32((float32)advance_width * scale);
+        result += RoundFloat32ToInt32((float32)kern * scale);
+    }
+    return result;
+}
+
+internal void LayoutText(FontData *font, char *str, uint32 str_length, float32 pixel_height,
+                         TextLayout *layout)
+{
+    layout->pixel_height = pixel_height;
+    layout->atlas = GetFontAtlas(font, pixel_height);
+    layout->scale = stbtt_ScaleForPixelHeight(&font->stb_font_info, pixel_height);
+    layout->ascent = RoundFloat32ToInt32((float32)font->ascent * layout->scale);
+
+    int32 x = 0;
+    layout->length = 0;
+    for (uint32 i = 0; i < str_length && i < MAX_TEXT_LAYOUT_LENGTH; ++i)
+    {
+        if (str[i] == '\0')
+        {
+            break;
+        }
+
+        layout->text[i] = str[i];
+        layout->pen_x[i] = x;
+        ++layout->length;
+
+        x += GetLetterAdvance(font, layout->atlas, layout->scale, str[i], str[i + 1]);
+    }
+}
+
+// NOTE(mara): Hashing and comparing the text is all a string that hasn't changed costs before it's
+// drawn. Strings longer than MAX_TEXT_LAYOUT_LENGTH are cut off there.
+internal TextLayout *GetTextLayout(FontData *font, char *str, uint32 str_length, float32 pixel_height,
+                                   TextLayout *scratch_layout)
+{
+    uint32 length = 0;
+    uint32 hash = 2166136261u;
+    while (length < str_length && length < MAX_TEXT_LAYOUT_LENGTH && str[length] != '\0')
+    {
+        hash = (hash ^ (uint8)str[length]) * 16777619u;
+        ++length;
+    }
+    hash = (hash ^ (uint32)RoundFloat32ToInt32(pixel_height * 64.0f)) * 16777619u;
+    if (hash == 0)
+    {
+        hash = 1;
+    }
+
+    TextLayout *layout = scratch_layout;
+    if (font->layouts)
+    {
+        layout = &font->layouts[hash & (TEXT_LAYOUT_CACHE_SIZE - 1)];
+        if (layout->hash == hash &&
+            layout->length == length &&
+            layout->pixel_height == pixel_height &&
+            StringsAreEqual(length, layout->text, str))
+        {
+            return layout;
+        }
+    }
+
+    LayoutText(font, str, str_length, pixel_height, layout);
+    layout->hash = hash;
+
+    return layout;
+}
+
+internal void DrawString(RenderGroup *group, FontData *font,
+                         char *str, uint32 str_length, float32 pixel_height,
+                         float32 start_x, float32 start_y,
+                         float32 r, float32 g, float32 b)
+{
+    TextLayout scratch_layout;
+    TextLayout *layout = GetTextLayout(font, str, str_length, pixel_height, &scratch_layout);
+
+    int32 x = RoundFloat32ToInt32(start_x);
+    int32 y = RoundFloat32ToInt32(start_y);
+    y += layout->ascent;
+
+    for (uint32 i = 0; i < layout->length; ++i)
+    {
+        DrawLetter(group, font, layout->atlas,
+                   layout->text[i], layout->scale,
+                   x + layout->pen_x[i], y,
+                   r, g, b);
+    }
+}
+
+internal void DrawWavyString(RenderGroup *group, FontData *font, GameTime *time,
+                             char *str, uint32 str_length, float32 pixel_height,
+                             float32 start_x, float32 start_y,
+                             float32 wave_speed, float32 wave_amplitude,
+                             float32 r, float32 g, float32 b)
+{
+    TextLayout scratch_layout;
+    TextLayout *layout = GetTextLayout(font, str, str_length, pixel_height, &scratch_layout);
+
+    int32 start_pen_x = RoundFloat32ToInt32(start_x);
+
+    for (uint32 i = 0; i < layout->length; ++i)
+    {
+        int32 x = start_pen_x + layout->pen_x[i];
+
+        float32 sin_value = Sin((float32)time->total_time * wave_speed + (float32)x) * wave_amplitude;
+        int32 y = RoundFloat32ToInt32(start_y + sin_value) + layout->ascent;
+
+        DrawLetter(group, font, layout->atlas,
+                   layout->text[i], layout->scale,
+                   x, y,
+                   r, g, b);
+    }
+}
+
+// NOTE(mara): Puts the commands in drawing order: by layer, otherwise as recorded, so whatever was
+// drawn later inside a layer still ends up on top. There are only a few layers, so it's a counting
+// sort, and a frame that's already in order (the usual case, since the game draws its layers one
+// after the other) isn't copied at all.
+internal void SortRenderCommands(RenderGroup *group)
+{
+    uint32 first_command[RENDER_LAYER_COUNT + 1] = {};
+
+    bool32 is_sorted = true;
+    uint32 previous_key = 0;
+    for (uint32 command_index = 0; command_index < group->command_count; ++command_index)
+    {
+        uint32 key = group->commands[command_index].layer;
+        ++first_command[key + 1];
+        is_sorted &= (key >= previous_key);
+        previous_key = key;
+    }
+
+    if (!is_sorted)
+    {
+        for (uint32 key = 0; key < RENDER_LAYER_COUNT; ++key)
+        {
+            first_command[key + 1] += first_command[key];
+        }
+
+        for (uint32 command_index = 0; command_index < group->command_count; ++command_index)
+        {
+            RenderCommand *command = &group->commands[command_index];
+            group->sorted_commands[first_command[command->layer]++] = *command;
+        }
+
+        RenderCommand *temp = group->commands;
+        group->commands = group->sorted_commands;
+        group->sorted_commands = temp;
+    }
+}
+
+global char *render_command_type_names[RENDER_COMMAND_TYPE_COUNT] =
+{
+    "clear", "line", "smoothline", "circle", "rectangle", "outline", "glyph", "pixel",
+};
+
+global char *render_layer_names[RENDER_LAYER_COUNT] =
+{
+    "background", "backdrop", "world", "hud",
+};
+
+// NOTE(mara): One line per command, in drawing order: layer, type, color, bounds, then whatever the
+// command carries (line ends are in subpixels). Meant for diffing and grepping, not reading back in.
+internal void AppendDrawList(RenderGroup *group)
+{
+    GameDrawListDump *dump = group->draw_list_dump;
+    for (uint32 command_index = 0; command_index < group->command_count; ++command_index)
+    {
+        RenderCommand *command = &group->commands[command_index];
+
+        char parameters[64] = {};
+        switch (command->type)
+        {
+            case RENDER_COMMAND_LINE:
+            case RENDER_COMMAND_SMOOTH_LINE:
+            {
+                sprintf_s(parameters, "%d %d %d %d",
+                          command->line.x0, command->line.y0, command->line.x1, command->line.y1);
+            } break;
+
+            case RENDER_COMMAND_CIRCLE:
+            {
+                sprintf_s(parameters, "%d %d r%d", command->circle.x, command->circle.y, command->circle.radius);
+            } break;
+
+            case RENDER_COMMAND_GLYPH:
+            {
+                sprintf_s(parameters, "%d %d %dx%d", command->glyph.x, command->glyph.y,
+                          command->glyph.glyph->width, command->glyph.glyph->height);
+            } break;
+
+            case RENDER_COMMAND_PIXEL:
+            {
+                sprintf_s(parameters, "%d %d", command->pixel.x, command->pixel.y);
+            } break;
+        }
+
+        char line[160];
+        int32 line_length = sprintf_s(line, "%-10s %-10s %06x [%d %d %d %d] %s\n",
+                                      render_layer_names[command->layer],
+                                      render_command_type_names[command->type],
+                                      command->color & 0xFFFFFF,
+                                      command->bounds.min_x, command->bounds.min_y,
+                                      command->bounds.max_x, command->bounds.max_y,
+                                      parameters);
+        if (line_length > 0 && (uint32)line_length < sizeof(line) &&
+            dump->used_size + (uint32)line_length <= dump->size)
+        {
+            Copy(line_length, line, dump->memory + dump->used_size);
+            dump->used_size += line_length;
+        }
+        else
+        {
+            dump->is_truncated = true;
+        }
+    }
+}
+
+inline RenderCommand *GetBatchCommand(RenderCommand *commands, uint32 *indices, uint32 i)
+{
+    return indices ? &commands[indices[i]] : &commands[i];
+}
+
+// NOTE(mara): Draws count commands of one type: commands[indices[i]], or commands[i] when there
+// are no indices. The switch is decided once per batch and every rasterizer gets a loop of its own.
+internal void RenderBatchToOutput(GameOffscreenBuffer *buffer, GameRect *clip, SimdLevel simd_level,
+                                  uint32 type, RenderCommand *commands, uint32 *indices, uint32 count)
+{
+    switch (type)
+    {
+        case RENDER_COMMAND_CLEAR:
+        {
+            for (uint32 i = 0; i < count; ++i)
+            {
+                RenderCommand *command = GetBatchCommand(commands, indices, i);
+                RasterizeClear(buffer, clip, &command->rectangle.rect, command->color, simd_level);
+            }
+        } break;
+
+        case RENDER_COMMAND_LINE:
+        {
+            for (uint32 i = 0; i < count; ++i)
+            {
+                RenderCommand *command = GetBatchCommand(commands, indices, i);
+                RasterizeLine(buffer, clip,
+                              command->line.x0, command->line.y0,
+                              command->line.x1, command->line.y1,
+                              command->color);
+            }
+        } break;
+
+        case RENDER_COMMAND_SMOOTH_LINE:
+        {
+            for (uint32 i = 0; i < count; ++i)
+            {
+                RenderCommand *command = GetBatchCommand(commands, indices, i);
+                RasterizeSmoothLine(buffer, clip,
+                                    command->line.x0, command->line.y0,
+                                    command->line.x1, command->line.y1,
+                                    command->color);
+            }
+        } break;
+
+        case RENDER_COMMAND_CIRCLE:
+        {
+            for (uint32 i = 0; i < count; ++i)
+            {
+                RenderCommand *command = GetBatchCommand(commands, indices, i);
+                RasterizeCircle(buffer, clip,
+                                command->circle.x, command->circle.y, command->circle.radius,
+                                command->color);
+            }
+        } break;
+
+        case RENDER_COMMAND_RECTANGLE:
+        {
+            for (uint32 i = 0; i < count; ++i)
+            {
+                RenderCommand *command = GetBatchCommand(commands, indices, i);
+                RasterizeRectangle(buffer, clip, &command->rectangle.rect, command->color);
+            }
+        } break;
+
+        case RENDER_COMMAND_RECTANGLE_OUTLINE:
+        {
+            for (uint32 i = 0; i < count; ++i)
+            {
+                RenderCommand *command = GetBatchCommand(commands, indices, i);
+                RasterizeRectangleOutline(buffer, clip, &command->rectangle.rect, command->color);
+            }
+        } break;
+
+        case RENDER_COMMAND_GLYPH:
+        {
+            for (uint32 i = 0; i < count; ++i)
+            {
+                RenderCommand *command = GetBatchCommand(commands, indices, i);
+                RasterizeGlyph(buffer, clip,
+                               command->glyph.glyph, command->glyph.x, command->glyph.y,
+                               command->color, simd_level);
+            }
+        } break;
+
+        case RENDER_COMMAND_PIXEL:
+        {
+            for (uint32 i = 0; i < count; ++i)
+            {
+                RenderCommand *command = GetBatchCommand(commands, indices, i);
+                RasterizeWrappedPixel(buffer, clip, command->pixel.x, command->pixel.y, command->color);
+            }
+        } break;
+
+        default:
+        {
+            Assert(!"Unknown render command type");
+        } break;
+    }
+}
+
+// Splits the commands into runs of the same type, in their drawing order, and draws them batch by
+// batch.
+internal void RenderCommandsToOutput(GameOffscreenBuffer *buffer, GameRect *clip, SimdLevel simd_level,
+                                     RenderCommand *commands, uint32 *indices, uint32 count)
+{
+    uint32 first = 0;
+    while (first < count)
+    {
+        uint32 type = GetBatchCommand(commands, indices, first)->type;
+        uint32 end = first + 1;
+        while (end < count && GetBatchCommand(commands, indices, end)->type == type)
+        {
+            ++end;
+        }
+
+        if (indices)
+        {
+            RenderBatchToOutput(buffer, clip, simd_level, type, commands, indices + first, end - first);
+        }
+        else
+        {
+            RenderBatchToOutput(buffer, clip, simd_level, type, commands + first, 0, end - first);
+        }
+        first = end;
+    }
+}
+
+// NOTE(mara): Sorts the commands into the tiles their bounds overlap (a command hanging off an edge
+// of the torus lands in the tiles on the other side as well), keeping them in recording order within
+// every tile. Counts first, then fills, so every bin is exactly as big as it needs to be.
+internal void BinRenderCommands(RenderGroup *group, RenderTileBins *bins)
+{
+    GameOffscreenBuffer *buffer = group->buffer;
+    MemoryArena *arena = group->arena;
+
+    bins->tile_count_x = (buffer->width + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE;
+    bins->tile_count_y = (buffer->height + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE;
+    uint32 tile_count = (uint32)(bins->tile_count_x * bins->tile_count_y);
+
+    bins->first_command = PushArray(arena, tile_count + 1, uint32);
+    uint32 *next_command = PushArray(arena, tile_count, uint32);
+    uint32 *last_command = PushArray(arena, tile_count, uint32); // Stops a command landing in a tile twice.
+    for (uint32 tile_index = 0; tile_index <= tile_count; ++tile_index)
+    {
+        bins->first_command[tile_index] = 0;
+    }
+
+    bins->command_indices = 0;
+    for (int32 pass = 0; pass < 2; ++pass)
+    {
+        for (uint32 tile_index = 0; tile_index < tile_count; ++tile_index)
+        {
+            last_command[tile_index] = 0xFFFFFFFF;
+        }
+
+        for (uint32 command_index = 0; command_index < group->command_count; ++command_index)
+        {
+            GameRect *bounds = &group->commands[command_index].bounds;
+
+            int32 x_ranges[2][2];
+            int32 y_ranges[2][2];
+            int32 x_range_count = SplitWrappedRange(bounds->min_x, bounds->max_x, buffer->width, x_ranges);
+            int32 y_range_count = SplitWrappedRange(bounds->min_y, bounds->max_y, buffer->height, y_ranges);
+
+            for (int32 y_range = 0; y_range < y_range_count; ++y_range)
+            {
+                int32 first_tile_y = y_ranges[y_range][0] / RENDER_TILE_SIZE;
+                int32 last_tile_y = (y_ranges[y_range][1] - 1) / RENDER_TILE_SIZE;
+                for (int32 x_range = 0; x_range < x_range_count; ++x_range)
+                {
+                    int32 first_tile_x = x_ranges[x_range][0] / RENDER_TILE_SIZE;
+                    int32 last_tile_x = (x_ranges[x_range][1] - 1) / RENDER_TILE_SIZE;
+                    for (int32 tile_y = first_tile_y; tile_y <= last_tile_y; ++tile_y)
+                    {
+                        for (int32 tile_x = first_tile_x; tile_x <= last_tile_x; ++tile_x)
+                        {
+                            uint32 tile_index = (uint32)(tile_y * bins->tile_count_x + tile_x);
+                            if (last_command[tile_index] != command_index)
+                            {
+                                last_command[tile_index] = command_index;
+                                if (pass == 0)
+                                {
+                                    ++bins->first_command[tile_index + 1];
+                                }
+                                else
+                                {
+                                    bins->command_indices[next_command[tile_index]++] = command_index;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        if (pass == 0)
+        {
+            for (uint32 tile_index = 0; tile_index < tile_count; ++tile_index)
+            {
+                bins->first_command[tile_index + 1] += bins->first_command[tile_index];
+                next_command[tile_index] = bins->first_command[tile_index];
+            }
+            bins->command_indices = PushArray(arena, bins->first_command[tile_count], uint32);
+        }
+    }
+}
+
+internal PLATFORM_WORK_QUEUE_CALLBACK(DoRenderTileWork)
+{
+    RenderTileWork *work = (RenderTileWork *)data;
+    RenderGroup *group = work->group;
+    RenderTileBins *bins = work->bins;
+    GameOffscreenBuffer *buffer = group->buffer;
+
+    for (uint32 i = 0; i < work->tile_index_count; ++i)
+    {
+        uint32 tile_index = work->tile_indices[i];
+        int32 tile_x = (int32)tile_index % bins->tile_count_x;
+        int32 tile_y = (int32)tile_index / bins->tile_count_x;
+
+        GameRect clip;
+        clip.min_x = tile_x * RENDER_TILE_SIZE;
+        clip.min_y = tile_y * RENDER_TILE_SIZE;
+        clip.max_x = MinInt32(clip.min_x + RENDER_TILE_SIZE, buffer->width);
+        clip.max_y = MinInt32(clip.min_y + RENDER_TILE_SIZE, buffer->height);
+
+        uint32 first_command = bins->first_command[tile_index];
+        RenderCommandsToOutput(buffer, &clip, group->simd_level,
+                               group->commands, bins->command_indices + first_command,
+                               bins->first_command[tile_index + 1] - first_command);
+    }
+
+    // Any streaming stores from a clear have to land before CompleteAllWork hears this is done.
+    _mm_sfence();
+}
+
+// NOTE(mara): Tiles start every 256 bytes along a row, so as long as every row starts on a cache
+// line, two tiles never share one and the workers never have to wait on each other's writes.
+internal bool32 CanRenderInTiles(RenderGroup *group)
+{
+    GameOffscreenBuffer *buffer = group->buffer;
+    return (group->queue &&
+            buffer->bytes_per_pixel == 4 &&
+            ((memsize)buffer->memory & 63) == 0 &&
+            (buffer->pitch & 63) == 0 &&
+            (buffer->width > RENDER_TILE_SIZE || buffer->height > RENDER_TILE_SIZE));
+}
+
+// Draws every command recorded so far, then empties the group.
+internal void RenderGroupToOutput(RenderGroup *group)
+{
+    GameOffscreenBuffer *buffer = group->buffer;
+
+    SortRenderCommands(group);
+    if (group->draw_list_dump)
+    {
+        AppendDrawList(group);
+    }
+
+    if (group->is_output_skipped || group->command_count == 0)
+    {
+        // Nothing to draw.
+    }
+    else if (CanRenderInTiles(group))
+    {
+        TemporaryMemory bin_memory = BeginTemporaryMemory(group->arena);
+
+        RenderTileBins bins;
+        BinRenderCommands(group, &bins);
+
+        // Only tiles that something was drawn into are worth handing out. They're split into runs
+        // of about the same number of tiles, a few per thread (the calling one included), so whoever
+        // finishes early can help. Every entry costs a wake-up, so there are no more than that.
+        uint32 tile_count = (uint32)(bins.tile_count_x * bins.tile_count_y);
+        uint32 *used_tiles = PushArray(group->arena, tile_count, uint32);
+        uint32 used_tile_count = 0;
+        for (uint32 tile_index = 0; tile_index < tile_count; ++tile_index)
+        {
+            if (bins.first_command[tile_index + 1] > bins.first_command[tile_index])
+            {
+                used_tiles[used_tile_count++] = tile_index;
+            }
+        }
+
+        uint32 work_count = (uint32)MinInt32(RENDER_WORK_ITEMS_PER_THREAD * (MaxInt32(group->worker_count, 1) + 1),
+                                             MAX_RENDER_WORK_ITEMS);
+        work_count = (used_tile_count < work_count) ? used_tile_count : work_count;
+        RenderTileWork *work = PushArray(group->arena, work_count, RenderTileWork, 64);
+        uint32 first_tile = 0;
+        for (uint32 work_index = 0; work_index < work_count; ++work_index)
+        {
+            uint32 end_tile = (uint32)(((uint64)used_tile_count * (work_index + 1)) / work_count);
+            work[work_index].group = group;
+            work[work_index].bins = &bins;
+            work[work_index].tile_indices = used_tiles + first_tile;
+            work[work_index].tile_index_count = end_tile - first_tile;
+            first_tile = end_tile;
+
+            group->platform->AddWorkEntry(group->queue, DoRenderTileWork, &work[work_index]);
+        }
+        group->platform->CompleteAllWork(group->queue);
+
+        EndTemporaryMemory(bin_memory);
+    }
+    else
+    {
+        GameRect clip = GetBufferRect(buffer);
+        RenderCommandsToOutput(buffer, &clip, group->simd_level, group->commands, 0, group->command_count);
+    }
+
+    group->command_count = 0;
+}
+
+// =================================================================================================
+// COLLISION GRID & INTERSECTION TESTS
+// =================================================================================================
+
+// NOTE(mara): The grid lists every shape in each space its bounds overlap, bullets as circles of
+// bullet_size swept along their latest move. Two shapes that touch have a point in common, and
+// both of them are listed in that point's space, so the collision tests never need to look past
+// the space they're in.
+struct GridBuilder
+{
+    Grid *grid;
+
+    // One per listing, in the order shapes were added.
+    uint16 *keys; // space_index * GRID_LIST_TYPE_COUNT + type
+    uint16 *items;
+    int32 count;
+};
+
+// Spaces wrap around the screen edges like everything else. Bounds wider than the screen just
+// cover every space once.
+internal void AddBoundsToGrid(GridBuilder *builder, float32 min_x, float32 min_y, float32 max_x, float32 max_y,
+                              GridListType type, int32 item)
+{
+    Grid *grid = builder->grid;
+
+    int32 first_x = FloorFloat32ToInt32(min_x / grid->space_width);
+    int32 last_x = FloorFloat32ToInt32(max_x / grid->space_width);
+    if (last_x - first_x >= NUM_GRID_SPACES_H)
+    {
+        first_x = 0;
+        last_x = NUM_GRID_SPACES_H - 1;
+    }
+
+    int32 first_y = FloorFloat32ToInt32(min_y / grid->space_height);
+    int32 last_y = FloorFloat32ToInt32(max_y / grid->space_height);
+    if (last_y - first_y >= NUM_GRID_SPACES_V)
+    {
+        first_y = 0;
+        last_y = NUM_GRID_SPACES_V - 1;
+    }
 
-    // Start with the top left pixel.
-    uchar8 *src = bitmap;
-    uint8 *dest_row = ((uint8 *)buffer->memory +
-                       x * buffer->bytes_per_pixel +
-                       y * buffer->pitch);
-    for (int this_y = y; this_y < max_y; ++this_y)
+    for (int32 y = first_y; y <= last_y; ++y)
     {
-        uint32 *dest = (uint32 *)dest_row;
-        for (int this_x = x; this_x < max_x; ++this_x)
+        int32 row = WrapCoordinate(y, NUM_GRID_SPACES_V) * NUM_GRID_SPACES_H;
+        for (int32 x = first_x; x <= last_x; ++x)
+        {
+            int32 space_index = row + WrapCoordinate(x, NUM_GRID_SPACES_H);
+
+            Assert(builder->count < GRID_MAX_ENTRIES);
+            builder->keys[builder->count] = (uint16)(space_index * GRID_LIST_TYPE_COUNT + type);
+            builder->items[builder->count] = (uint16)item;
+            ++builder->count;
+        }
+    }
+}
+
+inline void AddSegmentToGrid(GridBuilder *builder, Vector2 a, Vector2 b, GridListType type, int32 item)
+{
+    AddBoundsToGrid(builder,
+                    (a.x < b.x) ? a.x : b.x, (a.y < b.y) ? a.y : b.y,
+                    (a.x < b.x) ? b.x : a.x, (a.y < b.y) ? b.y : a.y,
+                    type, item);
+}
+
+// The bounds of a circle of radius moving from one point to the other.
+inline void AddSweptCircleToGrid(GridBuilder *builder, Vector2 from, Vector2 to, float32 radius,
+                                 GridListType type, int32 item)
+{
+    AddBoundsToGrid(builder,
+                    ((from.x < to.x) ? from.x : to.x) - radius, ((from.y < to.y) ? from.y : to.y) - radius,
+                    ((from.x < to.x) ? to.x : from.x) + radius, ((from.y < to.y) ? to.y : from.y) + radius,
+                    type, item);
+}
+
+// NOTE(mara): A move that wrapped crossed a screen edge, and everything near that edge is in the
+// coordinates of its own side. So the move is swept on both sides: once as it ended up, and once
+// shifted back by wrap_offset to the side it started on. Returns how many sweeps there are.
+inline int32 GetBulletSweeps(Bullet *bullet, Vector2 *from, Vector2 *to)
+{
+    int32 result = 1;
+    from[0] = bullet->swept_from;
+    to[0] = bullet->position;
+    if (bullet->wrap_offset.x != 0.0f || bullet->wrap_offset.y != 0.0f)
+    {
+        from[1] = bullet->swept_from - bullet->wrap_offset;
+        to[1] = bullet->position - bullet->wrap_offset;
+        result = 2;
+    }
+    return result;
+}
+
+// NOTE(mara): One pass over the shapes collects (space, item) listings, then a counting sort lays
+// each space's lists out next to each other. It's stable, so every list keeps the order the shapes
+// were added in.
+internal void FillCollisionGrid(GameState *game_state, MemoryArena *arena, GameOffscreenBuffer *buffer)
+{
+    Grid *grid = &game_state->grid;
+    grid->space_width = (float32)buffer->width / (float32)NUM_GRID_SPACES_H;
+    grid->space_height = (float32)buffer->height / (float32)NUM_GRID_SPACES_V;
+    grid->listed_asteroids = 0;
+
+    TemporaryMemory listing_memory = BeginTemporaryMemory(arena);
+
+    GridBuilder builder = {};
+    builder.grid = grid;
+    builder.keys = PushArray(arena, GRID_MAX_ENTRIES, uint16);
+    builder.items = PushArray(arena, GRID_MAX_ENTRIES, uint16);
+
+    Player *player = &game_state->player;
+    int32 total_player_points = ArrayCount(player->points_global);
+    for (int32 point_index = 0; point_index < total_player_points; ++point_index)
+    {
+        AddSegmentToGrid(&builder, player->points_global[point_index],
+                         player->points_global[(point_index + 1) % total_player_points],
+                         GRID_LIST_PLAYER_EDGES, point_index);
+    }
+
+    for (int32 asteroid_index = 0; asteroid_index < ArrayCount(game_state->asteroids); ++asteroid_index)
+    {
+        Asteroid *asteroid = &game_state->asteroids[asteroid_index];
+        if (asteroid->is_active)
         {
-            uchar8 alpha = *src++;
+            for (int32 point_index = 0; point_index < MAX_ASTEROID_POINTS; ++point_index)
+            {
+                int32 edge = asteroid_index * MAX_ASTEROID_POINTS + point_index;
+                Vector2 a = asteroid->points_global[point_index];
+                Vector2 b = asteroid->points_global[(point_index + 1) % MAX_ASTEROID_POINTS];
+                AddSegmentToGrid(&builder, a, b, GRID_LIST_ASTEROID_EDGES, edge);
+
+                grid->asteroid_edges.a_x[edge] = a.x;
+                grid->asteroid_edges.a_y[edge] = a.y;
+                grid->asteroid_edges.b_x[edge] = b.x;
+                grid->asteroid_edges.b_y[edge] = b.y;
+            }
+            grid->listed_asteroids |= (1u << asteroid_index);
+        }
+    }
 
-            if (alpha != '\0')
+    for (int32 bullet_index = 0; bullet_index < MAX_BULLETS; ++bullet_index)
+    {
+        if (game_state->bullets[bullet_index].is_active)
+        {
+            Bullet *bullet = &game_state->bullets[bullet_index];
+            Vector2 from[2], to[2];
+            int32 sweep_count = GetBulletSweeps(bullet, from, to);
+            for (int32 sweep = 0; sweep < sweep_count; ++sweep)
             {
-                *dest++ = (alpha << 24) | color;
+                AddSweptCircleToGrid(&builder, from[sweep], to[sweep], game_state->bullet_size,
+                                     GRID_LIST_BULLETS, bullet_index);
             }
-            else
+        }
+        if (game_state->ufo_bullets[bullet_index].is_active)
+        {
+            Bullet *bullet = &game_state->ufo_bullets[bullet_index];
+            Vector2 from[2], to[2];
+            int32 sweep_count = GetBulletSweeps(bullet, from, to);
+            for (int32 sweep = 0; sweep < sweep_count; ++sweep)
             {
-                dest++;
+                AddSweptCircleToGrid(&builder, from[sweep], to[sweep], game_state->bullet_size,
+                                     GRID_LIST_BULLETS, MAX_BULLETS + bullet_index);
             }
         }
-        dest_row += buffer->pitch;
     }
 
-    stbtt_FreeBitmap(bitmap, 0);
+    UFO *ufo = &game_state->ufo;
+    if (ufo->is_active)
+    {
+        int32 num_ufo_points = ArrayCount(ufo->points);
+        for (int32 point_index = 0; point_index < num_ufo_points; ++point_index)
+        {
+            AddSegmentToGrid(&builder, ufo->points[point_index], ufo->points[(point_index + 1) % num_ufo_points],
+                             GRID_LIST_UFO_EDGES, point_index);
+        }
+    }
+
+    int32 first_entry[ArrayCount(grid->spaces) * GRID_LIST_TYPE_COUNT + 1] = {};
+    for (int32 listing_index = 0; listing_index < builder.count; ++listing_index)
+    {
+        ++first_entry[builder.keys[listing_index] + 1];
+    }
+    for (int32 key = 0; key < ArrayCount(grid->spaces) * GRID_LIST_TYPE_COUNT; ++key)
+    {
+        GridList *list = &grid->spaces[key / GRID_LIST_TYPE_COUNT].lists[key % GRID_LIST_TYPE_COUNT];
+        list->first_entry = first_entry[key];
+        list->count = first_entry[key + 1];
+        first_entry[key + 1] += first_entry[key];
+    }
+    for (int32 listing_index = 0; listing_index < builder.count; ++listing_index)
+    {
+        grid->entries[first_entry[builder.keys[listing_index]]++] = builder.items[listing_index];
+    }
+    grid->entry_count = builder.count;
+
+    EndTemporaryMemory(listing_memory);
 }
 
-internal void DrawString(GameOffscreenBuffer *buffer, FontData *font,
-                         char *str, uint32 str_length, float32 pixel_height,
-                         float32 start_x, float32 start_y,
-                         float32 r, float32 g, float32 b)
+inline uint16 *GetGridList(Grid *grid, GridSpace *space, GridListType type, int32 *count)
 {
-    float32 scale = stbtt_ScaleForPixelHeight(&font->stb_font_info, pixel_height);
-    int32 ascent = RoundFloat32ToInt32((float32)font->ascent * scale);
-    int32 descent = RoundFloat32ToInt32((float32)font->descent * scale);
+    *count = space->lists[type].count;
+    return grid->entries + space->lists[type].first_entry;
+}
 
-    int32 x = RoundFloat32ToInt32(start_x);
-    int32 y = RoundFloat32ToInt32(start_y);
-    y += ascent;
+// Returns 0 if the edge's asteroid has broken since the lists were built.
+inline Asteroid *GetListedAsteroid(GameState *game_state, int32 edge)
+{
+    int32 asteroid_index = edge / MAX_ASTEROID_POINTS;
+    if (!(game_state->grid.listed_asteroids & (1u << asteroid_index)))
+    {
+        return 0;
+    }
+
+    return &game_state->asteroids[asteroid_index];
+}
 
-    for (uint32 i = 0; i < str_length; ++i)
+// NOTE(mara): The broadphase's output: one bit per pair of shapes that share a space, so a pair
+// sharing several spaces is still only tested once. The narrowphase walks the bits in index order,
+// which doesn't depend on where on the grid the pairs were found.
+
+struct CollisionCandidates
+{
+    // Rows are indexed by the first shape (player edge, player bullet, UFO edge), bits by the second.
+    uint64 player_asteroid[5][COLLISION_ASTEROID_EDGE_WORDS];
+    uint64 bullet_asteroid[MAX_BULLETS][COLLISION_ASTEROID_EDGE_WORDS];
+    uint64 ufo_asteroid[8][COLLISION_ASTEROID_EDGE_WORDS];
+    uint64 player_ufo_bullet[5];
+    uint64 player_ufo[5];
+    uint64 ufo_bullet[8];
+};
+
+internal void AddAsteroidEdgeCandidates(uint64 *row, uint16 *asteroid_edges, int32 num_asteroid_edges)
+{
+    for (int32 i = 0; i < num_asteroid_edges; ++i)
     {
-        if (str[i] == '\0')
+        row[asteroid_edges[i] / 64] |= (uint64)1 << (asteroid_edges[i] % 64);
+    }
+}
+
+internal void FindCollisionCandidates(Grid *grid, CollisionCandidates *candidates)
+{
+    for (int32 space_index = 0; space_index < ArrayCount(grid->spaces); ++space_index)
+    {
+        GridSpace *space = &grid->spaces[space_index];
+
+        int32 num_asteroid_edges, num_bullets, num_ufo_edges, num_player_edges;
+        uint16 *asteroid_edges = GetGridList(grid, space, GRID_LIST_ASTEROID_EDGES, &num_asteroid_edges);
+        uint16 *bullets = GetGridList(grid, space, GRID_LIST_BULLETS, &num_bullets);
+        uint16 *ufo_edges = GetGridList(grid, space, GRID_LIST_UFO_EDGES, &num_ufo_edges);
+        uint16 *player_edges = GetGridList(grid, space, GRID_LIST_PLAYER_EDGES, &num_player_edges);
+
+        for (int32 i = 0; i < num_player_edges; ++i)
         {
-            break;
+            int32 player_point_index = player_edges[i];
+            AddAsteroidEdgeCandidates(candidates->player_asteroid[player_point_index],
+                                      asteroid_edges, num_asteroid_edges);
+            for (int32 j = 0; j < num_bullets; ++j)
+            {
+                if (bullets[j] >= MAX_BULLETS)
+                {
+                    candidates->player_ufo_bullet[player_point_index] |= (uint64)1 << (bullets[j] - MAX_BULLETS);
+                }
+            }
+            for (int32 j = 0; j < num_ufo_edges; ++j)
+            {
+                candidates->player_ufo[player_point_index] |= (uint64)1 << ufo_edges[j];
+            }
         }
-        DrawLetterFromFont(buffer, font,
-                           str[i], scale,
-                           x, y,
-                           r, g, b);
 
-        int32 advance_width, left_side_bearing;
-        stbtt_GetCodepointHMetrics(&font->stb_font_info, str[i], &advance_width, &left_side_bearing);
+        for (int32 i = 0; i < num_bullets; ++i)
+        {
+            if (bullets[i] < MAX_BULLETS)
+            {
+                AddAsteroidEdgeCandidates(candidates->bullet_asteroid[bullets[i]], asteroid_edges, num_asteroid_edges);
+            }
+        }
 
-        int32 kern = stbtt_GetCodepointKernAdvance(&font->stb_font_info, str[i], str[i + 1]);
+        for (int32 i = 0; i < num_ufo_edges; ++i)
+        {
+            int32 ufo_point_index = ufo_edges[i];
+            AddAsteroidEdgeCandidates(candidates->ufo_asteroid[ufo_point_index], asteroid_edges, num_asteroid_edges);
+            for (int32 j = 0; j < num_bullets; ++j)
+            {
+                if (bullets[j] < MAX_BULLETS)
+                {
+                    candidates->ufo_bullet[ufo_point_index] |= (uint64)1 << bullets[j];
+                }
+            }
+        }
+    }
+}
 
-        x += RoundFloat32ToInt32((float32)advance_width * scale);
-        x += RoundFloat32ToInt32((float32)kern * scale);
+// Index of the lowest set bit, which gets cleared. bits must not be 0.
+inline int32 TakeLowestSetBit(uint64 *bits)
+{
+    int32 result = FindLeastSignificantSetBit(*bits);
+    *bits &= *bits - 1;
+    return result;
+}
+
+// Grows every pair of bounding circles by a pixel, so the rounding in the shapes' global points
+// can't reject a pair that touches.
+#define COLLISION_CIRCLE_SLACK 1.0f
+
+inline bool32 TestBoundingCircles(Vector2 a, float32 radius_a, Vector2 b, float32 radius_b)
+{
+    Vector2 delta = a - b;
+    float32 reach = radius_a + radius_b + COLLISION_CIRCLE_SLACK;
+    return Dot(delta, delta) <= reach * reach;
+}
+
+// A circle around the whole of a bullet's latest move. When the move wrapped, that's a circle around
+// the box holding both of its sweeps, which is most of the screen, but it's only for one update.
+inline void GetSweptBoundingCircle(Bullet *bullet, float32 bullet_size, Vector2 *center, float32 *radius)
+{
+    Vector2 from[2], to[2];
+    if (GetBulletSweeps(bullet, from, to) == 1)
+    {
+        Vector2 move = bullet->position - bullet->swept_from;
+        center->x = bullet->swept_from.x + 0.5f * move.x;
+        center->y = bullet->swept_from.y + 0.5f * move.y;
+        *radius = bullet_size + 0.5f * Magnitude(move);
+    }
+    else
+    {
+        Vector2 points[4] = { from[0], to[0], from[1], to[1] };
+        Vector2 min = points[0];
+        Vector2 max = points[0];
+        for (int32 i = 1; i < ArrayCount(points); ++i)
+        {
+            min.x = (points[i].x < min.x) ? points[i].x : min.x;
+            min.y = (points[i].y < min.y) ? points[i].y : min.y;
+            max.x = (points[i].x > max.x) ? points[i].x : max.x;
+            max.y = (points[i].y > max.y) ? points[i].y : max.y;
+        }
+        Vector2 extent = max - min;
+        center->x = min.x + 0.5f * extent.x;
+        center->y = min.y + 0.5f * extent.y;
+        *radius = bullet_size + 0.5f * Magnitude(extent);
     }
 }
 
-internal void DrawWavyString(GameOffscreenBuffer *buffer, FontData *font, GameTime *time,
-                             char *str, uint32 str_length, float32 pixel_height,
-                             float32 start_x, float32 start_y,
-                             float32 wave_speed, float32 wave_amplitude,
-                             float32 r, float32 g, float32 b)
+// Keeps only the candidates in rows that are still set in keep, and counts what was dropped.
+inline void KeepCandidates(uint64 *rows, int32 row_count, int32 row_stride, uint64 keep,
+                           GameCollisionCounters *counters)
 {
-    float32 scale = stbtt_ScaleForPixelHeight(&font->stb_font_info, pixel_height);
-    int32 ascent = RoundFloat32ToInt32((float32)font->ascent * scale);
-    int32 descent = RoundFloat32ToInt32((float32)font->descent * scale);
+    for (int32 row_index = 0; row_index < row_count; ++row_index)
+    {
+        uint64 *row = rows + row_index * row_stride;
+        counters->candidate_pairs += CountSetBits(*row);
+        counters->rejected_pairs += CountSetBits(*row & ~keep);
+        *row &= keep;
+    }
+}
 
-    int32 x = RoundFloat32ToInt32(start_x);
+// NOTE(mara): rows are one entity's candidate rows against the asteroid edges (the player's 5 edges,
+// the UFO's 8, or a bullet). Every asteroid with a candidate in any of them gets one circle test.
+// MAX_ASTEROID_POINTS divides 64, so all of an asteroid's edges are in the same word.
+internal void RejectDistantAsteroids(GameState *game_state, uint64 *rows, int32 row_count,
+                                     Vector2 center, float32 radius, GameCollisionCounters *counters)
+{
+    uint64 asteroid_edges = ((uint64)1 << MAX_ASTEROID_POINTS) - 1;
+    for (int32 word_index = 0; word_index < COLLISION_ASTEROID_EDGE_WORDS; ++word_index)
+    {
+        uint64 remaining = 0;
+        for (int32 row_index = 0; row_index < row_count; ++row_index)
+        {
+            remaining |= rows[row_index * COLLISION_ASTEROID_EDGE_WORDS + word_index];
+        }
+        if (!remaining)
+        {
+            continue;
+        }
+
+        uint64 keep = 0;
+        while (remaining)
+        {
+            int32 lowest_edge = FindLeastSignificantSetBit(remaining);
+            int32 first_edge = lowest_edge - lowest_edge % MAX_ASTEROID_POINTS;
+            uint64 edges = asteroid_edges << first_edge;
+            remaining &= ~edges;
+
+            Asteroid *asteroid = &game_state->asteroids[(word_index * 64 + first_edge) / MAX_ASTEROID_POINTS];
+            ++counters->circle_tests;
+            if (TestBoundingCircles(center, radius, asteroid->position, asteroid->bounding_radius))
+            {
+                keep |= edges;
+            }
+        }
+
+        KeepCandidates(rows + word_index, row_count, COLLISION_ASTEROID_EDGE_WORDS, keep, counters);
+    }
+}
 
-    for (uint32 i = 0; i < str_length; ++i)
+// The same for rows whose bits are bullets.
+internal void RejectDistantBullets(Bullet *bullets, float32 bullet_size, uint64 *rows, int32 row_count,
+                                   Vector2 center, float32 radius, GameCollisionCounters *counters)
+{
+    uint64 remaining = 0;
+    for (int32 row_index = 0; row_index < row_count; ++row_index)
     {
-        if (str[i] == '\0')
+        remaining |= rows[row_index];
+    }
+    if (!remaining)
+    {
+        return;
+    }
+
+    uint64 keep = 0;
+    while (remaining)
+    {
+        int32 bullet_index = TakeLowestSetBit(&remaining);
+        Vector2 bullet_center;
+        float32 bullet_radius;
+        GetSweptBoundingCircle(&bullets[bullet_index], bullet_size, &bullet_center, &bullet_radius);
+
+        ++counters->circle_tests;
+        if (TestBoundingCircles(center, radius, bullet_center, bullet_radius))
         {
-            break;
+            keep |= (uint64)1 << bullet_index;
         }
+    }
 
-        float32 sin_value = Sin((float32)time->total_time * wave_speed + (float32)x) * wave_amplitude;
-        int32 y = RoundFloat32ToInt32(start_y + sin_value) + ascent;
+    KeepCandidates(rows, row_count, 1, keep, counters);
+}
 
-        DrawLetterFromFont(buffer, font,
-                           str[i], scale,
-                           x, y,
-                           r, g, b);
+// NOTE(mara): Between the broadphase and the narrowphase. Two shapes can only touch if their
+// entities' bounding circles do, and that's one squared distance against up to 40 (player) or 64
+// (UFO) segment tests per asteroid.
+internal void RejectDistantCandidates(GameState *game_state, CollisionCandidates *candidates,
+                                      GameCollisionCounters *counters)
+{
+    Player *player = &game_state->player;
+    UFO *ufo = &game_state->ufo;
+    float32 bullet_size = game_state->bullet_size;
 
-        int32 advance_width, left_side_bearing;
-        stbtt_GetCodepointHMetrics(&font->stb_font_info, str[i], &advance_width, &left_side_bearing);
+    RejectDistantAsteroids(game_state, candidates->player_asteroid[0], ArrayCount(candidates->player_asteroid),
+                           player->position, player->bounding_radius, counters);
+    RejectDistantAsteroids(game_state, candidates->ufo_asteroid[0], ArrayCount(candidates->ufo_asteroid),
+                           ufo->position, ufo->bounding_radius, counters);
+    for (int32 bullet_index = 0; bullet_index < MAX_BULLETS; ++bullet_index)
+    {
+        Vector2 bullet_center;
+        float32 bullet_radius;
+        GetSweptBoundingCircle(&game_state->bullets[bullet_index], bullet_size, &bullet_center, &bullet_radius);
+        RejectDistantAsteroids(game_state, candidates->bullet_asteroid[bullet_index], 1,
+                               bullet_center, bullet_radius, counters);
+    }
+
+    RejectDistantBullets(game_state->ufo_bullets, bullet_size,
+                         candidates->player_ufo_bullet, ArrayCount(candidates->player_ufo_bullet),
+                         player->position, player->bounding_radius, counters);
+    RejectDistantBullets(game_state->bullets, bullet_size,
+                         candidates->ufo_bullet, ArrayCount(candidates->ufo_bullet),
+                         ufo->position, ufo->bounding_radius, counters);
+
+    uint64 ufo_edges = 0;
+    for (int32 player_point_index = 0; player_point_index < ArrayCount(candidates->player_ufo); ++player_point_index)
+    {
+        ufo_edges |= candidates->player_ufo[player_point_index];
+    }
+    if (ufo_edges)
+    {
+        ++counters->circle_tests;
+        uint64 keep = TestBoundingCircles(player->position, player->bounding_radius,
+                                          ufo->position, ufo->bounding_radius) ? ~(uint64)0 : 0;
+        KeepCandidates(candidates->player_ufo, ArrayCount(candidates->player_ufo), 1, keep, counters);
+    }
+}
+
+// NOTE(mara): alpha and beta, how far along c-d and a-b the lines cross, are each a numerator over
+// the same denominator. Rather than dividing, the numerators are compared with the denominator
+// after flipping all three so it's positive. Parallel segments (denominator 0) never intersect,
+// collinear ones included.
+internal bool32 TestLineIntersection(Vector2 a, Vector2 b, Vector2 c, Vector2 d)
+{
+    float32 alpha_numerator = ((d.x - c.x) * (c.y - a.y)) - ((d.y - c.y) * (c.x - a.x));
+    float32 beta_numerator = ((b.x - a.x) * (c.y - a.y)) - ((b.y - a.y) * (c.x - a.x));
+    float32 denominator = ((d.x - c.x) * (b.y - a.y)) - ((d.y - c.y) * (b.x - a.x));
+    if (denominator < 0.0f)
+    {
+        alpha_numerator = -alpha_numerator;
+        beta_numerator = -beta_numerator;
+        denominator = -denominator;
+    }
+
+    // Are alpha and beta are between 0 and 1?
+    return (denominator > 0.0f &&
+            alpha_numerator >= 0.0f && alpha_numerator <= denominator &&
+            beta_numerator >= 0.0f && beta_numerator <= denominator);
+}
+
+// NOTE(mara): Past either end of the segment the closest point is that end. In between, the
+// circle's distance from the line is cross / |tangent|, which is compared squared and multiplied
+// out, so there's no square root or division.
+internal bool32 TestLineCircleIntersection(Vector2 line_a, Vector2 line_b,
+                                           Vector2 circle_pos, float32 circle_radius)
+{
+    Vector2 tangent = line_b - line_a;
+    Vector2 from_a = circle_pos - line_a;
+    Vector2 from_b = circle_pos - line_b;
+    float32 radius_squared = circle_radius * circle_radius;
+
+    if (Dot(from_a, tangent) <= 0.0f)
+    {
+        return Dot(from_a, from_a) <= radius_squared;
+    }
+    if (Dot(from_b, tangent) >= 0.0f)
+    {
+        return Dot(from_b, from_b) <= radius_squared;
+    }
+    float32 cross = tangent.x * from_a.y - tangent.y * from_a.x;
+    return cross * cross <= radius_squared * Dot(tangent, tangent);
+}
+
+// NOTE(mara): A bullet is tested along the whole of its latest move, so it can't step over an edge
+// between updates: the circle swept from one end to the other touches the segment if the bullet's
+// path crosses it, or either end is within the radius of it, or it's within the radius of either
+// end of the path. A bullet that didn't move gets just the circle test.
+internal bool32 TestSweptCircleIntersection(Vector2 line_a, Vector2 line_b,
+                                            Vector2 circle_from, Vector2 circle_to, float32 circle_radius)
+{
+    return (TestLineIntersection(circle_from, circle_to, line_a, line_b) ||
+            TestLineCircleIntersection(line_a, line_b, circle_to, circle_radius) ||
+            TestLineCircleIntersection(line_a, line_b, circle_from, circle_radius) ||
+            TestLineCircleIntersection(circle_from, circle_to, line_a, circle_radius) ||
+            TestLineCircleIntersection(circle_from, circle_to, line_b, circle_radius));
+}
 
-        int32 kern = stbtt_GetCodepointKernAdvance(&font->stb_font_info, str[i], str[i + 1]);
+// The same for every sweep of a bullet's latest move.
+internal bool32 TestBulletSweepsIntersection(Vector2 line_a, Vector2 line_b, Bullet *bullet, float32 bullet_size)
+{
+    Vector2 from[2], to[2];
+    int32 sweep_count = GetBulletSweeps(bullet, from, to);
+    for (int32 sweep = 0; sweep < sweep_count; ++sweep)
+    {
+        if (TestSweptCircleIntersection(line_a, line_b, from[sweep], to[sweep], bullet_size))
+        {
+            return true;
+        }
+    }
+    return false;
+}
 
-        x += RoundFloat32ToInt32((float32)advance_width * scale);
-        x += RoundFloat32ToInt32((float32)kern * scale);
+// Whether the circle touches any edge of the closed loop of points.
+internal bool32 TestCircleAgainstEdgeLoop(Vector2 *points, int32 count, Vector2 circle_pos, float32 circle_radius)
+{
+    for (int32 point_index = 0; point_index < count; ++point_index)
+    {
+        if (TestLineCircleIntersection(points[point_index], points[(point_index + 1) % count],
+                                       circle_pos, circle_radius))
+        {
+            return true;
+        }
     }
+    return false;
 }
 
 // =================================================================================================
-// COLLISION GRID & INTERSECTION TESTS
+// BATCHED SEGMENT TESTS
 // =================================================================================================
 
-internal void ConstructGridPartition(Grid *grid, GameOffscreenBuffer *buffer)
+// NOTE(mara): The tests above, one segment or swept circle against one candidate word of asteroid
+// edges. Only the groups of 4, 8 or 16 edges holding a candidate get tested, and what comes back is
+// the candidates that hit. Each lane does the scalar test's arithmetic in the same order (build.sh
+// turns off FMA contraction, which the AVX-512 target would otherwise allow), so every bit agrees
+// with TestLineIntersection or TestSweptCircleIntersection on the same edge.
+
+// TestLineIntersection on every lane.
+inline __m128 TestLineIntersectionSSE2(__m128 a_x, __m128 a_y, __m128 b_x, __m128 b_y,
+                                       __m128 c_x, __m128 c_y, __m128 d_x, __m128 d_y)
 {
-    grid->space_width = (float32)buffer->width / (float32)NUM_GRID_SPACES_H;
-    grid->space_height = (float32)buffer->height / (float32)NUM_GRID_SPACES_V;
-    uint32 total_spaces = NUM_GRID_SPACES_H * NUM_GRID_SPACES_V;
-    for (int i = 0; i < ArrayCount(grid->spaces); ++i)
+    __m128 zero = _mm_setzero_ps();
+    __m128 ab_x = _mm_sub_ps(b_x, a_x);
+    __m128 ab_y = _mm_sub_ps(b_y, a_y);
+    __m128 cd_x = _mm_sub_ps(d_x, c_x);
+    __m128 cd_y = _mm_sub_ps(d_y, c_y);
+    __m128 ac_x = _mm_sub_ps(c_x, a_x);
+    __m128 ac_y = _mm_sub_ps(c_y, a_y);
+
+    __m128 alpha_numerator = _mm_sub_ps(_mm_mul_ps(cd_x, ac_y), _mm_mul_ps(cd_y, ac_x));
+    __m128 beta_numerator = _mm_sub_ps(_mm_mul_ps(ab_x, ac_y), _mm_mul_ps(ab_y, ac_x));
+    __m128 denominator = _mm_sub_ps(_mm_mul_ps(cd_x, ab_y), _mm_mul_ps(cd_y, ab_x));
+
+    __m128 sign = _mm_and_ps(denominator, _mm_set1_ps(-0.0f));
+    alpha_numerator = _mm_xor_ps(alpha_numerator, sign);
+    beta_numerator = _mm_xor_ps(beta_numerator, sign);
+    denominator = _mm_xor_ps(denominator, sign);
+
+    __m128 hit = _mm_cmpgt_ps(denominator, zero);
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(alpha_numerator, zero));
+    hit = _mm_and_ps(hit, _mm_cmple_ps(alpha_numerator, denominator));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(beta_numerator, zero));
+    hit = _mm_and_ps(hit, _mm_cmple_ps(beta_numerator, denominator));
+    return hit;
+}
+
+// TestLineCircleIntersection on every lane, with the radius already squared.
+inline __m128 TestLineCircleIntersectionSSE2(__m128 a_x, __m128 a_y, __m128 b_x, __m128 b_y,
+                                             __m128 p_x, __m128 p_y, __m128 radius_squared)
+{
+    __m128 zero = _mm_setzero_ps();
+    __m128 tangent_x = _mm_sub_ps(b_x, a_x);
+    __m128 tangent_y = _mm_sub_ps(b_y, a_y);
+    __m128 from_a_x = _mm_sub_ps(p_x, a_x);
+    __m128 from_a_y = _mm_sub_ps(p_y, a_y);
+    __m128 from_b_x = _mm_sub_ps(p_x, b_x);
+    __m128 from_b_y = _mm_sub_ps(p_y, b_y);
+
+    __m128 dot_a = _mm_add_ps(_mm_mul_ps(from_a_x, tangent_x), _mm_mul_ps(from_a_y, tangent_y));
+    __m128 dot_b = _mm_add_ps(_mm_mul_ps(from_b_x, tangent_x), _mm_mul_ps(from_b_y, tangent_y));
+    __m128 distance_a = _mm_add_ps(_mm_mul_ps(from_a_x, from_a_x), _mm_mul_ps(from_a_y, from_a_y));
+    __m128 distance_b = _mm_add_ps(_mm_mul_ps(from_b_x, from_b_x), _mm_mul_ps(from_b_y, from_b_y));
+    __m128 cross = _mm_sub_ps(_mm_mul_ps(tangent_x, from_a_y), _mm_mul_ps(tangent_y, from_a_x));
+    __m128 length = _mm_add_ps(_mm_mul_ps(tangent_x, tangent_x), _mm_mul_ps(tangent_y, tangent_y));
+
+    __m128 before_a = _mm_cmple_ps(dot_a, zero);
+    __m128 after_b = _mm_cmpge_ps(dot_b, zero);
+    __m128 near_a = _mm_cmple_ps(distance_a, radius_squared);
+    __m128 near_b = _mm_cmple_ps(distance_b, radius_squared);
+    __m128 near_line = _mm_cmple_ps(_mm_mul_ps(cross, cross), _mm_mul_ps(radius_squared, length));
+
+    __m128 inside = _mm_or_ps(_mm_and_ps(after_b, near_b), _mm_andnot_ps(after_b, near_line));
+    return _mm_or_ps(_mm_and_ps(before_a, near_a), _mm_andnot_ps(before_a, inside));
+}
+
+internal uint64 TestSegmentEdgesSSE2(EdgeArrays *edges, int32 first_edge, uint64 candidates, Vector2 a, Vector2 b)
+{
+    __m128 a_x = _mm_set1_ps(a.x);
+    __m128 a_y = _mm_set1_ps(a.y);
+    __m128 b_x = _mm_set1_ps(b.x);
+    __m128 b_y = _mm_set1_ps(b.y);
+
+    uint64 hits = 0;
+    uint64 remaining = candidates;
+    while (remaining)
     {
-        uint32 north_index = WrapIndex(i - NUM_GRID_SPACES_H, total_spaces);
-        uint32 east_index = (i + 1) % NUM_GRID_SPACES_H;
-        uint32 south_index = (i + NUM_GRID_SPACES_H) % total_spaces;
-        uint32 west_index = WrapIndex(i - 1, NUM_GRID_SPACES_H);
+        int32 lane = FindLeastSignificantSetBit(remaining) & ~3;
+        int32 edge = first_edge + lane;
+        __m128 hit = TestLineIntersectionSSE2(a_x, a_y, b_x, b_y,
+                                              _mm_loadu_ps(edges->a_x + edge), _mm_loadu_ps(edges->a_y + edge),
+                                              _mm_loadu_ps(edges->b_x + edge), _mm_loadu_ps(edges->b_y + edge));
+
+        hits |= (uint64)_mm_movemask_ps(hit) << lane;
+        remaining &= ~((uint64)0xF << lane);
+    }
+
+    return hits & candidates;
+}
 
-        grid->spaces[i].north = &grid->spaces[north_index];
-        grid->spaces[i].east = &grid->spaces[east_index];
-        grid->spaces[i].south = &grid->spaces[south_index];
-        grid->spaces[i].west = &grid->spaces[west_index];
+internal uint64 TestSweptCircleEdgesSSE2(EdgeArrays *edges, int32 first_edge, uint64 candidates,
+                                         Vector2 circle_from, Vector2 circle_to, float32 circle_radius)
+{
+    __m128 from_x = _mm_set1_ps(circle_from.x);
+    __m128 from_y = _mm_set1_ps(circle_from.y);
+    __m128 to_x = _mm_set1_ps(circle_to.x);
+    __m128 to_y = _mm_set1_ps(circle_to.y);
+    __m128 radius_squared = _mm_set1_ps(circle_radius * circle_radius);
+
+    uint64 hits = 0;
+    uint64 remaining = candidates;
+    while (remaining)
+    {
+        int32 lane = FindLeastSignificantSetBit(remaining) & ~3;
+        int32 edge = first_edge + lane;
+        __m128 a_x = _mm_loadu_ps(edges->a_x + edge);
+        __m128 a_y = _mm_loadu_ps(edges->a_y + edge);
+        __m128 b_x = _mm_loadu_ps(edges->b_x + edge);
+        __m128 b_y = _mm_loadu_ps(edges->b_y + edge);
+
+        __m128 hit = TestLineIntersectionSSE2(from_x, from_y, to_x, to_y, a_x, a_y, b_x, b_y);
+        hit = _mm_or_ps(hit, TestLineCircleIntersectionSSE2(a_x, a_y, b_x, b_y, to_x, to_y, radius_squared));
+        hit = _mm_or_ps(hit, TestLineCircleIntersectionSSE2(a_x, a_y, b_x, b_y, from_x, from_y, radius_squared));
+        hit = _mm_or_ps(hit, TestLineCircleIntersectionSSE2(from_x, from_y, to_x, to_y, a_x, a_y, radius_squared));
+        hit = _mm_or_ps(hit, TestLineCircleIntersectionSSE2(from_x, from_y, to_x, to_y, b_x, b_y, radius_squared));
+
+        hits |= (uint64)_mm_movemask_ps(hit) << lane;
+        remaining &= ~((uint64)0xF << lane);
     }
+
+    return hits & candidates;
+}
+
+SIMD_TARGET_AVX2
+inline __m256 TestLineIntersectionAVX2(__m256 a_x, __m256 a_y, __m256 b_x, __m256 b_y,
+                                       __m256 c_x, __m256 c_y, __m256 d_x, __m256 d_y)
+{
+    __m256 zero = _mm256_setzero_ps();
+    __m256 ab_x = _mm256_sub_ps(b_x, a_x);
+    __m256 ab_y = _mm256_sub_ps(b_y, a_y);
+    __m256 cd_x = _mm256_sub_ps(d_x, c_x);
+    __m256 cd_y = _mm256_sub_ps(d_y, c_y);
+    __m256 ac_x = _mm256_sub_ps(c_x, a_x);
+    __m256 ac_y = _mm256_sub_ps(c_y, a_y);
+
+    __m256 alpha_numerator = _mm256_sub_ps(_mm256_mul_ps(cd_x, ac_y), _mm256_mul_ps(cd_y, ac_x));
+    __m256 beta_numerator = _mm256_sub_ps(_mm256_mul_ps(ab_x, ac_y), _mm256_mul_ps(ab_y, ac_x));
+    __m256 denominator = _mm256_sub_ps(_mm256_mul_ps(cd_x, ab_y), _mm256_mul_ps(cd_y, ab_x));
+
+    __m256 sign = _mm256_and_ps(denominator, _mm256_set1_ps(-0.0f));
+    alpha_numerator = _mm256_xor_ps(alpha_numerator, sign);
+    beta_numerator = _mm256_xor_ps(beta_numerator, sign);
+    denominator = _mm256_xor_ps(denominator, sign);
+
+    __m256 hit = _mm256_cmp_ps(denominator, zero, _CMP_GT_OQ);
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(alpha_numerator, zero, _CMP_GE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(alpha_numerator, denominator, _CMP_LE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(beta_numerator, zero, _CMP_GE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(beta_numerator, denominator, _CMP_LE_OQ));
+    return hit;
+}
+
+SIMD_TARGET_AVX2
+inline __m256 TestLineCircleIntersectionAVX2(__m256 a_x, __m256 a_y, __m256 b_x, __m256 b_y,
+                                             __m256 p_x, __m256 p_y, __m256 radius_squared)
+{
+    __m256 zero = _mm256_setzero_ps();
+    __m256 tangent_x = _mm256_sub_ps(b_x, a_x);
+    __m256 tangent_y = _mm256_sub_ps(b_y, a_y);
+    __m256 from_a_x = _mm256_sub_ps(p_x, a_x);
+    __m256 from_a_y = _mm256_sub_ps(p_y, a_y);
+    __m256 from_b_x = _mm256_sub_ps(p_x, b_x);
+    __m256 from_b_y = _mm256_sub_ps(p_y, b_y);
+
+    __m256 dot_a = _mm256_add_ps(_mm256_mul_ps(from_a_x, tangent_x), _mm256_mul_ps(from_a_y, tangent_y));
+    __m256 dot_b = _mm256_add_ps(_mm256_mul_ps(from_b_x, tangent_x), _mm256_mul_ps(from_b_y, tangent_y));
+    __m256 distance_a = _mm256_add_ps(_mm256_mul_ps(from_a_x, from_a_x), _mm256_mul_ps(from_a_y, from_a_y));
+    __m256 distance_b = _mm256_add_ps(_mm256_mul_ps(from_b_x, from_b_x), _mm256_mul_ps(from_b_y, from_b_y));
+    __m256 cross = _mm256_sub_ps(_mm256_mul_ps(tangent_x, from_a_y), _mm256_mul_ps(tangent_y, from_a_x));
+    __m256 length = _mm256_add_ps(_mm256_mul_ps(tangent_x, tangent_x), _mm256_mul_ps(tangent_y, tangent_y));
+
+    __m256 before_a = _mm256_cmp_ps(dot_a, zero, _CMP_LE_OQ);
+    __m256 after_b = _mm256_cmp_ps(dot_b, zero, _CMP_GE_OQ);
+    __m256 near_a = _mm256_cmp_ps(distance_a, radius_squared, _CMP_LE_OQ);
+    __m256 near_b = _mm256_cmp_ps(distance_b, radius_squared, _CMP_LE_OQ);
+    __m256 near_line = _mm256_cmp_ps(_mm256_mul_ps(cross, cross), _mm256_mul_ps(radius_squared, length), _CMP_LE_OQ);
+
+    __m256 inside = _mm256_or_ps(_mm256_and_ps(after_b, near_b), _mm256_andnot_ps(after_b, near_line));
+    return _mm256_or_ps(_mm256_and_ps(before_a, near_a), _mm256_andnot_ps(before_a, inside));
 }
 
-inline int32 GetGridPosition(GameOffscreenBuffer *buffer, Grid *grid, float32 x, float32 y)
+SIMD_TARGET_AVX2
+internal uint64 TestSegmentEdgesAVX2(EdgeArrays *edges, int32 first_edge, uint64 candidates, Vector2 a, Vector2 b)
 {
-    WrapFloat32PointAroundBuffer(buffer, &x, &y);
+    __m256 a_x = _mm256_set1_ps(a.x);
+    __m256 a_y = _mm256_set1_ps(a.y);
+    __m256 b_x = _mm256_set1_ps(b.x);
+    __m256 b_y = _mm256_set1_ps(b.y);
+
+    uint64 hits = 0;
+    uint64 remaining = candidates;
+    while (remaining)
+    {
+        int32 lane = FindLeastSignificantSetBit(remaining) & ~7;
+        int32 edge = first_edge + lane;
+        __m256 hit = TestLineIntersectionAVX2(a_x, a_y, b_x, b_y,
+                                              _mm256_loadu_ps(edges->a_x + edge), _mm256_loadu_ps(edges->a_y + edge),
+                                              _mm256_loadu_ps(edges->b_x + edge), _mm256_loadu_ps(edges->b_y + edge));
+
+        hits |= (uint64)_mm256_movemask_ps(hit) << lane;
+        remaining &= ~((uint64)0xFF << lane);
+    }
 
-    int32 grid_x = FloorFloat32ToInt32(x / grid->space_width);
-    int32 grid_y = FloorFloat32ToInt32(y / grid->space_height);
-    return grid_x + (grid_y * NUM_GRID_SPACES_H);
+    return hits & candidates;
 }
 
-internal int32 GetNearbyAsteroidCountFromGridSpace(GridSpace *space)
+SIMD_TARGET_AVX2
+internal uint64 TestSweptCircleEdgesAVX2(EdgeArrays *edges, int32 first_edge, uint64 candidates,
+                                         Vector2 circle_from, Vector2 circle_to, float32 circle_radius)
 {
-    int num_close_asteroids = space->num_asteroid_line_points;
-    num_close_asteroids += space->north->num_asteroid_line_points;
-    num_close_asteroids += space->north->east->num_asteroid_line_points;
-    num_close_asteroids += space->east->num_asteroid_line_points;
-    num_close_asteroids += space->south->east->num_asteroid_line_points;
-    num_close_asteroids += space->south->num_asteroid_line_points;
-    num_close_asteroids += space->south->west->num_asteroid_line_points;
-    num_close_asteroids += space->west->num_asteroid_line_points;
-    num_close_asteroids += space->north->west->num_asteroid_line_points;
-    return num_close_asteroids;
+    __m256 from_x = _mm256_set1_ps(circle_from.x);
+    __m256 from_y = _mm256_set1_ps(circle_from.y);
+    __m256 to_x = _mm256_set1_ps(circle_to.x);
+    __m256 to_y = _mm256_set1_ps(circle_to.y);
+    __m256 radius_squared = _mm256_set1_ps(circle_radius * circle_radius);
+
+    uint64 hits = 0;
+    uint64 remaining = candidates;
+    while (remaining)
+    {
+        int32 lane = FindLeastSignificantSetBit(remaining) & ~7;
+        int32 edge = first_edge + lane;
+        __m256 a_x = _mm256_loadu_ps(edges->a_x + edge);
+        __m256 a_y = _mm256_loadu_ps(edges->a_y + edge);
+        __m256 b_x = _mm256_loadu_ps(edges->b_x + edge);
+        __m256 b_y = _mm256_loadu_ps(edges->b_y + edge);
+
+        __m256 hit = TestLineIntersectionAVX2(from_x, from_y, to_x, to_y, a_x, a_y, b_x, b_y);
+        hit = _mm256_or_ps(hit, TestLineCircleIntersectionAVX2(a_x, a_y, b_x, b_y, to_x, to_y, radius_squared));
+        hit = _mm256_or_ps(hit, TestLineCircleIntersectionAVX2(a_x, a_y, b_x, b_y, from_x, from_y, radius_squared));
+        hit = _mm256_or_ps(hit, TestLineCircleIntersectionAVX2(from_x, from_y, to_x, to_y, a_x, a_y, radius_squared));
+        hit = _mm256_or_ps(hit, TestLineCircleIntersectionAVX2(from_x, from_y, to_x, to_y, b_x, b_y, radius_squared));
+
+        hits |= (uint64)_mm256_movemask_ps(hit) << lane;
+        remaining &= ~((uint64)0xFF << lane);
+    }
+
+    return hits & candidates;
 }
 
-internal int32 GetNearbyBulletCountFromGridSpace(GridSpace *space)
+// NOTE(mara): AVX-512F has no float xor (that's DQ), so the sign flip goes through the integer one.
+// Each compare only looks at the lanes the ones before it passed.
+SIMD_TARGET_AVX512
+inline __mmask16 TestLineIntersectionAVX512(__m512 a_x, __m512 a_y, __m512 b_x, __m512 b_y,
+                                            __m512 c_x, __m512 c_y, __m512 d_x, __m512 d_y)
 {
-    int32 num_close_bullets = space->num_bullets;
-    num_close_bullets += space->north->num_bullets;
-    num_close_bullets += space->north->east->num_bullets;
-    num_close_bullets += space->east->num_bullets;
-    num_close_bullets += space->south->east->num_bullets;
-    num_close_bullets += space->south->num_bullets;
-    num_close_bullets += space->south->west->num_bullets;
-    num_close_bullets += space->west->num_bullets;
-    num_close_bullets += space->north->west->num_bullets;
-    return num_close_bullets;
+    __m512 zero = _mm512_setzero_ps();
+    __m512 ab_x = _mm512_sub_ps(b_x, a_x);
+    __m512 ab_y = _mm512_sub_ps(b_y, a_y);
+    __m512 cd_x = _mm512_sub_ps(d_x, c_x);
+    __m512 cd_y = _mm512_sub_ps(d_y, c_y);
+    __m512 ac_x = _mm512_sub_ps(c_x, a_x);
+    __m512 ac_y = _mm512_sub_ps(c_y, a_y);
+
+    __m512 alpha_numerator = _mm512_sub_ps(_mm512_mul_ps(cd_x, ac_y), _mm512_mul_ps(cd_y, ac_x));
+    __m512 beta_numerator = _mm512_sub_ps(_mm512_mul_ps(ab_x, ac_y), _mm512_mul_ps(ab_y, ac_x));
+    __m512 denominator = _mm512_sub_ps(_mm512_mul_ps(cd_x, ab_y), _mm512_mul_ps(cd_y, ab_x));
+
+    __m512i sign = _mm512_and_si512(_mm512_castps_si512(denominator), _mm512_set1_epi32((int32)0x80000000));
+    alpha_numerator = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(alpha_numerator), sign));
+    beta_numerator = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(beta_numerator), sign));
+    denominator = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(denominator), sign));
+
+    __mmask16 hit = _mm512_cmp_ps_mask(denominator, zero, _CMP_GT_OQ);
+    hit = _mm512_mask_cmp_ps_mask(hit, alpha_numerator, zero, _CMP_GE_OQ);
+    hit = _mm512_mask_cmp_ps_mask(hit, alpha_numerator, denominator, _CMP_LE_OQ);
+    hit = _mm512_mask_cmp_ps_mask(hit, beta_numerator, zero, _CMP_GE_OQ);
+    hit = _mm512_mask_cmp_ps_mask(hit, beta_numerator, denominator, _CMP_LE_OQ);
+    return hit;
 }
 
-internal int32 GetNearbyUFOPointCountFromGridSpace(GridSpace *space)
+SIMD_TARGET_AVX512
+inline __mmask16 TestLineCircleIntersectionAVX512(__m512 a_x, __m512 a_y, __m512 b_x, __m512 b_y,
+                                                  __m512 p_x, __m512 p_y, __m512 radius_squared)
 {
-    int32 num_close_ufo_points = space->num_ufo_points;
-    num_close_ufo_points += space->north->num_ufo_points;
-    num_close_ufo_points += space->north->east->num_ufo_points;
-    num_close_ufo_points += space->east->num_ufo_points;
-    num_close_ufo_points += space->south->east->num_ufo_points;
-    num_close_ufo_points += space->south->num_ufo_points;
-    num_close_ufo_points += space->south->west->num_ufo_points;
-    num_close_ufo_points += space->west->num_ufo_points;
-    num_close_ufo_points += space->north->west->num_ufo_points;
-    return num_close_ufo_points;
+    __m512 zero = _mm512_setzero_ps();
+    __m512 tangent_x = _mm512_sub_ps(b_x, a_x);
+    __m512 tangent_y = _mm512_sub_ps(b_y, a_y);
+    __m512 from_a_x = _mm512_sub_ps(p_x, a_x);
+    __m512 from_a_y = _mm512_sub_ps(p_y, a_y);
+    __m512 from_b_x = _mm512_sub_ps(p_x, b_x);
+    __m512 from_b_y = _mm512_sub_ps(p_y, b_y);
+
+    __m512 dot_a = _mm512_add_ps(_mm512_mul_ps(from_a_x, tangent_x), _mm512_mul_ps(from_a_y, tangent_y));
+    __m512 dot_b = _mm512_add_ps(_mm512_mul_ps(from_b_x, tangent_x), _mm512_mul_ps(from_b_y, tangent_y));
+    __m512 distance_a = _mm512_add_ps(_mm512_mul_ps(from_a_x, from_a_x), _mm512_mul_ps(from_a_y, from_a_y));
+    __m512 distance_b = _mm512_add_ps(_mm512_mul_ps(from_b_x, from_b_x), _mm512_mul_ps(from_b_y, from_b_y));
+    __m512 cross = _mm512_sub_ps(_mm512_mul_ps(tangent_x, from_a_y), _mm512_mul_ps(tangent_y, from_a_x));
+    __m512 length = _mm512_add_ps(_mm512_mul_ps(tangent_x, tangent_x), _mm512_mul_ps(tangent_y, tangent_y));
+
+    uint32 before_a = _mm512_cmp_ps_mask(dot_a, zero, _CMP_LE_OQ);
+    uint32 after_b = _mm512_cmp_ps_mask(dot_b, zero, _CMP_GE_OQ);
+    uint32 near_a = _mm512_cmp_ps_mask(distance_a, radius_squared, _CMP_LE_OQ);
+    uint32 near_b = _mm512_cmp_ps_mask(distance_b, radius_squared, _CMP_LE_OQ);
+    uint32 near_line = _mm512_cmp_ps_mask(_mm512_mul_ps(cross, cross), _mm512_mul_ps(radius_squared, length), _CMP_LE_OQ);
+
+    uint32 inside = (after_b & near_b) | (~after_b & near_line);
+    return (__mmask16)((before_a & near_a) | (~before_a & inside));
 }
 
-internal bool32 TestLineIntersection(Vector2 a, Vector2 b, Vector2 c, Vector2 d)
+SIMD_TARGET_AVX512
+internal uint64 TestSegmentEdgesAVX512(EdgeArrays *edges, int32 first_edge, uint64 candidates, Vector2 a, Vector2 b)
 {
-    float32 alpha_numerator = ((d.x - c.x) * (c.y - a.y)) - ((d.y - c.y) * (c.x - a.x));
-    float32 beta_numerator = ((b.x - a.x) * (c.y - a.y)) - ((b.y - a.y) * (c.x - a.x));
-    float32 denominator = ((d.x - c.x) * (b.y - a.y)) - ((d.y - c.y) * (b.x - a.x));
+    __m512 a_x = _mm512_set1_ps(a.x);
+    __m512 a_y = _mm512_set1_ps(a.y);
+    __m512 b_x = _mm512_set1_ps(b.x);
+    __m512 b_y = _mm512_set1_ps(b.y);
+
+    uint64 hits = 0;
+    uint64 remaining = candidates;
+    while (remaining)
+    {
+        int32 lane = FindLeastSignificantSetBit(remaining) & ~15;
+        int32 edge = first_edge + lane;
+        __mmask16 hit = TestLineIntersectionAVX512(a_x, a_y, b_x, b_y,
+                                                   _mm512_loadu_ps(edges->a_x + edge), _mm512_loadu_ps(edges->a_y + edge),
+                                                   _mm512_loadu_ps(edges->b_x + edge), _mm512_loadu_ps(edges->b_y + edge));
+
+        hits |= (uint64)hit << lane;
+        remaining &= ~((uint64)0xFFFF << lane);
+    }
 
-    float32 alpha = alpha_numerator / denominator;
-    float32 beta = beta_numerator / denominator;
+    return hits & candidates;
+}
 
-    /*
-      if (denominator > -EPSILON && denominator < EPSILON) // denominator == 0.
-      {
-      // Parallel lines.
-
-      if (alpha_numerator - denominator >= -EPSILON && alpha_numerator - denominator <= EPSILON)  // alpha_numerator == denominator == 0.
-      {
-      // Collinear lines. We count this as an intersection.
-      //return true;
-      }
-      }
-    */
+SIMD_TARGET_AVX512
+internal uint64 TestSweptCircleEdgesAVX512(EdgeArrays *edges, int32 first_edge, uint64 candidates,
+                                           Vector2 circle_from, Vector2 circle_to, float32 circle_radius)
+{
+    __m512 from_x = _mm512_set1_ps(circle_from.x);
+    __m512 from_y = _mm512_set1_ps(circle_from.y);
+    __m512 to_x = _mm512_set1_ps(circle_to.x);
+    __m512 to_y = _mm512_set1_ps(circle_to.y);
+    __m512 radius_squared = _mm512_set1_ps(circle_radius * circle_radius);
+
+    uint64 hits = 0;
+    uint64 remaining = candidates;
+    while (remaining)
+    {
+        int32 lane = FindLeastSignificantSetBit(remaining) & ~15;
+        int32 edge = first_edge + lane;
+        __m512 a_x = _mm512_loadu_ps(edges->a_x + edge);
+        __m512 a_y = _mm512_loadu_ps(edges->a_y + edge);
+        __m512 b_x = _mm512_loadu_ps(edges->b_x + edge);
+        __m512 b_y = _mm512_loadu_ps(edges->b_y + edge);
+
+        uint32 hit = TestLineIntersectionAVX512(from_x, from_y, to_x, to_y, a_x, a_y, b_x, b_y);
+        hit |= TestLineCircleIntersectionAVX512(a_x, a_y, b_x, b_y, to_x, to_y, radius_squared);
+        hit |= TestLineCircleIntersectionAVX512(a_x, a_y, b_x, b_y, from_x, from_y, radius_squared);
+        hit |= TestLineCircleIntersectionAVX512(from_x, from_y, to_x, to_y, a_x, a_y, radius_squared);
+        hit |= TestLineCircleIntersectionAVX512(from_x, from_y, to_x, to_y, b_x, b_y, radius_squared);
+
+        hits |= (uint64)hit << lane;
+        remaining &= ~((uint64)0xFFFF << lane);
+    }
 
-    // Are alpha and beta are between 0 and 1?
-    return alpha >= 0.0f && alpha <= 1.0f && beta >= 0.0f && beta <= 1.0f;
+    return hits & candidates;
 }
 
-internal Vector2 ClosestPointOnSegmentToPoint(Vector2 line_a, Vector2 line_b, Vector2 check_point)
+// The asteroid edges in candidates (bits of candidate word word_index) that segment a-b crosses.
+internal uint64 TestSegmentAgainstEdges(EdgeArrays *edges, SimdLevel simd_level,
+                                        int32 word_index, uint64 candidates, Vector2 a, Vector2 b)
 {
-    Vector2 tangent = line_b - line_a;
-    if (Dot((check_point - line_a), tangent) <= 0.0f)
+    if (simd_level >= SIMD_LEVEL_AVX512)
     {
-        return line_a;
+        return TestSegmentEdgesAVX512(edges, word_index * 64, candidates, a, b);
     }
-    if (Dot((check_point - line_b), tangent) >= 0.0f)
+    else if (simd_level >= SIMD_LEVEL_AVX2)
     {
-        return line_b;
+        return TestSegmentEdgesAVX2(edges, word_index * 64, candidates, a, b);
     }
-    Vector2 norm_tangent = { tangent.x, tangent.y };
-    float32 mag = Magnitude(tangent);
-    norm_tangent.x *= (1.0f / mag);
-    norm_tangent.y *= (1.0f / mag);
-    Vector2 relative_pos = check_point - line_a;
-    float32 dot = Dot(norm_tangent, relative_pos);
-    Vector2 offset = { norm_tangent.x * dot, norm_tangent.y * dot };
-    return line_a + offset;
+    return TestSegmentEdgesSSE2(edges, word_index * 64, candidates, a, b);
 }
 
-internal bool32 TestLineCircleIntersection(Vector2 line_a, Vector2 line_b,
-                                           Vector2 circle_pos, float32 circle_radius)
+// The asteroid edges in candidates that the circle touches on its way from circle_from to circle_to.
+internal uint64 TestSweptCircleAgainstEdges(EdgeArrays *edges, SimdLevel simd_level,
+                                            int32 word_index, uint64 candidates,
+                                            Vector2 circle_from, Vector2 circle_to, float32 circle_radius)
 {
-    Vector2 delta = circle_pos - ClosestPointOnSegmentToPoint(line_a, line_b, circle_pos);
-    return Dot(delta, delta) <= (circle_radius * circle_radius);
+    if (simd_level >= SIMD_LEVEL_AVX512)
+    {
+        return TestSweptCircleEdgesAVX512(edges, word_index * 64, candidates, circle_from, circle_to, circle_radius);
+    }
+    else if (simd_level >= SIMD_LEVEL_AVX2)
+    {
+        return TestSweptCircleEdgesAVX2(edges, word_index * 64, candidates, circle_from, circle_to, circle_radius);
+    }
+    return TestSweptCircleEdgesSSE2(edges, word_index * 64, candidates, circle_from, circle_to, circle_radius);
 }
 
 // =================================================================================================
 // LINE GENERATION FUNCTIONS
 // =================================================================================================
 
+// Radius of the smallest circle around center that holds every point.
+internal float32 ComputeBoundingRadius(Vector2 center, Vector2 *points, int32 point_count)
+{
+    float32 max_sqr_distance = 0.0f;
+    for (int32 point_index = 0; point_index < point_count; ++point_index)
+    {
+        float32 sqr_distance = SqrMagnitude(points[point_index] - center);
+        if (sqr_distance > max_sqr_distance)
+        {
+            max_sqr_distance = sqr_distance;
+        }
+    }
+    return Sqrt(max_sqr_distance);
+}
+
 internal void ComputePlayerPointsLocal(Player *player)
 {
     player->points_local[0].x = player->forward.x * -20.0f;
@@ -593,6 +2871,9 @@ internal void ComputePlayerPointsLocal(Player *player)
 
     player->points_local[3].x = player->points_local[4].x + player->right.x * 4.0f - player->forward.x * 5.0f;
     player->points_local[3].y = player->points_local[4].y + player->right.y * 4.0f - player->forward.y * 5.0f;
+
+    // Turning doesn't change how far the points are from the centre.
+    player->bounding_radius = ComputeBoundingRadius({}, player->points_local, ArrayCount(player->points_local));
 }
 
 internal void ComputePlayerPointsGlobal(Player *player)
@@ -706,6 +2987,7 @@ internal int32 GenerateAsteroid(GameState *game_state,
         offset_diff.y *= min_distance;
         asteroid->position = asteroid->position + offset_diff;
     }
+    asteroid->previous_position = asteroid->position;
 
     // Forward direction.
     int32 rand_direction_angle = RandomInt32InRange(&game_state->random, 0, 360);
@@ -727,6 +3009,8 @@ internal int32 GenerateAsteroid(GameState *game_state,
         asteroid->points_local[point].x = Cos(point_radians_around_circle) * (float32)rand_offset_for_point;
         asteroid->points_local[point].y = Sin(point_radians_around_circle) * (float32)rand_offset_for_point;
     }
+    asteroid->bounding_radius = ComputeBoundingRadius({}, asteroid->points_local, MAX_ASTEROID_POINTS);
+    ComputeAsteroidLines(asteroid);
 
     // Speed.
     asteroid->speed = game_state->asteroid_phase_speeds[asteroid->phase_index];
@@ -755,10 +3039,15 @@ internal void BreakAsteroid(GameState *game_state, GameOffscreenBuffer *buffer,
         game_state->asteroids[a_slot].position.y = original_position.y;
         game_state->asteroids[b_slot].position.x = original_position.x;
         game_state->asteroids[b_slot].position.y = original_position.y;
+        game_state->asteroids[a_slot].previous_position = asteroid->previous_position;
+        game_state->asteroids[b_slot].previous_position = asteroid->previous_position;
+        ComputeAsteroidLines(&game_state->asteroids[a_slot]);
+        ComputeAsteroidLines(&game_state->asteroids[b_slot]);
     }
 
     game_state->num_active_asteroids--;
     asteroid->is_active = false; // Setting this to false means it won't get drawn.
+    game_state->grid.listed_asteroids &= ~(1u << (asteroid - game_state->asteroids));
 }
 
 internal void ResetAsteroidPhaseSpeeds(GameState *game_state)
@@ -865,7 +3154,7 @@ internal void TeleportPlayerToSafeLocationOnGrid(GameState *game_state, Grid *gr
     int32 rand_space_index = RandomInt32InRange(&game_state->random, 0, total_spaces - 1);
 
     // Keep walking up the indices from this point until we find a free space in the grid.
-    while (grid->spaces[rand_space_index].num_asteroid_line_points > 0)
+    while (grid->spaces[rand_space_index].lists[GRID_LIST_ASTEROID_EDGES].count > 0)
     {
         rand_space_index = (rand_space_index + 1) % total_spaces;
     }
@@ -878,6 +3167,7 @@ internal void TeleportPlayerToSafeLocationOnGrid(GameState *game_state, Grid *gr
 
     player->position.x = x;
     player->position.y = y;
+    player->previous_position = player->position;
 }
 
 internal void HandlePlayerDeath(GameState *game_state, Player *player)
@@ -923,11 +3213,13 @@ internal void EnterNewHighScore(GameState *game_state, char *name, int32 score)
     }
 }
 
-internal void ResetDynamicGameStateValues(GameState *game_state, GameOffscreenBuffer *buffer)
+// NOTE(mara): Only the very first game is seeded from the clock. Every game after that is seeded
+// from the current random state, so a restored snapshot always plays out the same way.
+internal void ResetDynamicGameStateValues(GameState *game_state, GameOffscreenBuffer *buffer, int64 seed)
 {
     game_state->phase = GAME_PHASE_ATTRACT_MODE;
     game_state->random = {};
-    SeedRandom(&game_state->random, std::time(NULL));
+    SeedRandom(&game_state->random, seed);
     game_state->score = 0;
     game_state->level = 0;
 
@@ -935,6 +3227,7 @@ internal void ResetDynamicGameStateValues(GameState *game_state, GameOffscreenBu
     Player *player = &game_state->player;
     player->position.x = (float32)buffer->width / 2.0f;
     player->position.y = (float32)buffer->height / 2.0f;
+    player->previous_position = player->position;
     player->forward.x = 0.0f;
     player->forward.y = 1.0f;
     player->right.x = 1.0f;
@@ -962,7 +3255,6 @@ internal void ResetDynamicGameStateValues(GameState *game_state, GameOffscreenBu
     for (int i = 0; i < game_state->num_asteroids_at_start; ++i)
     {
         GenerateAsteroid(game_state, buffer, 2);
-        ComputeAsteroidLines(&game_state->asteroids[i]);
     }
 
     // UFO
@@ -972,14 +3264,112 @@ internal void ResetDynamicGameStateValues(GameState *game_state, GameOffscreenBu
 }
 
 // =================================================================================================
-// GAME UPDATE AND RENDER (GUAR)
+// RENDER BLENDING
+// =================================================================================================
+
+// NOTE(mara): Entities store their geometry for the latest update only, so instead of blending every
+// point we shift the whole thing back along the path it travelled during that update.
+internal Vector2 GetRenderBlendOffset(GameOffscreenBuffer *buffer, GameTime *time,
+                                     Vector2 previous_position, Vector2 position)
+{
+    Vector2 result = {};
+
+    // If the entity wrapped around the screen (or teleported) it didn't actually travel this far,
+    // so just draw it where it is now.
+    Vector2 travelled = position - previous_position;
+    if (Abs(travelled.x) < (float32)buffer->width / 2.0f &&
+        Abs(travelled.y) < (float32)buffer->height / 2.0f)
+    {
+        float32 t = (float32)time->render_blend - 1.0f;
+        result.x = travelled.x * t;
+        result.y = travelled.y * t;
+    }
+
+    return result;
+}
+
+// =================================================================================================
+// TRANSIENT STATE
+// =================================================================================================
+
+internal uint64 GetTransientStateWriterId(TransientState *transient_state)
+{
+    return (uint64)(size_t)transient_state;
+}
+
+// NOTE(mara): Marks the GameState as written by this TransientState, with a generation it has never
+// handed out before.
+internal void StampGameState(GameState *game_state, TransientState *transient_state)
+{
+    game_state->writer_id = GetTransientStateWriterId(transient_state);
+    game_state->write_generation = ++transient_state->write_generation;
+}
+
+// NOTE(mara): Rebuilds the TransientState whenever the GameState in the permanent storage isn't the
+// one it stamped last, e.g. after a GameState was copied into this memory to restore or clone a
+// world. The loops that were playing are dropped along with the old SoundStreams, so their ids are
+// too.
+internal void PrepareTransientState(GameMemory *memory)
+{
+    GameState *game_state = (GameState *)memory->permanent_storage;
+    TransientState *transient_state = (TransientState *)memory->transient_storage;
+
+    if (!transient_state->is_initialized ||
+        transient_state->permanent_storage_base != memory->permanent_storage ||
+        game_state->writer_id != GetTransientStateWriterId(transient_state) ||
+        game_state->write_generation != transient_state->write_generation)
+    {
+        InitializeArena(&transient_state->arena,
+                        memory->transient_storage_size - sizeof(TransientState),
+                        (uint8 *)memory->transient_storage + sizeof(TransientState));
+
+        transient_state->font = {};
+        if (game_state->font_asset.ttf_size)
+        {
+            transient_state->font = InitializeFont(GetStateMemory(game_state,
+                                                                  game_state->font_asset.ttf_offset),
+                                                   &transient_state->arena);
+        }
+
+        // NOTE(mara): The platform may still be playing streams started by the GameState that was
+        // here before, so they're stopped rather than cleared, and their slots stay in use until the
+        // platform lets go of them. Their ids are dropped, since the GameState hands them out again.
+        for (int32 i = 0; i < MAX_SOUND_STREAMS; ++i)
+        {
+            SoundStream *sound_stream = &transient_state->sound_streams[i];
+            sound_stream->id = 0;
+            sound_stream->force_stop = true;
+        }
+        transient_state->next_sound_stream_index = 0;
+        transient_state->has_previous_frame = false;
+        transient_state->simd_level = DetectSimdLevel();
+        game_state->thrust_loop_id = 0;
+        game_state->ufo_loop_id = 0;
+
+        // NOTE(mara): Skipping past the generation the GameState came in with means a stamp this
+        // TransientState has seen is never handed out again, even one some other run wrote.
+        if (transient_state->write_generation < game_state->write_generation)
+        {
+            transient_state->write_generation = game_state->write_generation;
+        }
+        StampGameState(game_state, transient_state);
+
+        transient_state->permanent_storage_base = memory->permanent_storage;
+        transient_state->is_initialized = true;
+    }
+}
+
+// =================================================================================================
+// GAME UPDATE
 // =================================================================================================
 
 // Function Signature:
-// GameUpdateAndRender(GameMemory *memory, GameTime *time, GameInput *input, GameOffscreenBuffer *buffer, GameSoundOutput *game_sound)
-extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
+// GameUpdate(GameMemory *memory, GameTime *time, GameInput *input, GameOffscreenBuffer *buffer, GameSoundOutput *game_sound)
+extern "C" GAME_UPDATE(GameUpdate)
 {
-    global_platform = memory->platform_api;
+    // NOTE(mara): The game keeps no process-wide state of its own. Everything it needs lives in
+    // the GameMemory it's handed, so one process can step any number of independent worlds.
+    PlatformAPI *platform = &memory->platform_api;
 
     Assert(sizeof(GameState) <= memory->permanent_storage_size);
     Assert(sizeof(TransientState) <= memory->transient_storage_size);
@@ -991,59 +3381,59 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
     UFO *ufo = &game_state->ufo;
     Grid *grid = &game_state->grid;
 
-    if (!memory->is_initialized)
+    if (!game_state->is_initialized)
     {
-        InitializeArena(&transient_state->arena,
-                        memory->permanent_storage_size - sizeof(TransientState),
-                        (uint8 *)memory->transient_storage + sizeof(TransientState));
-
-        InitializeArena(&game_state->sound_arena,
+        // NOTE(mara): Assets are copied into the rest of the permanent storage, right behind the
+        // GameState, and only their offsets are kept. Nothing needs to remember the arena itself.
+        MemoryArena asset_arena = {};
+        InitializeArena(&asset_arena,
                         memory->permanent_storage_size - sizeof(GameState),
                         (uint8 *)memory->permanent_storage + sizeof(GameState));
 
         /*
-        game_state->sounds[0] = LoadSound(&game_state->sound_arena, "sounds/bangSmall.ogg");
-        game_state->sounds[1] = LoadSound(&game_state->sound_arena, "sounds/bangMedium.ogg");
-        game_state->sounds[2] = LoadSound(&game_state->sound_arena, "sounds/bangLarge.ogg");
-        game_state->sounds[3] = LoadSound(&game_state->sound_arena, "sounds/beat1.ogg");
-        game_state->sounds[4] = LoadSound(&game_state->sound_arena, "sounds/beat2.ogg");
-        game_state->sounds[5] = LoadSound(&game_state->sound_arena, "sounds/extraShip.ogg");
-        game_state->sounds[6] = LoadSound(&game_state->sound_arena, "sounds/fire.ogg");
-        game_state->sounds[7] = LoadSound(&game_state->sound_arena, "sounds/saucerBig.ogg");
-        game_state->sounds[8] = LoadSound(&game_state->sound_arena, "sounds/saucerSmall.ogg");
-        game_state->sounds[9] = LoadSound(&game_state->sound_arena, "sounds/thrust.ogg");
-        game_state->sounds[10] = LoadSound(&game_state->sound_arena, "sounds/song.ogg");
+        game_state->sounds[0] = LoadSound(&asset_arena, "sounds/bangSmall.ogg");
+        game_state->sounds[1] = LoadSound(&asset_arena, "sounds/bangMedium.ogg");
+        game_state->sounds[2] = LoadSound(&asset_arena, "sounds/bangLarge.ogg");
+        game_state->sounds[3] = LoadSound(&asset_arena, "sounds/beat1.ogg");
+        game_state->sounds[4] = LoadSound(&asset_arena, "sounds/beat2.ogg");
+        game_state->sounds[5] = LoadSound(&asset_arena, "sounds/extraShip.ogg");
+        game_state->sounds[6] = LoadSound(&asset_arena, "sounds/fire.ogg");
+        game_state->sounds[7] = LoadSound(&asset_arena, "sounds/saucerBig.ogg");
+        game_state->sounds[8] = LoadSound(&asset_arena, "sounds/saucerSmall.ogg");
+        game_state->sounds[9] = LoadSound(&asset_arena, "sounds/thrust.ogg");
+        game_state->sounds[10] = LoadSound(&asset_arena, "sounds/song.ogg");
         */
 
-        game_state->sounds[0] = LoadSoundWAV(&game_state->sound_arena, "sounds/bangSmall.wav");
-        game_state->sounds[1] = LoadSoundWAV(&game_state->sound_arena, "sounds/bangMedium.wav");
-        game_state->sounds[2] = LoadSoundWAV(&game_state->sound_arena, "sounds/bangLarge.wav");
-        game_state->sounds[3] = LoadSoundWAV(&game_state->sound_arena, "sounds/beat1.wav");
-        game_state->sounds[4] = LoadSoundWAV(&game_state->sound_arena, "sounds/beat2.wav");
-        game_state->sounds[5] = LoadSoundWAV(&game_state->sound_arena, "sounds/extraShip.wav");
-        game_state->sounds[6] = LoadSoundWAV(&game_state->sound_arena, "sounds/fire.wav");
-        game_state->sounds[7] = LoadSoundWAV(&game_state->sound_arena, "sounds/saucerBig.wav");
-        game_state->sounds[8] = LoadSoundWAV(&game_state->sound_arena, "sounds/saucerSmall.wav");
-        game_state->sounds[9] = LoadSoundWAV(&game_state->sound_arena, "sounds/thrust.wav");
-        game_state->sounds[10] = LoadSoundWAV(&game_state->sound_arena, "sounds/song.wav");
+        game_state->sounds[0] = LoadSoundWAV(platform, &asset_arena, game_state, "sounds/bangSmall.wav");
+        game_state->sounds[1] = LoadSoundWAV(platform, &asset_arena, game_state, "sounds/bangMedium.wav");
+        game_state->sounds[2] = LoadSoundWAV(platform, &asset_arena, game_state, "sounds/bangLarge.wav");
+        game_state->sounds[3] = LoadSoundWAV(platform, &asset_arena, game_state, "sounds/beat1.wav");
+        game_state->sounds[4] = LoadSoundWAV(platform, &asset_arena, game_state, "sounds/beat2.wav");
+        game_state->sounds[5] = LoadSoundWAV(platform, &asset_arena, game_state, "sounds/extraShip.wav");
+        game_state->sounds[6] = LoadSoundWAV(platform, &asset_arena, game_state, "sounds/fire.wav");
+        game_state->sounds[7] = LoadSoundWAV(platform, &asset_arena, game_state, "sounds/saucerBig.wav");
+        game_state->sounds[8] = LoadSoundWAV(platform, &asset_arena, game_state, "sounds/saucerSmall.wav");
+        game_state->sounds[9] = LoadSoundWAV(platform, &asset_arena, game_state, "sounds/thrust.wav");
+        game_state->sounds[10] = LoadSoundWAV(platform, &asset_arena, game_state, "sounds/song.wav");
 
         game_state->beat_sound_countdown_time_min = 0.3f;
         game_state->beat_sound_countdown_time_max = 1.25f;
         game_state->beat_sound_countdown_decrement_amount = 0.01f;
         game_state->beat_sound_countdown_time = game_state->beat_sound_countdown_time_max;
 
-        ConstructGridPartition(grid, buffer);
-
-        game_state->font = LoadFont();
+        game_state->font_asset = LoadFontAsset(platform, &asset_arena, game_state);
 
         game_state->num_lives_at_start = 4;
 
         // Player configuration.
         player->rotation_speed = 6.0f;
-        player->maximum_velocity = 4.5f;
+        // NOTE(mara): Velocity is in pixels per second and the damping factor is what's left of the
+        // velocity after one second of coasting. These match the old per-frame tuning (4.5 px,
+        // 0.98 per frame) at 60Hz, but no longer depend on the update rate.
+        player->maximum_velocity = 270.0f;
         player->thrust_factor = 128.0f;
-        player->acceleration = 0.14f;
-        player->speed_damping_factor = 0.98f;
+        player->acceleration = 8.4f;
+        player->speed_damping_factor = 0.2976f;
         player->color_r = 1.0f;
         player->color_g = 1.0f;
         player->color_b = 0.0f;
@@ -1093,7 +3483,7 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
         ufo->color_g = 0.94f;
         ufo->color_b = 0.94f;
 
-        ResetDynamicGameStateValues(game_state, buffer);
+        ResetDynamicGameStateValues(game_state, buffer, std::time(NULL));
 
         // Particle system configuration.
         for (int i = 0; i < ArrayCount(game_state->particle_system_splash); ++i)
@@ -1113,7 +3503,7 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
         lines->num_particles = ArrayCount(player->points_local);
 
         // Load the high scores.
-        ReadFileResult result = global_platform.ReadEntireFile("highscores.ahs");
+        ReadFileResult result = platform->ReadEntireFile("highscores.ahs");
         if (result.content_size > 0)
         {
             HighScore *scores = (HighScore *)result.content;
@@ -1133,18 +3523,34 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
         game_state->entered_name[1] = ' ';
         game_state->entered_name[2] = ' ';
 
-        memory->is_initialized = true;
+        game_state->is_initialized = true;
     }
 
-    if (!memory->is_initialized)
+    if (!game_state->is_initialized)
     {
         return;
     }
 
+    PrepareTransientState(memory);
+    StampGameState(game_state, transient_state);
+
     CheckArenaForLingeringTemporaryMemory(&transient_state->arena);
 
     float32 delta_time = (float32)time->delta_time;
 
+    // Remember where everything started this update so that GameRender can blend between updates.
+    player->previous_position = player->position;
+    ufo->previous_position = ufo->position;
+    for (int i = 0; i < MAX_BULLETS; ++i)
+    {
+        game_state->bullets[i].previous_position = game_state->bullets[i].position;
+        game_state->ufo_bullets[i].previous_position = game_state->ufo_bullets[i].position;
+    }
+    for (int i = 0; i < MAX_ASTEROIDS; ++i)
+    {
+        game_state->asteroids[i].previous_position = game_state->asteroids[i].position;
+    }
+
     // =============================================================================================
     // INPUT PROCESSING
     // =============================================================================================
@@ -1161,9 +3567,9 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
             {
                 move_input_y = -1.0f;
 
-                if (!game_state->thrust_loop)
+                if (!game_state->thrust_loop_id)
                 {
-                    game_state->thrust_loop = PlaySound(game_state, game_sound, SOUND_THRUST, 0.25f, true);
+                    game_state->thrust_loop_id = PlaySound(game_state, transient_state, game_sound, SOUND_THRUST, 0.25f, true);
                 }
 
                 if (controller->move_up.half_transition_count > 0)
@@ -1205,10 +3611,10 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
 
             if (!controller->move_up.ended_down &&
                 controller->move_up.half_transition_count != 0 &&
-                game_state->thrust_loop)
+                game_state->thrust_loop_id)
             {
-                StopSound(game_state->thrust_loop);
-                game_state->thrust_loop = 0;
+                StopSound(transient_state, game_state->thrust_loop_id);
+                game_state->thrust_loop_id = 0;
             }
         }
     }
@@ -1235,6 +3641,8 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
     // PLAYER UPDATE
     // =============================================================================================
 
+    player->show_thrust_fire = (move_input_x != 0.0f || move_input_y != 0.0f);
+
     if (game_state->phase == GAME_PHASE_PLAY)
     {
         // Calculate the player's position.
@@ -1264,11 +3672,12 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
             player->velocity.y *= player->maximum_velocity;
         }
 
-        player->velocity.x *= player->speed_damping_factor;
-        player->velocity.y *= player->speed_damping_factor;
+        float32 damping = Pow(player->speed_damping_factor, delta_time);
+        player->velocity.x *= damping;
+        player->velocity.y *= damping;
 
-        player->position.x += player->velocity.x;
-        player->position.y += player->velocity.y;
+        player->position.x += player->velocity.x * delta_time;
+        player->position.y += player->velocity.y * delta_time;
         WrapFloat32PointAroundBuffer(buffer, &player->position.x, &player->position.y);
 
         if (player->death_timer >= 0.0f)
@@ -1368,7 +3777,7 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
         }
         else
         {
-            ResetDynamicGameStateValues(game_state, buffer);
+            ResetDynamicGameStateValues(game_state, buffer, RandomInt64(&game_state->random));
         }
     }
 
@@ -1380,7 +3789,7 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
         game_state->beat_sound_countdown -= delta_time;
         if (game_state->beat_sound_countdown <= 0.0f)
         {
-            PlaySound(game_state, game_sound,
+            PlaySound(game_state, transient_state, game_sound,
                       game_state->beat_sound_countdown_flip ? SOUND_BEAT_2 : SOUND_BEAT_1,
                       0.4f);
             game_state->beat_sound_countdown_flip = !game_state->beat_sound_countdown_flip;
@@ -1455,9 +3864,9 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
             {
                 EnterNewHighScore(game_state, game_state->entered_name, game_state->score);
 
-                global_platform.WriteEntireFile("highscores.ahs", sizeof(HighScore) * MAX_HIGH_SCORES, game_state->high_scores);
+                platform->WriteEntireFile("highscores.ahs", sizeof(HighScore) * MAX_HIGH_SCORES, game_state->high_scores);
 
-                ResetDynamicGameStateValues(game_state, buffer);
+                ResetDynamicGameStateValues(game_state, buffer, RandomInt64(&game_state->random));
             }
             else
             {
@@ -1470,433 +3879,234 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
     // COLLISION TESTING
     // =============================================================================================
 
-    // Clear the grid.
-    for (int i = 0; i < ArrayCount(game_state->grid.spaces); ++i)
-    {
-        game_state->grid.spaces[i].num_asteroid_line_points = 0;
-        game_state->grid.spaces[i].num_bullets = 0;
-        game_state->grid.spaces[i].num_ufo_points = 0;
-        game_state->grid.spaces[i].has_player = false;
-    }
+    FillCollisionGrid(game_state, &transient_state->arena, buffer);
 
-    // Update grid spaces with player positions.
-    uint32 space_index = 0;
-    for (int point_index = 0; point_index < ArrayCount(player->points_global); ++point_index)
+    // NOTE(mara): Broadphase, bounding circles, then narrowphase. Each candidate pair is tested
+    // once, and anything it hit is gone by the time a later pair would test it (or the player is
+    // invulnerable), so no collision counts twice. Asteroid edges are tested a candidate word at a
+    // time; an asteroid that breaks doesn't move the others, so a word's hits stay right while
+    // they're handled.
+    // Bullets are swept along their latest move, which at 30Hz is ~20 pixels, more than a bullet
+    // is wide, so a lower tick rate doesn't let them pass through what they'd hit at 60Hz.
+    if (game_state->phase == GAME_PHASE_PLAY)
     {
-        Vector2 *point = &player->points_global[point_index];
-        space_index = GetGridPosition(buffer, &game_state->grid, point->x, point->y);
-        game_state->grid.spaces[space_index].has_player = true;
-    }
+        CollisionCandidates candidates = {};
+        FindCollisionCandidates(grid, &candidates);
 
-    // Update grid spaces with asteroid positions.
-    for (int32 asteroid_index = 0; asteroid_index < ArrayCount(game_state->asteroids); ++asteroid_index)
-    {
-        Asteroid *asteroid = &game_state->asteroids[asteroid_index];
+        GameCollisionCounters collision_counters = {};
+        RejectDistantCandidates(game_state, &candidates, &collision_counters);
 
-        if (asteroid->is_active)
-        {
-            for (int point_index = 0; point_index < MAX_ASTEROID_POINTS; ++point_index)
-            {
-                Vector2 *point = &asteroid->points_global[point_index];
-                space_index = GetGridPosition(buffer, &game_state->grid, point->x, point->y);
-                game_state->grid.spaces[space_index].num_asteroid_line_points++;
-            }
-        }
-    }
+        int32 total_player_points = ArrayCount(player->points_global);
+        int32 num_ufo_points = ArrayCount(ufo->points);
 
-    // Update grid spaces with bullet positions.
-    for (int bullet_index = 0; bullet_index < ArrayCount(game_state->bullets); ++bullet_index)
-    {
-        Bullet *bullet = &game_state->bullets[bullet_index];
-        if (bullet->is_active)
+        // Test Collision Player - Asteroid
+        for (int32 player_point_index = 0; player_point_index < total_player_points; ++player_point_index)
         {
-            space_index = GetGridPosition(buffer, &game_state->grid, bullet->position.x, bullet->position.y);
-            game_state->grid.spaces[space_index].num_bullets++;
-        }
-    }
+            Vector2 player_a = player->points_global[player_point_index];
+            Vector2 player_b = player->points_global[(player_point_index + 1) % total_player_points];
+            for (int32 word_index = 0; word_index < COLLISION_ASTEROID_EDGE_WORDS; ++word_index)
+            {
+                uint64 edges = candidates.player_asteroid[player_point_index][word_index];
+                if (edges && player->invuln_timer <= 0.0f)
+                {
+                    edges = TestSegmentAgainstEdges(&grid->asteroid_edges, transient_state->simd_level,
+                                                    word_index, edges, player_a, player_b);
+                }
+                while (edges && player->invuln_timer <= 0.0f)
+                {
+                    Asteroid *asteroid = GetListedAsteroid(game_state, word_index * 64 + TakeLowestSetBit(&edges));
+                    if (asteroid)
+                    {
+                        // Increment our score.
+                        game_state->score += game_state->asteroid_phase_point_values[asteroid->phase_index];
 
-    for (int bullet_index = 0; bullet_index < ArrayCount(game_state->ufo_bullets); ++bullet_index)
-    {
-        Bullet *bullet = &game_state->ufo_bullets[bullet_index];
-        if (bullet->is_active)
-        {
-            space_index = GetGridPosition(buffer, &game_state->grid, bullet->position.x, bullet->position.y);
-            game_state->grid.spaces[space_index].num_bullets++;
-        }
-    }
+                        PlaySound(game_state, transient_state, game_sound, (SoundID)asteroid->phase_index);
+                        BreakAsteroid(game_state, buffer, asteroid);
 
-    // Update grid spaces with ufo positions.
-    if (ufo->is_active)
-    {
-        for (int point_index = 0; point_index < ArrayCount(ufo->points); ++point_index)
-        {
-            space_index = GetGridPosition(buffer, &game_state->grid,
-                                          ufo->points[point_index].x, ufo->points[point_index].y);
-            game_state->grid.spaces[space_index].num_ufo_points++;
+                        EmitSplashParticles(game_state, player->position.x, player->position.y);
+                        HandlePlayerDeath(game_state, player);
+                    }
+                }
+            }
         }
-    }
 
-    // Iterate through the spaces and perform discrete collision testing ONLY if spaces within a
-    // certain distance contain objects that are concerned with each other.
-    if (game_state->phase == GAME_PHASE_PLAY)
-    {
-        int32 total_spaces = ArrayCount(game_state->grid.spaces);
-        for (int i = 0; i < total_spaces; ++i)
+        // Test Collision Player - Bullet (from UFO).
+        for (int32 player_point_index = 0; player_point_index < total_player_points; ++player_point_index)
         {
-            GridSpace *space = &grid->spaces[i];
+            Vector2 player_a = player->points_global[player_point_index];
+            Vector2 player_b = player->points_global[(player_point_index + 1) % total_player_points];
 
-            if (space->has_player && player->invuln_timer <= 0.0f)
+            uint64 ufo_bullets = candidates.player_ufo_bullet[player_point_index];
+            while (ufo_bullets && player->invuln_timer <= 0.0f)
             {
-                if (GetNearbyAsteroidCountFromGridSpace(space) > 0)
+                Bullet *bullet = &game_state->ufo_bullets[TakeLowestSetBit(&ufo_bullets)];
+                if (bullet->is_active && !bullet->is_friendly &&
+                    TestBulletSweepsIntersection(player_a, player_b, bullet, game_state->bullet_size))
                 {
-                    // Test Collision Player - Asteroid
-                    int32 total_player_points = ArrayCount(player->points_global);
-                    for (int player_point_index = 0; player_point_index < total_player_points; ++player_point_index)
+                    if (!TestCircleAgainstEdgeLoop(player->points_global, total_player_points,
+                                                   bullet->position, game_state->bullet_size))
                     {
-                        int next_player_point_index = (player_point_index + 1) % total_player_points;
-                        for (int asteroid_index = 0; asteroid_index < ArrayCount(game_state->asteroids); ++asteroid_index)
-                        {
-                            if (game_state->asteroids[asteroid_index].is_active)
-                            {
-                                Asteroid *asteroid = &game_state->asteroids[asteroid_index];
-                                int32 total_asteroid_points = ArrayCount(asteroid->points_global);
-                                for (int asteroid_point_index = 0; asteroid_point_index < total_asteroid_points; ++asteroid_point_index)
-                                {
-                                    int32 next_asteroid_point_index = (asteroid_point_index + 1) % total_asteroid_points;
-                                    if (TestLineIntersection(player->points_global[player_point_index],
-                                                             player->points_global[next_player_point_index],
-                                                             asteroid->points_global[asteroid_point_index],
-                                                             asteroid->points_global[next_asteroid_point_index]))
-                                    {
-                                        // Increment our score.
-                                        game_state->score += game_state->asteroid_phase_point_values[asteroid->phase_index];
-
-                                        PlaySound(game_state, game_sound, (SoundID)asteroid->phase_index);
-                                        BreakAsteroid(game_state, buffer, asteroid);
-
-                                        EmitSplashParticles(game_state, player->position.x, player->position.y);
-                                        HandlePlayerDeath(game_state, player);
-
-                                        break;
-                                    }
-                                }
-                            }
-                        }
+                        ++collision_counters.swept_hits;
                     }
-                }
-
-                if (GetNearbyBulletCountFromGridSpace(space) > 0)
-                {
-                    // Test Collision Player - Bullet (from UFO).
-                    int32 total_player_points = ArrayCount(player->points_global);
-                    for (int player_point_index = 0; player_point_index < total_player_points; ++player_point_index)
-                    {
-                        int next_player_point_index = (player_point_index + 1) % total_player_points;
-                        for (int bullet_index = 0; bullet_index < ArrayCount(game_state->ufo_bullets); ++bullet_index)
-                        {
-                            if (game_state->ufo_bullets[bullet_index].is_active && !game_state->ufo_bullets[bullet_index].is_friendly)
-                            {
-                                Bullet *bullet = &game_state->ufo_bullets[bullet_index];
-                                if (TestLineCircleIntersection(player->points_global[player_point_index], player->points_global[next_player_point_index],
-                                                               bullet->position, game_state->bullet_size))
-                                {
-                                    PlaySound(game_state, game_sound, SOUND_BANG_SMALL);
-                                    EmitSplashParticles(game_state, bullet->position.x, bullet->position.y);
 
-                                    HandlePlayerDeath(game_state, player);
+                    PlaySound(game_state, transient_state, game_sound, SOUND_BANG_SMALL);
+                    EmitSplashParticles(game_state, bullet->position.x, bullet->position.y);
 
-                                    bullet->is_active = false;
+                    HandlePlayerDeath(game_state, player);
 
-                                    break;
-                                }
-                            }
-                        }
-                    }
+                    bullet->is_active = false;
                 }
+            }
+        }
 
-                if (GetNearbyUFOPointCountFromGridSpace(space) > 0)
-                {
-                    int32 num_ufo_points = ArrayCount(ufo->points);
-                    int32 total_player_points = ArrayCount(player->points_global);
-
-                    // Test Collision Player - UFO.
-                    for (int player_point_index = 0; player_point_index < total_player_points; ++player_point_index)
-                    {
-                        int next_player_point_index = (player_point_index + 1) % total_player_points;
-
-                        for (int ufo_point_index = 0; ufo_point_index < num_ufo_points; ++ufo_point_index)
-                        {
-                            int32 next_ufo_point_index = (ufo_point_index + 1) % num_ufo_points;
-                            if (TestLineIntersection(ufo->points[ufo_point_index], ufo->points[next_ufo_point_index],
-                                                     player->points_global[player_point_index],
-                                                     player->points_global[next_player_point_index]))
-                            {
-                                game_state->score += ufo->is_small ? game_state->ufo_small_point_value : game_state->ufo_large_point_value;
+        // Test Collision Player - UFO.
+        for (int32 player_point_index = 0; player_point_index < total_player_points; ++player_point_index)
+        {
+            Vector2 player_a = player->points_global[player_point_index];
+            Vector2 player_b = player->points_global[(player_point_index + 1) % total_player_points];
 
-                                PlaySound(game_state, game_sound, SOUND_BANG_SMALL);
-                                HandlePlayerDeath(game_state, player);
+            uint64 ufo_edges = candidates.player_ufo[player_point_index];
+            while (ufo_edges && ufo->is_active && player->invuln_timer <= 0.0f)
+            {
+                int32 ufo_point_index = TakeLowestSetBit(&ufo_edges);
+                if (TestLineIntersection(ufo->points[ufo_point_index],
+                                         ufo->points[(ufo_point_index + 1) % num_ufo_points],
+                                         player_a, player_b))
+                {
+                    game_state->score += ufo->is_small ? game_state->ufo_small_point_value : game_state->ufo_large_point_value;
 
-                                ufo->is_active = false;
-                                if (game_state->ufo_loop)
-                                {
-                                    StopSound(game_state->ufo_loop);
-                                }
+                    PlaySound(game_state, transient_state, game_sound, SOUND_BANG_SMALL);
+                    HandlePlayerDeath(game_state, player);
 
-                                break;
-                            }
-                        }
-                    }
+                    ufo->is_active = false;
+                    StopSound(transient_state, game_state->ufo_loop_id);
+                    game_state->ufo_loop_id = 0;
                 }
             }
+        }
 
-            if (space->num_bullets > 0)
+        // Test Collision Asteroid - Bullet (the player's).
+        for (int32 bullet_index = 0; bullet_index < MAX_BULLETS; ++bullet_index)
+        {
+            Bullet *bullet = &game_state->bullets[bullet_index];
+            for (int32 word_index = 0; word_index < COLLISION_ASTEROID_EDGE_WORDS; ++word_index)
             {
-                if (GetNearbyAsteroidCountFromGridSpace(space) > 0)
+                uint64 edges = candidates.bullet_asteroid[bullet_index][word_index];
+                if (edges && bullet->is_active)
                 {
-                    // Test Collision Asteroid - Bullet
-                    for (int bullet_index = 0; bullet_index < ArrayCount(game_state->bullets); ++bullet_index)
+                    Vector2 from[2], to[2];
+                    int32 sweep_count = GetBulletSweeps(bullet, from, to);
+                    uint64 hits = 0;
+                    for (int32 sweep = 0; sweep < sweep_count; ++sweep)
                     {
-                        if (game_state->bullets[bullet_index].is_active)
-                        {
-                            Bullet *bullet = &game_state->bullets[bullet_index];
-                            for (int asteroid_index = 0; asteroid_index < ArrayCount(game_state->asteroids); ++asteroid_index)
-                            {
-                                if (game_state->asteroids[asteroid_index].is_active)
-                                {
-                                    Asteroid *asteroid = &game_state->asteroids[asteroid_index];
-                                    int32 total_asteroid_points = ArrayCount(asteroid->points_global);
-                                    for (int asteroid_point_index = 0; asteroid_point_index < total_asteroid_points; ++asteroid_point_index)
-                                    {
-                                        int32 next_asteroid_point_index = (asteroid_point_index + 1) % total_asteroid_points;
-                                        if (TestLineCircleIntersection(asteroid->points_global[asteroid_point_index],
-                                                                       asteroid->points_global[next_asteroid_point_index],
-                                                                       bullet->position, game_state->bullet_size))
-                                        {
-                                            game_state->score += game_state->asteroid_phase_point_values[asteroid->phase_index];
-
-                                            EmitSplashParticles(game_state, bullet->position.x, bullet->position.y);
-
-                                            PlaySound(game_state, game_sound, (SoundID)asteroid->phase_index);
-                                            BreakAsteroid(game_state, buffer, asteroid);
-
-                                            bullet->is_active = false;
-
-                                            break;
-                                        }
-                                    }
-                                }
-                            }
-                        }
+                        hits |= TestSweptCircleAgainstEdges(&grid->asteroid_edges, transient_state->simd_level,
+                                                            word_index, edges,
+                                                            from[sweep], to[sweep], game_state->bullet_size);
                     }
+                    edges = hits;
                 }
-            }
-
-            if (space->num_ufo_points > 0)
-            {
-                int32 num_ufo_points = ArrayCount(ufo->points);
-
-                if (GetNearbyAsteroidCountFromGridSpace(space) > 0)
+                while (edges && bullet->is_active)
                 {
-                    // Test Collision UFO - Asteroid
-                    for (int point_index = 0; point_index < num_ufo_points; ++point_index)
+                    Asteroid *asteroid = GetListedAsteroid(game_state, word_index * 64 + TakeLowestSetBit(&edges));
+                    if (asteroid)
                     {
-                        int32 next_point_index = (point_index + 1) % num_ufo_points;
-
-                        if (ufo->is_active)
+                        if (!TestCircleAgainstEdgeLoop(asteroid->points_global, MAX_ASTEROID_POINTS,
+                                                       bullet->position, game_state->bullet_size))
                         {
-                            for (int asteroid_index = 0; asteroid_index < ArrayCount(game_state->asteroids); ++asteroid_index)
-                            {
-                                if (game_state->asteroids[asteroid_index].is_active)
-                                {
-                                    Asteroid *asteroid = &game_state->asteroids[asteroid_index];
-                                    int32 total_asteroid_points = ArrayCount(asteroid->points_global);
-                                    for (int asteroid_point_index = 0; asteroid_point_index < total_asteroid_points; ++asteroid_point_index)
-                                    {
-                                        int32 next_asteroid_point_index = (asteroid_point_index + 1) % total_asteroid_points;
-                                        if (TestLineIntersection(ufo->points[point_index],
-                                                                 ufo->points[next_point_index],
-                                                                 asteroid->points_global[asteroid_point_index],
-                                                                 asteroid->points_global[next_asteroid_point_index]))
-                                        {
-                                            PlaySound(game_state, game_sound, (SoundID)asteroid->phase_index);
-                                            BreakAsteroid(game_state, buffer, asteroid);
-
-                                            EmitSplashParticles(game_state, ufo->position.x, ufo->position.y);
-
-                                            ufo->is_active = false;
-                                            if (game_state->ufo_loop)
-                                            {
-                                                StopSound(game_state->ufo_loop);
-                                            }
-
-                                            break;
-                                        }
-                                    }
-                                }
-                            }
+                            ++collision_counters.swept_hits;
                         }
-                    }
-                }
 
-                if (GetNearbyBulletCountFromGridSpace(space) > 0)
-                {
-                    // Test Collision UFO - Bullet
-                    for (int point_index = 0; point_index < num_ufo_points; ++point_index)
-                    {
-                        int32 next_point_index = (point_index + 1) % num_ufo_points;
+                        game_state->score += game_state->asteroid_phase_point_values[asteroid->phase_index];
 
-                        if (ufo->is_active)
-                        {
-                            for (int bullet_index = 0; bullet_index < ArrayCount(game_state->bullets); ++bullet_index)
-                            {
-                                if (game_state->bullets[bullet_index].is_active)
-                                {
-                                    Bullet *bullet = &game_state->bullets[bullet_index];
-                                    if (TestLineCircleIntersection(ufo->points[point_index],
-                                                                   ufo->points[next_point_index],
-                                                                   bullet->position, game_state->bullet_size))
-                                    {
-                                        game_state->score += ufo->is_small ? game_state->ufo_small_point_value : game_state->ufo_large_point_value;
+                        EmitSplashParticles(game_state, bullet->position.x, bullet->position.y);
 
-                                        PlaySound(game_state, game_sound, SOUND_BANG_SMALL);
+                        PlaySound(game_state, transient_state, game_sound, (SoundID)asteroid->phase_index);
+                        BreakAsteroid(game_state, buffer, asteroid);
 
-                                        EmitSplashParticles(game_state, bullet->position.x, bullet->position.y);
+                        bullet->is_active = false;
+                    }
+                }
+            }
+        }
 
-                                        bullet->is_active = false;
+        // Test Collision UFO - Asteroid
+        for (int32 ufo_point_index = 0; ufo_point_index < num_ufo_points; ++ufo_point_index)
+        {
+            Vector2 ufo_a = ufo->points[ufo_point_index];
+            Vector2 ufo_b = ufo->points[(ufo_point_index + 1) % num_ufo_points];
+            for (int32 word_index = 0; word_index < COLLISION_ASTEROID_EDGE_WORDS; ++word_index)
+            {
+                uint64 edges = candidates.ufo_asteroid[ufo_point_index][word_index];
+                if (edges && ufo->is_active)
+                {
+                    edges = TestSegmentAgainstEdges(&grid->asteroid_edges, transient_state->simd_level,
+                                                    word_index, edges, ufo_a, ufo_b);
+                }
+                while (edges && ufo->is_active)
+                {
+                    Asteroid *asteroid = GetListedAsteroid(game_state, word_index * 64 + TakeLowestSetBit(&edges));
+                    if (asteroid)
+                    {
+                        PlaySound(game_state, transient_state, game_sound, (SoundID)asteroid->phase_index);
+                        BreakAsteroid(game_state, buffer, asteroid);
 
-                                        ufo->is_active = false;
-                                        if (game_state->ufo_loop)
-                                        {
-                                            StopSound(game_state->ufo_loop);
-                                        }
+                        EmitSplashParticles(game_state, ufo->position.x, ufo->position.y);
 
-                                        break;
-                                    }
-                                }
-                            }
-                        }
+                        ufo->is_active = false;
+                        StopSound(transient_state, game_state->ufo_loop_id);
+                        game_state->ufo_loop_id = 0;
                     }
                 }
             }
         }
-    }
 
-    // Clear the screen.
-    DrawFilledRectangle(buffer, 0.0f, 0.0f, (float32)buffer->width, (float32)buffer->height, 0.06f, 0.18f, 0.17f);
+        // Test Collision UFO - Bullet (the player's).
+        for (int32 ufo_point_index = 0; ufo_point_index < num_ufo_points; ++ufo_point_index)
+        {
+            Vector2 ufo_a = ufo->points[ufo_point_index];
+            Vector2 ufo_b = ufo->points[(ufo_point_index + 1) % num_ufo_points];
 
-    // Just for fun ;)
-    DrawWavyString(buffer, &game_state->font, time,
-                   "This game is brought to you by the Lachlan Mouse Brothers.", 128, 32.0f,
-                   0.0f, (float32)buffer->height - 32.0f,
-                   6.0f, 2.0f,
-                   0.16f, 0.28f, 0.27f);
+            uint64 player_bullets = candidates.ufo_bullet[ufo_point_index];
+            while (player_bullets && ufo->is_active)
+            {
+                Bullet *bullet = &game_state->bullets[TakeLowestSetBit(&player_bullets)];
+                if (bullet->is_active &&
+                    TestBulletSweepsIntersection(ufo_a, ufo_b, bullet, game_state->bullet_size))
+                {
+                    if (!TestCircleAgainstEdgeLoop(ufo->points, num_ufo_points,
+                                                   bullet->position, game_state->bullet_size))
+                    {
+                        ++collision_counters.swept_hits;
+                    }
 
-#if 0
-    // DEBUG: Draw grid spaces either filled or unfilled if objects are present.
-    for (int i = 0; i < ArrayCount(grid->spaces); ++i)
-    {
-        int32 col = i % NUM_GRID_SPACES_H;
-        int32 row = i / NUM_GRID_SPACES_H;
+                    game_state->score += ufo->is_small ? game_state->ufo_small_point_value : game_state->ufo_large_point_value;
 
-        float32 x = (float32)col * grid->space_width;
-        float32 y = (float32)row * grid->space_height;
+                    PlaySound(game_state, transient_state, game_sound, SOUND_BANG_SMALL);
 
-        if (grid->spaces[i].num_asteroid_line_points > 0)
-        {
-            DrawFilledRectangle(buffer,
-                                x, y,
-                                x + grid->space_width, y + grid->space_height,
-                                1.0f, 0.0f, 0.0f);
-        }
-        else if (grid->spaces[i].num_bullets > 0)
-        {
-            DrawFilledRectangle(buffer,
-                                x, y,
-                                x + grid->space_width, y + grid->space_height,
-                                1.0f, 0.0f, 1.0f);
-        }
-        else if (grid->spaces[i].has_player)
-        {
-            DrawFilledRectangle(buffer,
-                                x, y,
-                                x + grid->space_width, y + grid->space_height,
-                                0.0f, 0.0f, 1.0f);
-        }
-        else if (grid->spaces[i].num_ufo_points > 0)
-        {
-            DrawFilledRectangle(buffer,
-                                x, y,
-                                x + grid->space_width, y + grid->space_height,
-                                0.0f, 1.0f, 1.0f);
-        }
-        else
-        {
-            DrawUnfilledRectangle(buffer,
-                                  x, y,
-                                  x + grid->space_width, y + grid->space_height,
-                                  1.0f, 0.0f, 0.0f);
-        }
-        WrapFloat32PointAroundBuffer(buffer, &x, &y);
-    }
-#endif
+                    EmitSplashParticles(game_state, bullet->position.x, bullet->position.y);
 
-    // =============================================================================================
-    // PLAYER DRAW
-    // =============================================================================================
+                    bullet->is_active = false;
 
-    if (game_state->phase == GAME_PHASE_PLAY && player->death_timer <= 0)
-    {
-        if (player->invuln_timer <= 0.0f)
-        {
-            DrawPoints(buffer,
-                       player->points_global, ArrayCount(player->points_global),
-                       player->color_r, player->color_g, player->color_b);
-        }
-        else
-        {
-            DrawPoints(buffer,
-                       player->points_global, ArrayCount(player->points_global),
-                       0.5f, 0.5f, 0.3f);
+                    ufo->is_active = false;
+                    StopSound(transient_state, game_state->ufo_loop_id);
+                    game_state->ufo_loop_id = 0;
+                }
+            }
         }
 
-        // Draw ship's thrust fire.
-        float32 thrust_fire_pos_x = player->position.x - player->forward.x * 15.0f;
-        float32 thrust_fire_pos_y = player->position.y - player->forward.y * 15.0f;
-
-        if (move_input_x != 0 || move_input_y != 0)
+        if (memory->collision_counters)
         {
-            DrawLine(buffer,
-                     thrust_fire_pos_x + player->right.x * 5.0f, thrust_fire_pos_y + player->right.y * 5.0f,
-                     thrust_fire_pos_x - player->right.x * 5.0f, thrust_fire_pos_y - player->right.y * 5.0f,
-                     1.0f, 0.0f, 0.0f);
-            DrawLine(buffer,
-                     thrust_fire_pos_x + player->right.x * 5.0f, thrust_fire_pos_y + player->right.y * 5.0f,
-                     thrust_fire_pos_x - player->forward.x * 10.0f, thrust_fire_pos_y - player->forward.y * 10.0f,
-                     1.0f, 0.0f, 0.0f);
-            DrawLine(buffer,
-                     thrust_fire_pos_x - player->right.x * 5.0f, thrust_fire_pos_y - player->right.y * 5.0f,
-                     thrust_fire_pos_x - player->forward.x * 10.0f, thrust_fire_pos_y - player->forward.y * 10.0f,
-                     1.0f, 0.0f, 0.0f);
+            memory->collision_counters->circle_tests += collision_counters.circle_tests;
+            memory->collision_counters->candidate_pairs += collision_counters.candidate_pairs;
+            memory->collision_counters->rejected_pairs += collision_counters.rejected_pairs;
+            memory->collision_counters->swept_hits += collision_counters.swept_hits;
         }
-
-#if 0
-        // Draw the ship's forward vector.
-        DrawLine(buffer,
-                 player->x, player->y,
-                 player->x + player->forward.x * 30.0f, player->y + player->forward.y * 30.0f,
-                 1.0f, 0.0f, 0.0f);
-        DrawLine(buffer,
-                 player->x, player->y,
-                 player->x + player->right.x * 30.0f, player->y + player->right.y * 30.0f,
-                 1.0f, 0.0f, 0.0f);
-#endif
     }
 
     // =============================================================================================
-    // BULLET UPDATE & DRAW
+    // BULLET UPDATE
     // =============================================================================================
 
-    // Calculate bullet positions and draw them all in the same loop.
     for (int i = 0; i < MAX_BULLETS; ++i)
     {
         Bullet *bullet = &game_state->bullets[i];
@@ -1909,32 +4119,36 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
                 continue;
             }
 
-            bullet->position.x += bullet->forward.x * game_state->bullet_speed * delta_time;
-            bullet->position.y += bullet->forward.y * game_state->bullet_speed * delta_time;
+            Vector2 move = {bullet->forward.x * game_state->bullet_speed * delta_time,
+                            bullet->forward.y * game_state->bullet_speed * delta_time};
+            bullet->position.x += move.x;
+            bullet->position.y += move.y;
+            Vector2 unwrapped_position = bullet->position;
             WrapFloat32PointAroundBuffer(buffer, &bullet->position.x, &bullet->position.y);
-
-            DrawCircle(buffer,
-                       bullet->position.x, bullet->position.y, game_state->bullet_size,
-                       0.45f, 0.9f, 0.76f);
+            bullet->swept_from = bullet->position - move;
+            bullet->wrap_offset = bullet->position - unwrapped_position;
         }
         else if (is_bullet_desired)
         {
             // Create the bullet in this index instead if we need one.
             bullet->position.x = player->position.x + player->forward.x * 20.0f;
             bullet->position.y = player->position.y + player->forward.y * 20.0f;
+            bullet->previous_position = bullet->position;
+            bullet->swept_from = bullet->position;
+            bullet->wrap_offset = {};
             bullet->forward.x = player->forward.x;
             bullet->forward.y = player->forward.y;
             bullet->time_remaining = game_state->bullet_lifespan_seconds;
             bullet->is_friendly = true;
             bullet->is_active = true;
 
-            PlaySound(game_state, game_sound, SOUND_FIRE);
+            PlaySound(game_state, transient_state, game_sound, SOUND_FIRE);
 
             is_bullet_desired = false;
         }
     }
 
-    // UFO Bullet Update & Draw
+    // UFO Bullet Update
     for (int i = 0; i < MAX_BULLETS; ++i)
     {
         Bullet *bullet = &game_state->ufo_bullets[i];
@@ -1947,21 +4161,21 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
                 continue;
             }
 
-            bullet->position.x += bullet->forward.x * game_state->ufo_bullet_speed * delta_time;
-            bullet->position.y += bullet->forward.y * game_state->ufo_bullet_speed * delta_time;
+            Vector2 move = {bullet->forward.x * game_state->ufo_bullet_speed * delta_time,
+                            bullet->forward.y * game_state->ufo_bullet_speed * delta_time};
+            bullet->position.x += move.x;
+            bullet->position.y += move.y;
+            Vector2 unwrapped_position = bullet->position;
             WrapFloat32PointAroundBuffer(buffer, &bullet->position.x, &bullet->position.y);
-
-            DrawCircle(buffer,
-                       bullet->position.x, bullet->position.y, game_state->ufo_bullet_size,
-                       0.92f, 0.2f, 0.43f);
+            bullet->swept_from = bullet->position - move;
+            bullet->wrap_offset = bullet->position - unwrapped_position;
         }
     }
 
     // =============================================================================================
-    // ASTEROID UPDATE & DRAW
+    // ASTEROID UPDATE
     // =============================================================================================
 
-    // Calculate asteroid positions and draw them all in the same loop.
     for (int i = 0; i < MAX_ASTEROIDS; ++i)
     {
         Asteroid *asteroid = &game_state->asteroids[i];
@@ -1969,23 +4183,14 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
         {
             asteroid->position.x += asteroid->forward.x * asteroid->speed * delta_time;
             asteroid->position.y += asteroid->forward.y * asteroid->speed * delta_time;
-            WrapFloat32PointAroundBuffer(buffer, &asteroid->position.x, &asteroid->position.y);
-
-            ComputeAsteroidLines(asteroid);
-
-            for (int point_index = 0; point_index < MAX_ASTEROID_POINTS; ++point_index)
-            {
-                int next_point_index = (point_index + 1) % MAX_ASTEROID_POINTS;
-                DrawLine(buffer,
-                         asteroid->points_global[point_index].x, asteroid->points_global[point_index].y,
-                         asteroid->points_global[next_point_index].x, asteroid->points_global[next_point_index].y,
-                         asteroid->color_r, asteroid->color_g, asteroid->color_b);
-            }
+            WrapFloat32PointAroundBuffer(buffer, &asteroid->position.x, &asteroid->position.y);
+
+            ComputeAsteroidLines(asteroid);
         }
     }
 
     // =============================================================================================
-    // UFO UPDATE & DRAW
+    // UFO UPDATE
     //
     // UFO Points are constructed in the following order:
     //
@@ -2032,6 +4237,9 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
 
                     bullet->position.x = ufo->position.x + bullet->forward.x * 20.0f;
                     bullet->position.y = ufo->position.y + bullet->forward.y * 20.0f;
+                    bullet->previous_position = bullet->position;
+                    bullet->swept_from = bullet->position;
+                    bullet->wrap_offset = {};
                     bullet->time_remaining = game_state->ufo_bullet_lifespan_seconds;
                     bullet->is_friendly = false;
                     bullet->is_active = true;
@@ -2051,35 +4259,13 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
         ComputeUFOPoints(ufo);
 
         // Check to see if the UFO reached the other side.
-        if (ufo->started_on_left_side && ufo->position.x >= buffer->width - 12.0f)
-        {
-            ufo->is_active = false;
-        }
-        else if (!ufo->started_on_left_side && ufo->position.x <= 12.0f)
+        if ((ufo->started_on_left_side && ufo->position.x >= buffer->width - 12.0f) ||
+            (!ufo->started_on_left_side && ufo->position.x <= 12.0f))
         {
             ufo->is_active = false;
+            StopSound(transient_state, game_state->ufo_loop_id);
+            game_state->ufo_loop_id = 0;
         }
-
-        // Draw the exterior lines of the UFO.
-        for (int i = 0; i < 8; ++i)
-        {
-            int32 next_index = (i + 1) % 8;
-
-            DrawLine(buffer,
-                     ufo->points[i].x, ufo->points[i].y,
-                     ufo->points[next_index].x, ufo->points[next_index].y,
-                     ufo->color_r, ufo->color_g, ufo->color_b);
-        }
-
-        // Now draw the interior lines.
-        DrawLine(buffer,
-                 ufo->points[0].x, ufo->points[0].y,
-                 ufo->points[5].x, ufo->points[5].y,
-                 ufo->color_r, ufo->color_g, ufo->color_b);
-        DrawLine(buffer,
-                 ufo->points[1].x, ufo->points[1].y,
-                 ufo->points[4].x, ufo->points[4].y,
-                 ufo->color_r, ufo->color_g, ufo->color_b);
     }
     else
     {
@@ -2092,6 +4278,7 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
                 ufo->started_on_left_side = RandomInt32InRange(&game_state->random, 0, 1);
                 ufo->position.x = ufo->started_on_left_side ? 0.0f : buffer->width;
                 ufo->position.y = RandomFloat32InRange(&game_state->random, 10.0f, buffer->height - 10.0f);
+                ufo->previous_position = ufo->position;
                 ufo->forward.x = ufo->started_on_left_side ? 1.0f : -1.0f;
                 ufo->forward.y = 0.0f;
                 ufo->time_to_next_direction_change = RandomFloat32InRange(&game_state->random,
@@ -2109,6 +4296,8 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
                     float32 pct = RandomFloat32InRange(&game_state->random, 0.0f, 1.0f);
                     ufo->is_small = pct > 0.85f; // Smaller is rarer.
                 }
+                ComputeUFOPoints(ufo);
+                ufo->bounding_radius = ComputeBoundingRadius(ufo->position, ufo->points, ArrayCount(ufo->points));
 
                 ufo->time_to_next_spawn = RandomFloat32InRange(&game_state->random,
                                                                game_state->ufo_spawn_time_min,
@@ -2117,17 +4306,19 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
                                                                 game_state->ufo_bullet_time_min,
                                                                 game_state->ufo_bullet_time_max);
                 ufo->is_active = true;
-                game_state->ufo_loop = PlaySound(game_state,
-                                                 game_sound,
-                                                 ufo->is_small ? SOUND_SAUCER_SMALL : SOUND_SAUCER_BIG,
-                                                 0.25f,
-                                                 true);
+                StopSound(transient_state, game_state->ufo_loop_id);
+                game_state->ufo_loop_id = PlaySound(game_state,
+                                                    transient_state,
+                                                    game_sound,
+                                                    ufo->is_small ? SOUND_SAUCER_SMALL : SOUND_SAUCER_BIG,
+                                                    0.25f,
+                                                    true);
             }
         }
     }
 
     // =============================================================================================
-    // PARTICLE SYSTEM UPDATE & DRAWING
+    // PARTICLE SYSTEM UPDATE
     // =============================================================================================
     if (game_state->phase == GAME_PHASE_PLAY)
     {
@@ -2158,14 +4349,6 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
 
                         particle->position.x += particle->forward.x * particle->move_speed * delta_time;
                         particle->position.y += particle->forward.y * particle->move_speed * delta_time;
-
-                        int32 x = RoundFloat32ToInt32(particle->position.x);
-                        int32 y = RoundFloat32ToInt32(particle->position.y);
-                        WrapInt32PointAroundBuffer(buffer, &x, &y);
-
-                        DrawPixel(buffer,
-                                  x, y,
-                                  MakeColor(0.94f, 0.94f, 0.94f));
                     }
                 }
             }
@@ -2207,8 +4390,314 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
 
                     next_particle->position.x += next_particle->forward.x * next_particle->move_speed * delta_time;
                     next_particle->position.y += next_particle->forward.y * next_particle->move_speed * delta_time;
+                }
+            }
+        }
+    }
+}
+
+// =================================================================================================
+// GAME RENDER
+// =================================================================================================
+
+// Function Signature:
+// GameRender(GameMemory *memory, GameTime *time, GameOffscreenBuffer *buffer)
+extern "C" GAME_RENDER(GameRender)
+{
+    // NOTE(mara): Rendering never changes the simulation. It only reads the state the last
+    // GameUpdate left behind, so it can be skipped entirely (headless) or run at a different rate
+    // than the simulation.
+    GameState *game_state = (GameState *)memory->permanent_storage;
+    TransientState *transient_state = (TransientState *)memory->transient_storage;
+
+    if (!game_state->is_initialized)
+    {
+        return;
+    }
+
+    PrepareTransientState(memory);
+
+    Player *player = &game_state->player;
+    UFO *ufo = &game_state->ufo;
+    Grid *grid = &game_state->grid;
+
+    // NOTE(mara): Everything below records commands; nothing is drawn until RenderGroupToOutput at
+    // the end of the frame.
+    TemporaryMemory render_memory = BeginTemporaryMemory(&transient_state->arena);
+    RenderGroup *render_group = AllocateRenderGroup(&transient_state->arena, memory,
+                                                    transient_state->simd_level, buffer,
+                                                    MAX_RENDER_COMMANDS);
+
+    // Clear the screen. When the platform kept last frame's pixels, only what was drawn last frame
+    // needs erasing; everything else is still the background.
+    GameDirtyRects *dirty = &buffer->dirty;
+    GameDirtyRects *previous_dirty = &transient_state->previous_dirty;
+    bool32 can_erase_previous_frame = (buffer->is_preserved &&
+                                       transient_state->has_previous_frame &&
+                                       !previous_dirty->is_everything &&
+                                       transient_state->previous_width == buffer->width &&
+                                       transient_state->previous_height == buffer->height);
+    uint32 background_color = MakeColor(0.06f, 0.18f, 0.17f);
+    if (can_erase_previous_frame)
+    {
+        for (int32 i = 0; i < previous_dirty->count; ++i)
+        {
+            PushClear(render_group, &previous_dirty->rects[i], background_color);
+        }
+    }
+    else
+    {
+        GameRect buffer_rect = GetBufferRect(buffer);
+        PushClear(render_group, &buffer_rect, background_color);
+    }
+
+    dirty->is_everything = false;
+    dirty->count = 0;
+
+    SetRenderLayer(render_group, RENDER_LAYER_BACKDROP);
+
+    // Just for fun ;)
+    DrawWavyString(render_group, &transient_state->font, time,
+                   "This game is brought to you by the Lachlan Mouse Brothers.", 128, 32.0f,
+                   0.0f, (float32)buffer->height - 32.0f,
+                   6.0f, 2.0f,
+                   0.16f, 0.28f, 0.27f);
+
+#if 0
+    // DEBUG: Draw grid spaces either filled or unfilled if objects are present.
+    for (int i = 0; i < ArrayCount(grid->spaces); ++i)
+    {
+        int32 col = i % NUM_GRID_SPACES_H;
+        int32 row = i / NUM_GRID_SPACES_H;
+
+        float32 x = (float32)col * grid->space_width;
+        float32 y = (float32)row * grid->space_height;
+
+        if (grid->spaces[i].lists[GRID_LIST_ASTEROID_EDGES].count > 0)
+        {
+            DrawFilledRectangle(render_group,
+                                x, y,
+                                x + grid->space_width, y + grid->space_height,
+                                1.0f, 0.0f, 0.0f);
+        }
+        else if (grid->spaces[i].lists[GRID_LIST_BULLETS].count > 0)
+        {
+            DrawFilledRectangle(render_group,
+                                x, y,
+                                x + grid->space_width, y + grid->space_height,
+                                1.0f, 0.0f, 1.0f);
+        }
+        else if (grid->spaces[i].lists[GRID_LIST_PLAYER_EDGES].count > 0)
+        {
+            DrawFilledRectangle(render_group,
+                                x, y,
+                                x + grid->space_width, y + grid->space_height,
+                                0.0f, 0.0f, 1.0f);
+        }
+        else if (grid->spaces[i].lists[GRID_LIST_UFO_EDGES].count > 0)
+        {
+            DrawFilledRectangle(render_group,
+                                x, y,
+                                x + grid->space_width, y + grid->space_height,
+                                0.0f, 1.0f, 1.0f);
+        }
+        else
+        {
+            DrawUnfilledRectangle(render_group,
+                                  x, y,
+                                  x + grid->space_width, y + grid->space_height,
+                                  1.0f, 0.0f, 0.0f);
+        }
+        WrapFloat32PointAroundBuffer(buffer, &x, &y);
+    }
+#endif
+
+    SetRenderLayer(render_group, RENDER_LAYER_WORLD);
+
+    // =============================================================================================
+    // PLAYER DRAW
+    // =============================================================================================
+
+    if (game_state->phase == GAME_PHASE_PLAY && player->death_timer <= 0)
+    {
+        Vector2 offset = GetRenderBlendOffset(buffer, time, player->previous_position, player->position);
+
+        Vector2 player_points[ArrayCount(player->points_global)];
+        for (int i = 0; i < ArrayCount(player_points); ++i)
+        {
+            player_points[i] = player->points_global[i] + offset;
+        }
+
+        if (player->invuln_timer <= 0.0f)
+        {
+            DrawPoints(render_group,
+                       player_points, ArrayCount(player_points),
+                       player->color_r, player->color_g, player->color_b);
+        }
+        else
+        {
+            DrawPoints(render_group,
+                       player_points, ArrayCount(player_points),
+                       0.5f, 0.5f, 0.3f);
+        }
+
+        // Draw ship's thrust fire.
+        float32 thrust_fire_pos_x = player->position.x + offset.x - player->forward.x * 15.0f;
+        float32 thrust_fire_pos_y = player->position.y + offset.y - player->forward.y * 15.0f;
+
+        if (player->show_thrust_fire)
+        {
+            DrawLine(render_group,
+                     thrust_fire_pos_x + player->right.x * 5.0f, thrust_fire_pos_y + player->right.y * 5.0f,
+                     thrust_fire_pos_x - player->right.x * 5.0f, thrust_fire_pos_y - player->right.y * 5.0f,
+                     1.0f, 0.0f, 0.0f);
+            DrawLine(render_group,
+                     thrust_fire_pos_x + player->right.x * 5.0f, thrust_fire_pos_y + player->right.y * 5.0f,
+                     thrust_fire_pos_x - player->forward.x * 10.0f, thrust_fire_pos_y - player->forward.y * 10.0f,
+                     1.0f, 0.0f, 0.0f);
+            DrawLine(render_group,
+                     thrust_fire_pos_x - player->right.x * 5.0f, thrust_fire_pos_y - player->right.y * 5.0f,
+                     thrust_fire_pos_x - player->forward.x * 10.0f, thrust_fire_pos_y - player->forward.y * 10.0f,
+                     1.0f, 0.0f, 0.0f);
+        }
+
+#if 0
+        // Draw the ship's forward vector.
+        DrawLine(render_group,
+                 player->x, player->y,
+                 player->x + player->forward.x * 30.0f, player->y + player->forward.y * 30.0f,
+                 1.0f, 0.0f, 0.0f);
+        DrawLine(render_group,
+                 player->x, player->y,
+                 player->x + player->right.x * 30.0f, player->y + player->right.y * 30.0f,
+                 1.0f, 0.0f, 0.0f);
+#endif
+    }
+
+    // =============================================================================================
+    // BULLET DRAW
+    // =============================================================================================
+
+    for (int i = 0; i < MAX_BULLETS; ++i)
+    {
+        Bullet *bullet = &game_state->bullets[i];
+        if (bullet->is_active)
+        {
+            Vector2 offset = GetRenderBlendOffset(buffer, time, bullet->previous_position, bullet->position);
+            DrawCircle(render_group,
+                       bullet->position.x + offset.x, bullet->position.y + offset.y, game_state->bullet_size,
+                       0.45f, 0.9f, 0.76f);
+        }
+    }
+
+    for (int i = 0; i < MAX_BULLETS; ++i)
+    {
+        Bullet *bullet = &game_state->ufo_bullets[i];
+        if (bullet->is_active)
+        {
+            Vector2 offset = GetRenderBlendOffset(buffer, time, bullet->previous_position, bullet->position);
+            DrawCircle(render_group,
+                       bullet->position.x + offset.x, bullet->position.y + offset.y, game_state->ufo_bullet_size,
+                       0.92f, 0.2f, 0.43f);
+        }
+    }
+
+    // =============================================================================================
+    // ASTEROID DRAW
+    // =============================================================================================
+
+    for (int i = 0; i < MAX_ASTEROIDS; ++i)
+    {
+        Asteroid *asteroid = &game_state->asteroids[i];
+        if (asteroid->is_active)
+        {
+            Vector2 offset = GetRenderBlendOffset(buffer, time, asteroid->previous_position, asteroid->position);
+            for (int point_index = 0; point_index < MAX_ASTEROID_POINTS; ++point_index)
+            {
+                int next_point_index = (point_index + 1) % MAX_ASTEROID_POINTS;
+                DrawLine(render_group,
+                         asteroid->points_global[point_index].x + offset.x,
+                         asteroid->points_global[point_index].y + offset.y,
+                         asteroid->points_global[next_point_index].x + offset.x,
+                         asteroid->points_global[next_point_index].y + offset.y,
+                         asteroid->color_r, asteroid->color_g, asteroid->color_b);
+            }
+        }
+    }
+
+    // =============================================================================================
+    // UFO DRAW
+    // =============================================================================================
+
+    if (ufo->is_active)
+    {
+        Vector2 offset = GetRenderBlendOffset(buffer, time, ufo->previous_position, ufo->position);
+
+        Vector2 ufo_points[ArrayCount(ufo->points)];
+        for (int i = 0; i < ArrayCount(ufo_points); ++i)
+        {
+            ufo_points[i] = ufo->points[i] + offset;
+        }
+
+        // Draw the exterior lines of the UFO.
+        for (int i = 0; i < 8; ++i)
+        {
+            int32 next_index = (i + 1) % 8;
+
+            DrawLine(render_group,
+                     ufo_points[i].x, ufo_points[i].y,
+                     ufo_points[next_index].x, ufo_points[next_index].y,
+                     ufo->color_r, ufo->color_g, ufo->color_b);
+        }
+
+        // Now draw the interior lines.
+        DrawLine(render_group,
+                 ufo_points[0].x, ufo_points[0].y,
+                 ufo_points[5].x, ufo_points[5].y,
+                 ufo->color_r, ufo->color_g, ufo->color_b);
+        DrawLine(render_group,
+                 ufo_points[1].x, ufo_points[1].y,
+                 ufo_points[4].x, ufo_points[4].y,
+                 ufo->color_r, ufo->color_g, ufo->color_b);
+    }
+
+    // =============================================================================================
+    // PARTICLE SYSTEM DRAW
+    // =============================================================================================
+
+    if (game_state->phase == GAME_PHASE_PLAY)
+    {
+        for (int i = 0; i < ArrayCount(game_state->particle_system_splash); ++i)
+        {
+            if (game_state->particle_system_splash[i].is_emitting)
+            {
+                ParticleSystem *splash = &game_state->particle_system_splash[i];
+                for (int particle_index = 0; particle_index < splash->num_particles; ++particle_index)
+                {
+                    if (splash->particles[particle_index].is_active)
+                    {
+                        Particle *particle = &splash->particles[particle_index];
+
+                        DrawPoint(render_group,
+                                  RoundFloat32ToInt32(particle->position.x),
+                                  RoundFloat32ToInt32(particle->position.y),
+                                  0.94f, 0.94f, 0.94f);
+                    }
+                }
+            }
+        }
 
-                    DrawLine(buffer,
+        if (game_state->particle_system_lines.is_emitting)
+        {
+            ParticleSystem *lines = &game_state->particle_system_lines;
+            for (int particle_index = 0; particle_index < lines->num_particles; particle_index += 2)
+            {
+                if (lines->particles[particle_index].is_active)
+                {
+                    Particle *particle = &lines->particles[particle_index];
+                    Particle *next_particle = &lines->particles[(particle_index + 1)];
+
+                    DrawLine(render_group,
                              particle->position.x, particle->position.y,
                              next_particle->position.x, next_particle->position.y,
                              player->color_r, player->color_g, player->color_b);
@@ -2217,6 +4706,8 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
         }
     }
 
+    SetRenderLayer(render_group, RENDER_LAYER_HUD);
+
     // =============================================================================================
     // UI DRAWING
     // =============================================================================================
@@ -2231,7 +4722,7 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
     {
         sprintf_s(score_string, "%ld", game_state->score);
     }
-    DrawString(buffer, &game_state->font,
+    DrawString(render_group, &transient_state->font,
                score_string, 24, 48.0f,
                290.0f, 25.0f,
                0.3f, 0.5f, 1.0f);
@@ -2246,14 +4737,14 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
     {
         sprintf_s(level_string, "%ld", game_state->level);
     }
-    DrawString(buffer, &game_state->font,
+    DrawString(render_group, &transient_state->font,
                level_string, 24, 28.0f,
                buffer->width / 2.0f, 25.0f,
                0.75f, 0.75f, 0.75f);
 
     if (game_state->phase == GAME_PHASE_ATTRACT_MODE)
     {
-        DrawString(buffer, &game_state->font,
+        DrawString(render_group, &transient_state->font,
                    "PRESS HYPERSPACE (DOWN / S) TO PLAY", 128, 32.0f,
                    ((float32)buffer->width / 2.0f) - 256.0f, (float32)buffer->height - 128.0f,
                    0.2f, 0.3f, 0.75f);
@@ -2264,7 +4755,7 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
         float32 x_offset = 300.0f;
         for (int i = 0; i < player->lives; ++i)
         {
-            DrawPoints(buffer,
+            DrawPoints(render_group,
                        player->points_local, ArrayCount(player->points_local),
                        player->color_r, player->color_g, player->color_b,
                        x_offset, 85.0f);
@@ -2274,7 +4765,7 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
 
     if (player->death_timer >= 0.0f && player->lives <= 0)
     {
-        DrawString(buffer, &game_state->font,
+        DrawString(render_group, &transient_state->font,
                    "Game...over...", 128, 48.0f,
                    ((float32)buffer->width / 2.0f) - 128.0f, (float32)buffer->height / 2.0f,
                    0.95f, 0.95f, 0.95f);
@@ -2291,7 +4782,7 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
             HighScore *hs = &game_state->high_scores[i];
             if (hs->score == 0)
             {
-                DrawString(buffer, &game_state->font,
+                DrawString(render_group, &transient_state->font,
                            "AST | 00", 128, 48.0f,
                            x, y,
                            0.95f, 0.95f, 0.95f);
@@ -2301,7 +4792,7 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
                 char hs_buffer[32];
                 sprintf_s(hs_buffer, "%s | %i", hs->name, hs->score);
 
-                DrawString(buffer, &game_state->font,
+                DrawString(render_group, &transient_state->font,
                            hs_buffer, 128, 48.0f,
                            x, y,
                            0.95f, 0.95f, 0.95f);
@@ -2322,7 +4813,7 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
             HighScore *hs = &game_state->high_scores[i];
             if (hs->score == 0)
             {
-                DrawString(buffer, &game_state->font,
+                DrawString(render_group, &transient_state->font,
                            "AST | 00", 128, 48.0f,
                            x, y,
                            0.95f, 0.95f, 0.95f);
@@ -2332,7 +4823,7 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
                 char hs_buffer[32];
                 sprintf_s(hs_buffer, "%s | %i", hs->name, hs->score);
 
-                DrawString(buffer, &game_state->font,
+                DrawString(render_group, &transient_state->font,
                            hs_buffer, 128, 48.0f,
                            x, y,
                            0.95f, 0.95f, 0.95f);
@@ -2343,7 +4834,7 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
 
         y += 32.0f;
 
-        DrawString(buffer, &game_state->font,
+        DrawString(render_group, &transient_state->font,
                    "New high score! Please enter your name and press space.", 128, 36.0f,
                    x - 256.0f, y,
                    0.33f, 0.86f, 0.51f);
@@ -2371,12 +4862,12 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
             float32 col_r = i == game_state->name_index ? 1.0f : 0.9f;
             float32 col_g = i == game_state->name_index ? 0.0f : 0.89f;
             float32 col_b = i == game_state->name_index ? 0.0f : 0.76f;
-            DrawString(buffer, &game_state->font,
+            DrawString(render_group, &transient_state->font,
                        "_ ", 16, 48.0f,
                        x + (i * 44.0f), y + 16.0f,
                        col_r, col_g, col_b);
         }
-        DrawString(buffer, &game_state->font,
+        DrawString(render_group, &transient_state->font,
                    name_entry_buffer, 16, 48.0f,
                    x, y,
                    0.9f, 0.89f, 0.76f);
@@ -2385,9 +4876,54 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
 #if 0
     char time_string[128];
     sprintf_s(time_string, "%.2f seconds elapsed.", time->total_time);
-    DrawString(buffer, &game_state->font,
+    DrawString(render_group, &transient_state->font,
                time_string, 128, 20.0f,
                4.0f, 4.0f,
                0.75f, 0.75f, 0.75f);
 #endif
+
+    RenderGroupToOutput(render_group);
+    EndTemporaryMemory(render_memory);
+
+    if (memory->skip_render_output)
+    {
+        // Not a pixel changed. Whichever frame does get drawn next can't trust the buffer, though.
+        dirty->is_everything = false;
+        dirty->count = 0;
+        transient_state->has_previous_frame = false;
+        return;
+    }
+
+    // Whatever was erased changed as well, so the platform uploads last frame's rectangles too. Only
+    // this frame's get erased next time, though.
+    int32 drawn_count = dirty->count;
+    bool32 drawn_everything = dirty->is_everything;
+    if (can_erase_previous_frame)
+    {
+        for (int32 i = 0; i < previous_dirty->count && !dirty->is_everything; ++i)
+        {
+            if (dirty->count < MAX_DIRTY_RECTS)
+            {
+                dirty->rects[dirty->count++] = previous_dirty->rects[i];
+            }
+            else
+            {
+                dirty->is_everything = true;
+            }
+        }
+    }
+    else
+    {
+        dirty->is_everything = true;
+    }
+
+    previous_dirty->is_everything = drawn_everything;
+    previous_dirty->count = drawn_count;
+    for (int32 i = 0; i < drawn_count; ++i)
+    {
+        previous_dirty->rects[i] = dirty->rects[i];
+    }
+    transient_state->previous_width = buffer->width;
+    transient_state->previous_height = buffer->height;
+    transient_state->has_previous_frame = true;
 }
@@ -2,13 +2,40 @@
 #define ASTEROIDS_H
 
 #include "asteroids_platform.h"
-global PlatformAPI global_platform;
+
+#if !defined(_MSC_VER)
+// NOTE(mara): sprintf_s is MSVC-only. These mirror the two overloads the game actually uses so
+// that the same code also builds with GCC/Clang for the Linux platform layer.
+#include <stdio.h>
+#include <stdarg.h>
+
+template <size_t count>
+inline int sprintf_s(char (&buffer)[count], const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int result = vsnprintf(buffer, count, format, args);
+    va_end(args);
+    return result;
+}
+
+inline int sprintf_s(char *buffer, size_t count, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int result = vsnprintf(buffer, count, format, args);
+    va_end(args);
+    return result;
+}
+#endif
 
 #include "asteroids_math.h"
+#include "asteroids_simd.h"
 #include "asteroids_memory.h"
 #include "asteroids_random.h"
 #include "asteroids_font.h"
 #include "asteroids_sound.h"
+#include "asteroids_render.h"
 
 #define BITMAP_BYTES_PER_PIXEL 4
 
@@ -25,6 +52,15 @@ global PlatformAPI global_platform;
 
 #define MAX_PARTICLES 100
 
+// NOTE(mara): Every shape the collision grid lists: asteroid edges, both kinds of bullets (twice,
+// when their move wrapped), the UFO's 8 edges and the player's 5. The grid never holds more than all
+// of them in every space.
+#define GRID_MAX_SHAPES (MAX_ASTEROIDS * MAX_ASTEROID_POINTS + 2 * 2 * MAX_BULLETS + 8 + 5)
+#define GRID_MAX_ENTRIES (GRID_MAX_SHAPES * NUM_GRID_SPACES_H * NUM_GRID_SPACES_V)
+
+// Asteroid edges are tested 64 at a time, one bit each.
+#define COLLISION_ASTEROID_EDGE_WORDS ((MAX_ASTEROIDS * MAX_ASTEROID_POINTS + 63) / 64)
+
 #define NAME_ENTRY_MAX_LENGTH 3
 #define NAME_ENTRY_MAX_ALLOWED_CHARS 36
 #define MAX_HIGH_SCORES 10
@@ -33,6 +69,7 @@ global PlatformAPI global_platform;
 #define SOUND_BYTES_PER_SAMPLE sizeof(int16) * 2
 #define SOUND_BYTES_PER_SECOND SOUND_SAMPLES_PER_SECOND / SOUND_BYTES_PER_SAMPLE
 #define MAX_CONCURRENT_SOUNDS 16
+#define MAX_SOUND_STREAMS 64
 
 // =================================================================================================
 // HELPERS
@@ -48,6 +85,18 @@ inline int GetStringLength(char *string)
     return length;
 }
 
+inline bool32 StringsAreEqual(uint32 count, char *a, char *b)
+{
+    for (uint32 i = 0; i < count; ++i)
+    {
+        if (a[i] != b[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 // Floored modulus operation so negative values wrap around the length.
 inline int32 WrapIndex(int32 index, int32 array_length)
 {
@@ -125,30 +174,60 @@ struct ParticleSystem
     bool32 is_emitting;
 };
 
+enum GridListType
+{
+    GRID_LIST_ASTEROID_EDGES, // asteroid_index * MAX_ASTEROID_POINTS + point_index
+    GRID_LIST_BULLETS,        // Index into bullets, or MAX_BULLETS + index into ufo_bullets.
+    GRID_LIST_UFO_EDGES,      // Index of the edge's first point in UFO::points.
+    GRID_LIST_PLAYER_EDGES,   // Index of the edge's first point in Player::points_global.
+
+    GRID_LIST_TYPE_COUNT
+};
+
+struct GridList
+{
+    int32 first_entry; // In Grid::entries.
+    int32 count;
+};
+
 struct GridSpace
 {
-    GridSpace *north;
-    GridSpace *east;
-    GridSpace *south;
-    GridSpace *west;
-
-    int32 num_asteroid_line_points;
-    int32 num_bullets;
-    int32 num_ufo_points;
-    bool32 has_player;
+    GridList lists[GRID_LIST_TYPE_COUNT];
+};
+
+// NOTE(mara): Both end points of every listed asteroid edge, one array per coordinate, so the
+// batched segment tests load 4, 8 or 16 edges with one load each. Indexed like the edge lists; the
+// padding after the last real edge is never a candidate.
+struct EdgeArrays
+{
+    float32 a_x[COLLISION_ASTEROID_EDGE_WORDS * 64];
+    float32 a_y[COLLISION_ASTEROID_EDGE_WORDS * 64];
+    float32 b_x[COLLISION_ASTEROID_EDGE_WORDS * 64];
+    float32 b_y[COLLISION_ASTEROID_EDGE_WORDS * 64];
 };
 
+// NOTE(mara): Rebuilt every update. Each space lists the shapes whose bounds overlap it, all of a
+// space's lists next to each other in entries.
 struct Grid
 {
     float32 space_width;
     float32 space_height;
 
     GridSpace spaces[NUM_GRID_SPACES_H * NUM_GRID_SPACES_V];
+
+    // Bit per asteroid slot whose edges are on the lists. An asteroid that breaks is taken off, so a
+    // new one generated into its slot later in the same update isn't mistaken for it.
+    uint32 listed_asteroids;
+    EdgeArrays asteroid_edges;
+
+    int32 entry_count;
+    uint16 entries[GRID_MAX_ENTRIES];
 };
 
 struct Player
 {
     Vector2 position;
+    Vector2 previous_position; // Position at the start of the latest update, for render blending.
     Vector2 forward;
     Vector2 right;
     Vector2 velocity;
@@ -168,17 +247,26 @@ struct Player
     float32 death_timer;
     float32 invuln_timer;
 
+    bool32 show_thrust_fire; // Set by the update from this frame's input, read by the render.
+
     int32 lives;
 
     Vector2 points_local[5];
     Vector2 points_global[5];
+    float32 bounding_radius; // Around position, holds every point.
 };
 
 struct Bullet
 {
     Vector2 position;
+    Vector2 previous_position;
     Vector2 forward;
 
+    // Where the latest move started, on the same side of the screen as position even if it
+    // wrapped. Collision tests the whole move, so a bullet can't skip over something thin.
+    Vector2 swept_from;
+    Vector2 wrap_offset; // How far wrapping moved position at the end of that move; 0 if it didn't.
+
     float32 time_remaining;
 
     bool32 is_friendly;
@@ -188,10 +276,12 @@ struct Bullet
 struct Asteroid
 {
     Vector2 position;
+    Vector2 previous_position;
     Vector2 forward;
 
     Vector2 points_local[MAX_ASTEROID_POINTS];
     Vector2 points_global[MAX_ASTEROID_POINTS];
+    float32 bounding_radius; // Around position, holds every point.
 
     float32 speed;
 
@@ -207,9 +297,11 @@ struct Asteroid
 struct UFO
 {
     Vector2 position;
+    Vector2 previous_position;
     Vector2 forward;
 
     Vector2 points[8]; // Global-space UFO points.
+    float32 bounding_radius; // Around position, holds every point.
 
     bool32 started_on_left_side;
 
@@ -248,8 +340,13 @@ struct HighScore
     char name[NAME_ENTRY_MAX_LENGTH + 1];
 };
 
+// NOTE(mara): GameState has to stay relocatable: it may be memcpy'd into another GameMemory to
+// save, clone or restore a world. Anything it refers to is therefore stored as an index, an id or an
+// offset from the start of the GameState (see GetStateMemory), never as a raw pointer.
 struct GameState
 {
+    bool32 is_initialized;
+
     GamePhase phase;
 
     Grid grid;
@@ -299,7 +396,7 @@ struct GameState
 
     RandomState random;
 
-    FontData font;
+    FontAsset font_asset;
 
     HighScore high_scores[MAX_HIGH_SCORES];
     char name_chars[NAME_ENTRY_MAX_ALLOWED_CHARS + 1];
@@ -313,13 +410,26 @@ struct GameState
     bool32 name_completion_desired;
 
     WAVESoundData sounds[SOUND_ASSET_COUNT];
-    MemoryArena sound_arena;
 
     WAVESoundData test_wav;
     uint32 test_wav_sample_index;
 
-    SoundStream *thrust_loop;
-    SoundStream *ufo_loop;
+    // Ids of the SoundStreams playing the loops, 0 when nothing is playing. See PlaySound.
+    uint32 thrust_loop_id;
+    uint32 ufo_loop_id;
+    uint32 last_sound_stream_id;
+
+    // NOTE(mara): Stamped by PrepareTransientState and every GameUpdate: the TransientState that
+    // wrote this GameState last, and where its write_generation was then. A TransientState never
+    // hands out the same generation twice, so a GameState copied in from another live world, or
+    // restored from any earlier snapshot of this one, never matches and always triggers a rebuild.
+    // NOTE(mara): The writer is the TransientState's address, which is only unique among worlds that
+    // are alive at the same time. A GameState saved by a world whose memory has since been reused, or
+    // by an earlier run of a host that maps its memory at a fixed address (Win32 debug builds), can
+    // still match by chance. It's then kept as is, and its thrust_loop_id and ufo_loop_id name
+    // streams this TransientState never started for it.
+    uint64 writer_id;
+    uint64 write_generation;
 
     float32 beat_sound_countdown;
     float32 beat_sound_countdown_time;
@@ -329,9 +439,36 @@ struct GameState
     bool32 beat_sound_countdown_flip;
 };
 
+// NOTE(mara): Everything in here can be rebuilt from the GameState, and is, whenever the
+// permanent storage it was built against changes or something else was copied into it.
 struct TransientState
 {
+    bool32 is_initialized;
+    void *permanent_storage_base;
+    uint64 write_generation; // Goes up with every stamp on the GameState, rebuilds included.
+
     MemoryArena arena;
+
+    // NOTE(mara): Detected here, on the thread that calls into the game, rather than on first use:
+    // render work running on several threads would otherwise race to fill it in.
+    SimdLevel simd_level;
+
+    FontData font;
+
+    SoundStream sound_streams[MAX_SOUND_STREAMS];
+    uint32 next_sound_stream_index;
+
+    // NOTE(mara): What the last GameRender drew, so the next one can erase just that when the
+    // platform kept the pixels around.
+    bool32 has_previous_frame;
+    int32 previous_width;
+    int32 previous_height;
+    GameDirtyRects previous_dirty;
 };
 
+inline void *GetStateMemory(GameState *game_state, memsize offset)
+{
+    return (uint8 *)game_state + offset;
+}
+
 #endif
@@ -0,0 +1,1019 @@
+// NOTE(mara): Micro-benchmarks for the game's hot loops. The game code is pulled in whole, next to
+// the straightforward versions it replaced, so each benchmark can time both on the same input and
+// check that they still agree. Not part of the game; build.sh builds it next to the headless host.
+#include "asteroids.cpp"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_RUN_COUNT 8
+#define BENCH_RUN_SECONDS 0.1
+
+global SimdLevel bench_simd_level; // Detected once at the top of main.
+
+inline float64 BenchGetSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (float64)now.tv_sec + (float64)now.tv_nsec * 1e-9;
+}
+
+inline float32 BenchRandomFloat32(float32 min, float32 max)
+{
+    return min + (max - min) * ((float32)rand() / (float32)RAND_MAX);
+}
+
+internal GameOffscreenBuffer BenchAllocateBuffer(int32 width, int32 height)
+{
+    GameOffscreenBuffer buffer = {};
+    buffer.width = width;
+    buffer.height = height;
+    buffer.bytes_per_pixel = BITMAP_BYTES_PER_PIXEL;
+    buffer.pitch = buffer.width * buffer.bytes_per_pixel;
+    buffer.memory = calloc(buffer.height, buffer.pitch);
+    return buffer;
+}
+
+internal void BenchPrintResult(char *name, char *unit, float64 reference_per_second, float64 per_second)
+{
+    printf("| %-12s | reference %9.2f M%s/s | game %9.2f M%s/s | %5.2fx |\n",
+           name, reference_per_second / 1e6, unit, per_second / 1e6, unit,
+           per_second / reference_per_second);
+}
+
+// =================================================================================================
+// LINES
+// =================================================================================================
+
+// NOTE(mara): The DrawLine the game used before the clip-and-split rasterizer: float error terms,
+// and a wrap plus a full address computation for every pixel.
+internal void ReferenceDrawLine(GameOffscreenBuffer *buffer,
+                                float32 x0, float32 y0,
+                                float32 x1, float32 y1,
+                                float32 r, float32 g, float32 b)
+{
+    bool32 is_steep = (Abs(y1 - y0) > Abs(x1 - x0));
+
+    if (is_steep)
+    {
+        Swap(float32, x0, y0);
+        Swap(float32, x1, y1);
+    }
+
+    if (x0 > x1)
+    {
+        Swap(float32, x0, x1);
+        Swap(float32, y0, y1);
+    }
+
+    float32 dx = x1 - x0;
+    float32 dy = Abs(y1 - y0);
+
+    float32 error = dx / 2.0f;
+    int32 y_step = (y0 < y1) ? 1 : -1;
+    int32 y = RoundFloat32ToInt32(y0);
+
+    int32 start_x = RoundFloat32ToInt32(x0);
+    int32 end_x = RoundFloat32ToInt32(x1);
+
+    uint32 color = MakeColor(r, g, b);
+
+    for (int32 x = start_x; x <= end_x; ++x)
+    {
+        int32 final_x = is_steep ? y : x;
+        int32 final_y = is_steep ? x : y;
+        WrapInt32PointAroundBuffer(buffer, &final_x, &final_y);
+
+        DrawPixel(buffer, final_x, final_y, color);
+
+        error -= dy;
+        if (error < 0)
+        {
+            y += y_step;
+            error += dx;
+        }
+    }
+}
+
+struct BenchLine
+{
+    float32 x0, y0;
+    float32 x1, y1;
+};
+
+#define BENCH_LINE_COUNT 4096
+
+// What DrawLine records and the frame plays back later, done on the spot.
+inline void BenchRasterizeLine(GameOffscreenBuffer *buffer, BenchLine *line,
+                               float32 r, float32 g, float32 b)
+{
+    GameRect clip = GetBufferRect(buffer);
+    RasterizeLine(buffer, &clip,
+                  SnapToLineSubpixels(line->x0), SnapToLineSubpixels(line->y0),
+                  SnapToLineSubpixels(line->x1), SnapToLineSubpixels(line->y1),
+                  MakeColor(r, g, b));
+}
+
+// Which pixel of the given column (or row, for steep lines) the line drew, wiping it again.
+internal int32 BenchTakeLinePixel(GameOffscreenBuffer *buffer, bool32 is_steep, int32 major,
+                                  int32 min_minor, int32 max_minor)
+{
+    int32 result = INT32_MIN;
+    for (int32 minor = min_minor; minor <= max_minor; ++minor)
+    {
+        int32 x = WrapCoordinate(is_steep ? minor : major, buffer->width);
+        int32 y = WrapCoordinate(is_steep ? major : minor, buffer->height);
+        uint32 *pixel = (uint32 *)((uint8 *)buffer->memory + y * buffer->pitch) + x;
+        if (*pixel)
+        {
+            result = (result == INT32_MIN) ? minor : INT32_MAX; // INT32_MAX: more than one.
+            *pixel = 0;
+        }
+    }
+    return result;
+}
+
+// NOTE(mara): Where the two versions disagree, and how. Every line is drawn on its own into both
+// (empty) buffers, then compared column by column along its major axis. The game snaps the ends to
+// 1/256 of a pixel and steps an exact integer slope, where the old version kept float ends and
+// added up its error in floats. So they should only disagree where the line passes almost exactly
+// halfway between two pixels (one step across) and on end pixels that round the other way. The
+// exception is lines starting off the left or top edge: the old version rounded negative
+// coordinates toward zero, which moves the whole line over by a pixel.
+internal void BenchClassifyLineDifferences(GameOffscreenBuffer *buffer, GameOffscreenBuffer *reference_buffer,
+                                           BenchLine *lines, int32 line_count)
+{
+    int32 differing_line_count = 0;
+    int64 one_step_count = 0;
+    int64 end_pixel_count = 0;
+    int64 off_edge_count = 0;
+    int64 other_count = 0;
+
+    for (int32 i = 0; i < line_count; ++i)
+    {
+        BenchLine *line = &lines[i];
+        BenchRasterizeLine(buffer, line, 1.0f, 1.0f, 1.0f);
+        ReferenceDrawLine(reference_buffer, line->x0, line->y0, line->x1, line->y1, 1.0f, 1.0f, 1.0f);
+
+        bool32 is_steep = (Abs(line->y1 - line->y0) > Abs(line->x1 - line->x0));
+        float32 major0 = is_steep ? line->y0 : line->x0;
+        float32 major1 = is_steep ? line->y1 : line->x1;
+        float32 minor0 = is_steep ? line->x0 : line->y0;
+        float32 minor1 = is_steep ? line->x1 : line->y1;
+        int32 min_major = FloorFloat32ToInt32((major0 < major1) ? major0 : major1) - 2;
+        int32 max_major = FloorFloat32ToInt32((major0 < major1) ? major1 : major0) + 3;
+        int32 min_minor = FloorFloat32ToInt32((minor0 < minor1) ? minor0 : minor1) - 2;
+        int32 max_minor = FloorFloat32ToInt32((minor0 < minor1) ? minor1 : minor0) + 3;
+
+        // The old version walks from the end with the lower major coordinate.
+        float32 start_major = (major0 < major1) ? major0 : major1;
+        float32 start_minor = (major0 < major1) ? minor0 : minor1;
+        bool32 starts_off_edge = (start_major < -0.5f || start_minor < -0.5f);
+
+        bool32 is_different = false;
+        for (int32 major = min_major; major <= max_major; ++major)
+        {
+            int32 minor = BenchTakeLinePixel(buffer, is_steep, major, min_minor, max_minor);
+            int32 reference_minor = BenchTakeLinePixel(reference_buffer, is_steep, major, min_minor, max_minor);
+            if (minor == reference_minor)
+            {
+                continue;
+            }
+
+            is_different = true;
+            if (starts_off_edge)
+            {
+                ++off_edge_count;
+            }
+            else if (minor == INT32_MIN || reference_minor == INT32_MIN)
+            {
+                ++end_pixel_count;
+            }
+            else if (minor != INT32_MAX && reference_minor != INT32_MAX && AbsInt32(minor - reference_minor) == 1)
+            {
+                ++one_step_count;
+            }
+            else
+            {
+                ++other_count;
+            }
+        }
+        differing_line_count += is_different;
+    }
+
+    printf("| %-12s | one at a time: %d of %d lines differ: %lld columns one step across, %lld end pixels, "
+           "%lld on lines starting off the edge, %lld other |\n",
+           "", differing_line_count, line_count, (long long)one_step_count, (long long)end_pixel_count,
+           (long long)off_edge_count, (long long)other_count);
+}
+
+// NOTE(mara): Run once on a buffer the size of the game's, where most stores miss the cache and
+// the memory system sets the pace, and once on a buffer small enough to stay in the cache, which
+// shows what the rasterizer itself costs.
+internal void BenchLines(char *name, int32 width, int32 height)
+{
+    GameOffscreenBuffer buffer = BenchAllocateBuffer(width, height);
+    GameOffscreenBuffer reference_buffer = BenchAllocateBuffer(width, height);
+
+    // Mostly asteroid-edge sized lines anywhere on the torus, so a fair share of them wrap.
+    BenchLine *lines = (BenchLine *)malloc(BENCH_LINE_COUNT * sizeof(BenchLine));
+    int64 pixel_count = 0;
+    for (int32 i = 0; i < BENCH_LINE_COUNT; ++i)
+    {
+        BenchLine *line = &lines[i];
+        float32 length = BenchRandomFloat32(4.0f, 64.0f);
+        float32 angle = BenchRandomFloat32(0.0f, TWO_PI_32);
+        line->x0 = BenchRandomFloat32(0.0f, (float32)buffer.width);
+        line->y0 = BenchRandomFloat32(0.0f, (float32)buffer.height);
+        line->x1 = line->x0 + Cos(angle) * length;
+        line->y1 = line->y0 + Sin(angle) * length;
+
+        float32 major_x = Abs(line->x1 - line->x0);
+        float32 major_y = Abs(line->y1 - line->y0);
+        float32 major = (major_x > major_y) ? major_x : major_y;
+        pixel_count += (int64)major + 1;
+    }
+
+    // Both versions have to agree before their speed means anything.
+    int64 mismatched_pixels = 0;
+    for (int32 i = 0; i < BENCH_LINE_COUNT; ++i)
+    {
+        BenchLine *line = &lines[i];
+        BenchRasterizeLine(&buffer, line, 1.0f, 1.0f, 1.0f);
+        ReferenceDrawLine(&reference_buffer, line->x0, line->y0, line->x1, line->y1, 1.0f, 1.0f, 1.0f);
+    }
+    uint32 *pixels = (uint32 *)buffer.memory;
+    uint32 *reference_pixels = (uint32 *)reference_buffer.memory;
+    for (int32 i = 0; i < buffer.width * buffer.height; ++i)
+    {
+        mismatched_pixels += (pixels[i] != reference_pixels[i]);
+    }
+
+    // Alternate between the versions and keep the best run of each, so a noisy neighbour or a clock
+    // change hits both of them instead of whichever happened to be running.
+    float64 per_second[2] = {};
+    for (int32 run = 0; run < BENCH_RUN_COUNT; ++run)
+    {
+        for (int32 version = 0; version < 2; ++version)
+        {
+            int64 passes = 0;
+            float64 start = BenchGetSeconds();
+            float64 elapsed = 0.0;
+            do
+            {
+                for (int32 i = 0; i < BENCH_LINE_COUNT; ++i)
+                {
+                    BenchLine *line = &lines[i];
+                    if (version == 0)
+                    {
+                        ReferenceDrawLine(&reference_buffer, line->x0, line->y0, line->x1, line->y1,
+                                          0.5f, 0.5f, 0.5f);
+                    }
+                    else
+                    {
+                        BenchRasterizeLine(&buffer, line, 0.5f, 0.5f, 0.5f);
+                    }
+                }
+                ++passes;
+                elapsed = BenchGetSeconds() - start;
+            } while (elapsed < BENCH_RUN_SECONDS);
+
+            float64 run_per_second = (float64)(passes * BENCH_LINE_COUNT) / elapsed;
+            if (run_per_second > per_second[version])
+            {
+                per_second[version] = run_per_second;
+            }
+        }
+    }
+
+    BenchPrintResult(name, "lines", per_second[0], per_second[1]);
+    printf("| %-12s | %lld pixels per pass, %lld differ from the reference |\n",
+           "", (long long)pixel_count, (long long)mismatched_pixels);
+
+    memset(buffer.memory, 0, buffer.height * buffer.pitch);
+    memset(reference_buffer.memory, 0, reference_buffer.height * reference_buffer.pitch);
+    BenchClassifyLineDifferences(&buffer, &reference_buffer, lines, BENCH_LINE_COUNT);
+
+    free(lines);
+    free(reference_buffer.memory);
+    free(buffer.memory);
+}
+
+// =================================================================================================
+// SMOOTH LINES
+// =================================================================================================
+
+inline void BenchRasterizeSmoothLine(GameOffscreenBuffer *buffer, BenchLine *line, uint32 color)
+{
+    GameRect clip = GetBufferRect(buffer);
+    RasterizeSmoothLine(buffer, &clip,
+                        SnapToLineSubpixels(line->x0), SnapToLineSubpixels(line->y0),
+                        SnapToLineSubpixels(line->x1), SnapToLineSubpixels(line->y1),
+                        color);
+}
+
+// NOTE(mara): The frame smooth lines have to fit in: every asteroid slot filled with a large
+// asteroid at 2560x1440, drawn both ways. There's no reference to agree with, so instead every line
+// is also drawn on its own onto black, where each column it crosses has to add up to the full colour
+// (give or take the rounding of its two pixels).
+internal void BenchSmoothLines(char *name, int32 width, int32 height)
+{
+    GameOffscreenBuffer buffer = BenchAllocateBuffer(width, height);
+
+    int32 line_count = MAX_ASTEROIDS * MAX_ASTEROID_POINTS;
+    BenchLine *lines = (BenchLine *)malloc(line_count * sizeof(BenchLine));
+    for (int32 asteroid_index = 0; asteroid_index < MAX_ASTEROIDS; ++asteroid_index)
+    {
+        float32 centre_x = BenchRandomFloat32(0.0f, (float32)width);
+        float32 centre_y = BenchRandomFloat32(0.0f, (float32)height);
+        Vector2 points[MAX_ASTEROID_POINTS];
+        for (int32 point = 0; point < MAX_ASTEROID_POINTS; ++point)
+        {
+            float32 radians = TWO_PI_32 * (float32)point / (float32)MAX_ASTEROID_POINTS;
+            float32 radius = BenchRandomFloat32(45.0f, 75.0f);
+            points[point].x = centre_x + Cos(radians) * radius;
+            points[point].y = centre_y + Sin(radians) * radius;
+        }
+        for (int32 point = 0; point < MAX_ASTEROID_POINTS; ++point)
+        {
+            BenchLine *line = &lines[asteroid_index * MAX_ASTEROID_POINTS + point];
+            Vector2 *next = &points[(point + 1) % MAX_ASTEROID_POINTS];
+            *line = { points[point].x, points[point].y, next->x, next->y };
+        }
+    }
+
+    int32 uneven_line_count = 0;
+    uint32 *pixels = (uint32 *)buffer.memory;
+    for (int32 line_index = 0; line_index < line_count; ++line_index)
+    {
+        memset(buffer.memory, 0, (size_t)buffer.pitch * buffer.height);
+        BenchRasterizeSmoothLine(&buffer, &lines[line_index], 0xFFFFFF);
+
+        int64 total = 0;
+        for (int32 i = 0; i < buffer.width * buffer.height; ++i)
+        {
+            total += pixels[i] & 0xFF;
+        }
+
+        // The columns whose centres lie between the ends, like RasterizeSmoothLine counts them.
+        BenchLine *line = &lines[line_index];
+        bool32 is_x_major = (AbsInt32(SnapToLineSubpixels(line->x1) - SnapToLineSubpixels(line->x0)) >=
+                             AbsInt32(SnapToLineSubpixels(line->y1) - SnapToLineSubpixels(line->y0)));
+        int32 start = is_x_major ? SnapToLineSubpixels(line->x0) : SnapToLineSubpixels(line->y0);
+        int32 end = is_x_major ? SnapToLineSubpixels(line->x1) : SnapToLineSubpixels(line->y1);
+        int32 round_up = (1 << LINE_SUBPIXEL_BITS) - 1 - (1 << (LINE_SUBPIXEL_BITS - 1));
+        int64 column_count = AbsInt32(((end + round_up) >> LINE_SUBPIXEL_BITS) -
+                                      ((start + round_up) >> LINE_SUBPIXEL_BITS));
+        int64 difference = total - column_count * 255;
+        if (difference < -2 * column_count || difference > 0)
+        {
+            ++uneven_line_count;
+        }
+    }
+
+    float64 seconds_per_frame[2] = { 1e9, 1e9 };
+    uint32 color = MakeColor(0.94f, 0.94f, 0.94f);
+    for (int32 run = 0; run < BENCH_RUN_COUNT; ++run)
+    {
+        for (int32 version = 0; version < 2; ++version)
+        {
+            int64 frames = 0;
+            float64 start = BenchGetSeconds();
+            float64 elapsed = 0.0;
+            do
+            {
+                for (int32 line_index = 0; line_index < line_count; ++line_index)
+                {
+                    BenchLine *line = &lines[line_index];
+                    if (version == 0)
+                    {
+                        BenchRasterizeLine(&buffer, line, 0.94f, 0.94f, 0.94f);
+                    }
+                    else
+                    {
+                        BenchRasterizeSmoothLine(&buffer, line, color);
+                    }
+                }
+                ++frames;
+                elapsed = BenchGetSeconds() - start;
+            } while (elapsed < BENCH_RUN_SECONDS);
+
+            float64 run_seconds_per_frame = elapsed / (float64)frames;
+            if (run_seconds_per_frame < seconds_per_frame[version])
+            {
+                seconds_per_frame[version] = run_seconds_per_frame;
+            }
+        }
+    }
+
+    printf("| %-12s | aliased %8.4f ms/frame | smooth %8.4f ms/frame | %5.2fx | %d lines, %d uneven |\n",
+           name, seconds_per_frame[0] * 1000.0, seconds_per_frame[1] * 1000.0,
+           seconds_per_frame[1] / seconds_per_frame[0], line_count, uneven_line_count);
+
+    free(lines);
+    free(buffer.memory);
+}
+
+// =================================================================================================
+// GLYPHS
+// =================================================================================================
+
+// NOTE(mara): How RasterizeGlyph used to draw (coverage into the unused alpha byte, over whatever
+// was there), as the speed to beat. It's not what the blend does, so only the speed is compared;
+// the kernels are checked against BlendGlyphPixel instead.
+internal void ReferenceRasterizeGlyph(GameOffscreenBuffer *buffer, FontGlyph *glyph, int32 x, int32 y,
+                                      uint32 color)
+{
+    uint8 *src_row = glyph->coverage;
+    uint8 *dest_row = (uint8 *)buffer->memory + x * buffer->bytes_per_pixel + y * buffer->pitch;
+    for (int32 this_y = 0; this_y < glyph->height; ++this_y)
+    {
+        uint8 *src = src_row;
+        uint32 *dest = (uint32 *)dest_row;
+        for (int32 this_x = 0; this_x < glyph->width; ++this_x)
+        {
+            uint8 alpha = *src++;
+            if (alpha != 0)
+            {
+                *dest = (alpha << 24) | color;
+            }
+            dest++;
+        }
+        src_row += glyph->width;
+        dest_row += buffer->pitch;
+    }
+}
+
+enum BenchGlyphVersion
+{
+    BENCH_GLYPH_REFERENCE,
+    BENCH_GLYPH_SSE2,
+    BENCH_GLYPH_AVX2,
+
+    BENCH_GLYPH_VERSION_COUNT
+};
+
+global char *bench_glyph_version_names[BENCH_GLYPH_VERSION_COUNT] = { "reference", "sse2", "avx2" };
+
+internal void BenchDrawGlyph(int32 version, GameOffscreenBuffer *buffer, FontGlyph *glyph,
+                             int32 x, int32 y, uint32 color)
+{
+    uint8 *dest_row = (uint8 *)buffer->memory + x * buffer->bytes_per_pixel + y * buffer->pitch;
+    if (version == BENCH_GLYPH_SSE2)
+    {
+        BlendGlyphSSE2(dest_row, buffer->pitch, glyph->coverage, glyph->width,
+                       glyph->width, glyph->height, color);
+    }
+    else
+    {
+        BlendGlyphAVX2(dest_row, buffer->pitch, glyph->coverage, glyph->width,
+                       glyph->width, glyph->height, color);
+    }
+}
+
+#define BENCH_GLYPH_COUNT 16
+#define BENCH_GLYPH_DRAW_COUNT 4096
+
+// NOTE(mara): Letter-sized rings: mostly empty, a solid stroke, and an anti-aliased edge either side
+// of it, which is about the mix of coverage a real glyph has.
+internal void BenchGlyphs(char *name, int32 pixel_height)
+{
+    GameOffscreenBuffer buffer = BenchAllocateBuffer(1366, 768);
+
+    FontGlyph glyphs[BENCH_GLYPH_COUNT];
+    for (int32 glyph_index = 0; glyph_index < BENCH_GLYPH_COUNT; ++glyph_index)
+    {
+        FontGlyph *glyph = &glyphs[glyph_index];
+        glyph->width = pixel_height / 2 + (rand() % (pixel_height / 2));
+        glyph->height = pixel_height;
+        glyph->coverage = (uint8 *)malloc(glyph->width * glyph->height + GLYPH_COVERAGE_PADDING);
+        float32 radius = BenchRandomFloat32(0.3f, 0.45f) * (float32)glyph->width;
+        float32 stroke = 0.08f * (float32)pixel_height + 0.5f;
+        for (int32 y = 0; y < glyph->height; ++y)
+        {
+            for (int32 x = 0; x < glyph->width; ++x)
+            {
+                float32 dx = (float32)x + 0.5f - 0.5f * (float32)glyph->width;
+                float32 dy = ((float32)y + 0.5f - 0.5f * (float32)glyph->height) * 0.7f;
+                float32 distance = Abs(Sqrt(dx * dx + dy * dy) - radius);
+                float32 coverage = stroke - distance;
+                coverage = (coverage < 0.0f) ? 0.0f : (coverage > 1.0f) ? 1.0f : coverage;
+                glyph->coverage[y * glyph->width + x] = (uint8)RoundFloat32ToInt32(coverage * 255.0f);
+            }
+        }
+    }
+
+    int32 *positions = (int32 *)malloc(BENCH_GLYPH_DRAW_COUNT * 2 * sizeof(int32));
+    for (int32 i = 0; i < BENCH_GLYPH_DRAW_COUNT; ++i)
+    {
+        positions[i * 2 + 0] = rand() % (buffer.width - pixel_height);
+        positions[i * 2 + 1] = rand() % (buffer.height - pixel_height);
+    }
+
+    // Every kernel, on every width, against the blend one pixel at a time.
+    int64 mismatched_pixels = 0;
+    uint32 *expected = (uint32 *)malloc(64 * sizeof(uint32));
+    uint32 *actual = (uint32 *)malloc(64 * sizeof(uint32));
+    uint8 *coverage = (uint8 *)malloc(64 + GLYPH_COVERAGE_PADDING);
+    for (int32 trial = 0; trial < 4096; ++trial)
+    {
+        int32 count = rand() % 64;
+        uint32 color = (uint32)rand() & 0xFFFFFF;
+        for (int32 i = 0; i < count; ++i)
+        {
+            expected[i] = ((uint32)rand() << 16) ^ (uint32)rand();
+            int32 kind = rand() % 4;
+            coverage[i] = (uint8)((kind == 0) ? 0 : (kind == 1) ? 255 : rand() % 256);
+        }
+        for (int32 version = BENCH_GLYPH_SSE2; version < BENCH_GLYPH_VERSION_COUNT; ++version)
+        {
+            if (version == BENCH_GLYPH_AVX2 && bench_simd_level < SIMD_LEVEL_AVX2)
+            {
+                continue;
+            }
+            memcpy(actual, expected, count * sizeof(uint32));
+            if (version == BENCH_GLYPH_SSE2)
+            {
+                BlendGlyphSSE2((uint8 *)actual, 0, coverage, 0, count, 1, color);
+            }
+            else
+            {
+                BlendGlyphAVX2((uint8 *)actual, 0, coverage, 0, count, 1, color);
+            }
+            for (int32 i = 0; i < count; ++i)
+            {
+                uint32 pixel = (coverage[i] != 0) ? BlendGlyphPixel(expected[i], color, coverage[i]) : expected[i];
+                mismatched_pixels += (actual[i] != pixel);
+            }
+        }
+    }
+
+    float64 glyphs_per_second[BENCH_GLYPH_VERSION_COUNT] = {};
+    for (int32 run = 0; run < BENCH_RUN_COUNT; ++run)
+    {
+        for (int32 version = 0; version < BENCH_GLYPH_VERSION_COUNT; ++version)
+        {
+            if (version == BENCH_GLYPH_AVX2 && bench_simd_level < SIMD_LEVEL_AVX2)
+            {
+                continue;
+            }
+
+            int64 passes = 0;
+            float64 start = BenchGetSeconds();
+            float64 elapsed = 0.0;
+            do
+            {
+                for (int32 i = 0; i < BENCH_GLYPH_DRAW_COUNT; ++i)
+                {
+                    FontGlyph *glyph = &glyphs[i % BENCH_GLYPH_COUNT];
+                    int32 x = positions[i * 2 + 0];
+                    int32 y = positions[i * 2 + 1];
+                    if (version == BENCH_GLYPH_REFERENCE)
+                    {
+                        ReferenceRasterizeGlyph(&buffer, glyph, x, y, 0xBFBFBF);
+                    }
+                    else
+                    {
+                        BenchDrawGlyph(version, &buffer, glyph, x, y, 0xBFBFBF);
+                    }
+                }
+                ++passes;
+                elapsed = BenchGetSeconds() - start;
+            } while (elapsed < BENCH_RUN_SECONDS);
+
+            float64 run_per_second = (float64)(passes * BENCH_GLYPH_DRAW_COUNT) / elapsed;
+            if (run_per_second > glyphs_per_second[version])
+            {
+                glyphs_per_second[version] = run_per_second;
+            }
+        }
+    }
+
+    for (int32 version = 0; version < BENCH_GLYPH_VERSION_COUNT; ++version)
+    {
+        if (glyphs_per_second[version] > 0.0)
+        {
+            printf("| %-12s | %-11s | %7.2f Mglyphs/s | %5.2fx |\n",
+                   name, bench_glyph_version_names[version], glyphs_per_second[version] / 1e6,
+                   glyphs_per_second[version] / glyphs_per_second[BENCH_GLYPH_REFERENCE]);
+        }
+    }
+    printf("| %-12s | %lld pixels differ from the blend one pixel at a time |\n",
+           "", (long long)mismatched_pixels);
+
+    for (int32 glyph_index = 0; glyph_index < BENCH_GLYPH_COUNT; ++glyph_index)
+    {
+        free(glyphs[glyph_index].coverage);
+    }
+    free(coverage);
+    free(actual);
+    free(expected);
+    free(positions);
+    free(buffer.memory);
+}
+
+// =================================================================================================
+// SEGMENT TESTS
+// =================================================================================================
+
+// NOTE(mara): The collision tests as they were before they lost their divisions and square root.
+internal bool32 ReferenceTestLineIntersection(Vector2 a, Vector2 b, Vector2 c, Vector2 d)
+{
+    float32 alpha_numerator = ((d.x - c.x) * (c.y - a.y)) - ((d.y - c.y) * (c.x - a.x));
+    float32 beta_numerator = ((b.x - a.x) * (c.y - a.y)) - ((b.y - a.y) * (c.x - a.x));
+    float32 denominator = ((d.x - c.x) * (b.y - a.y)) - ((d.y - c.y) * (b.x - a.x));
+
+    float32 alpha = alpha_numerator / denominator;
+    float32 beta = beta_numerator / denominator;
+    return alpha >= 0.0f && alpha <= 1.0f && beta >= 0.0f && beta <= 1.0f;
+}
+
+internal bool32 ReferenceTestLineCircleIntersection(Vector2 line_a, Vector2 line_b,
+                                                    Vector2 circle_pos, float32 circle_radius)
+{
+    Vector2 closest = line_a;
+    Vector2 tangent = line_b - line_a;
+    if (Dot((circle_pos - line_a), tangent) > 0.0f)
+    {
+        closest = line_b;
+        if (Dot((circle_pos - line_b), tangent) < 0.0f)
+        {
+            float32 mag = Magnitude(tangent);
+            Vector2 norm_tangent = { tangent.x * (1.0f / mag), tangent.y * (1.0f / mag) };
+            float32 dot = Dot(norm_tangent, circle_pos - line_a);
+            closest = { line_a.x + norm_tangent.x * dot, line_a.y + norm_tangent.y * dot };
+        }
+    }
+    Vector2 delta = circle_pos - closest;
+    return Dot(delta, delta) <= (circle_radius * circle_radius);
+}
+
+// The game's swept test, put together from the tests above.
+internal bool32 ReferenceTestSweptCircleIntersection(Vector2 line_a, Vector2 line_b,
+                                                     Vector2 circle_from, Vector2 circle_to, float32 circle_radius)
+{
+    return (ReferenceTestLineIntersection(circle_from, circle_to, line_a, line_b) ||
+            ReferenceTestLineCircleIntersection(line_a, line_b, circle_to, circle_radius) ||
+            ReferenceTestLineCircleIntersection(line_a, line_b, circle_from, circle_radius) ||
+            ReferenceTestLineCircleIntersection(circle_from, circle_to, line_a, circle_radius) ||
+            ReferenceTestLineCircleIntersection(circle_from, circle_to, line_b, circle_radius));
+}
+
+enum BenchEdgesVersion
+{
+    BENCH_EDGES_REFERENCE, // One pair at a time, with the tests above.
+    BENCH_EDGES_SCALAR,    // One pair at a time, with the game's tests.
+    BENCH_EDGES_SSE2,
+    BENCH_EDGES_AVX2,
+    BENCH_EDGES_AVX512,
+
+    BENCH_EDGES_VERSION_COUNT
+};
+
+global char *bench_edges_version_names[BENCH_EDGES_VERSION_COUNT] =
+{
+    "reference", "scalar", "sse2", "avx2", "avx512",
+};
+
+global SimdLevel bench_edges_version_levels[BENCH_EDGES_VERSION_COUNT] =
+{
+    SIMD_LEVEL_SSE2, SIMD_LEVEL_SSE2, SIMD_LEVEL_SSE2, SIMD_LEVEL_AVX2, SIMD_LEVEL_AVX512,
+};
+
+// For circles, the centre moves from a to b.
+internal uint64 BenchTestEdges(int32 version, bool32 is_circle, EdgeArrays *edges, int32 word_index,
+                               uint64 candidates, Vector2 a, Vector2 b, float32 radius)
+{
+    int32 first_edge = word_index * 64;
+    uint64 hits = 0;
+    switch (version)
+    {
+        case BENCH_EDGES_REFERENCE:
+        case BENCH_EDGES_SCALAR:
+        {
+            while (candidates)
+            {
+                int32 lane = TakeLowestSetBit(&candidates);
+                Vector2 c = { edges->a_x[first_edge + lane], edges->a_y[first_edge + lane] };
+                Vector2 d = { edges->b_x[first_edge + lane], edges->b_y[first_edge + lane] };
+                bool32 hit;
+                if (version == BENCH_EDGES_REFERENCE)
+                {
+                    hit = is_circle ? ReferenceTestSweptCircleIntersection(c, d, a, b, radius) : ReferenceTestLineIntersection(a, b, c, d);
+                }
+                else
+                {
+                    hit = is_circle ? TestSweptCircleIntersection(c, d, a, b, radius) : TestLineIntersection(a, b, c, d);
+                }
+                hits |= (uint64)(hit ? 1 : 0) << lane;
+            }
+        } break;
+        case BENCH_EDGES_SSE2:
+        {
+            hits = is_circle ? TestSweptCircleEdgesSSE2(edges, first_edge, candidates, a, b, radius) : TestSegmentEdgesSSE2(edges, first_edge, candidates, a, b);
+        } break;
+        case BENCH_EDGES_AVX2:
+        {
+            hits = is_circle ? TestSweptCircleEdgesAVX2(edges, first_edge, candidates, a, b, radius) : TestSegmentEdgesAVX2(edges, first_edge, candidates, a, b);
+        } break;
+        case BENCH_EDGES_AVX512:
+        {
+            hits = is_circle ? TestSweptCircleEdgesAVX512(edges, first_edge, candidates, a, b, radius) : TestSegmentEdgesAVX512(edges, first_edge, candidates, a, b);
+        } break;
+    }
+    return hits;
+}
+
+inline Vector2 BenchRandomPoint(float32 size, bool32 is_snapped)
+{
+    Vector2 result = { BenchRandomFloat32(0.0f, size), BenchRandomFloat32(0.0f, size) };
+    if (is_snapped)
+    {
+        result.x = (float32)RoundFloat32ToInt32(result.x);
+        result.y = (float32)RoundFloat32ToInt32(result.y);
+    }
+    return result;
+}
+
+// NOTE(mara): A dense asteroid field: every slot holds an asteroid-sized ring of edges, all of them
+// crowded into a square a few asteroids across. Every other ring is snapped to whole pixels, where
+// the awkward cases (shared end points, collinear and zero-length edges) come up exactly.
+internal void BenchFillEdges(EdgeArrays *edges, float32 size)
+{
+    for (int32 asteroid_index = 0; asteroid_index < MAX_ASTEROIDS; ++asteroid_index)
+    {
+        bool32 is_snapped = (asteroid_index % 2 == 1);
+        Vector2 center = BenchRandomPoint(size, false);
+        float32 radius = BenchRandomFloat32(8.0f, 48.0f);
+        Vector2 points[MAX_ASTEROID_POINTS];
+        for (int32 point_index = 0; point_index < MAX_ASTEROID_POINTS; ++point_index)
+        {
+            float32 angle = ((float32)point_index + BenchRandomFloat32(-0.3f, 0.3f)) * (TWO_PI_32 / MAX_ASTEROID_POINTS);
+            float32 distance = radius * BenchRandomFloat32(0.6f, 1.0f);
+            points[point_index] = { center.x + Cos(angle) * distance, center.y + Sin(angle) * distance };
+            if (is_snapped)
+            {
+                points[point_index].x = (float32)RoundFloat32ToInt32(points[point_index].x);
+                points[point_index].y = (float32)RoundFloat32ToInt32(points[point_index].y);
+            }
+        }
+        if (is_snapped)
+        {
+            points[1] = points[0]; // A zero-length edge.
+        }
+        for (int32 point_index = 0; point_index < MAX_ASTEROID_POINTS; ++point_index)
+        {
+            int32 edge = asteroid_index * MAX_ASTEROID_POINTS + point_index;
+            edges->a_x[edge] = points[point_index].x;
+            edges->a_y[edge] = points[point_index].y;
+            edges->b_x[edge] = points[(point_index + 1) % MAX_ASTEROID_POINTS].x;
+            edges->b_y[edge] = points[(point_index + 1) % MAX_ASTEROID_POINTS].y;
+        }
+    }
+}
+
+// A query segment (or circle path) that's sometimes one of the edges, or starts on an end point. A
+// circle that doesn't move (b = a) gets the plain circle test.
+internal void BenchRandomQuery(EdgeArrays *edges, float32 size, Vector2 *a, Vector2 *b, float32 *radius)
+{
+    int32 edge = rand() % (MAX_ASTEROIDS * MAX_ASTEROID_POINTS);
+    Vector2 edge_a = { edges->a_x[edge], edges->a_y[edge] };
+    Vector2 edge_b = { edges->b_x[edge], edges->b_y[edge] };
+    bool32 is_snapped = (rand() % 2 == 0);
+
+    *a = BenchRandomPoint(size, is_snapped);
+    *b = *a + Vector2{ BenchRandomFloat32(-24.0f, 24.0f), BenchRandomFloat32(-24.0f, 24.0f) };
+    *radius = BenchRandomFloat32(1.0f, 12.0f);
+    switch (rand() % 8)
+    {
+        case 0: { *a = edge_a; *b = edge_b; } break;
+        case 1: { *a = edge_b; *b = edge_a; } break;
+        case 2: { *a = edge_b; } break;
+        case 3: { *b = *a; } break;
+        case 4: { *radius = 0.0f; } break;
+    }
+}
+
+#define BENCH_EDGES_QUERY_COUNT 1024
+
+// NOTE(mara): Times one segment (player or UFO edge) or swept circle (bullet) against every asteroid edge,
+// the worst case the narrowphase meets, after checking every kernel against the scalar test on
+// random candidate words of every density.
+internal void BenchEdges(char *name, bool32 is_circle)
+{
+    float32 size = 160.0f;
+    EdgeArrays *edges = (EdgeArrays *)calloc(1, sizeof(EdgeArrays));
+    BenchFillEdges(edges, size);
+
+    uint64 all_edges[COLLISION_ASTEROID_EDGE_WORDS];
+    for (int32 word_index = 0; word_index < COLLISION_ASTEROID_EDGE_WORDS; ++word_index)
+    {
+        int32 edges_in_word = MAX_ASTEROIDS * MAX_ASTEROID_POINTS - word_index * 64;
+        all_edges[word_index] = (edges_in_word >= 64) ? ~(uint64)0 : (((uint64)1 << edges_in_word) - 1);
+    }
+
+    int64 mismatched_tests = 0;
+    int64 reference_differences = 0;
+    int64 tests = 0;
+    int64 total_hits = 0;
+    for (int32 trial = 0; trial < 65536; ++trial)
+    {
+        Vector2 a, b;
+        float32 radius;
+        BenchRandomQuery(edges, size, &a, &b, &radius);
+
+        int32 word_index = rand() % COLLISION_ASTEROID_EDGE_WORDS;
+        uint64 candidates = all_edges[word_index];
+        int32 thinning = rand() % 4;
+        for (int32 i = 0; i < thinning; ++i)
+        {
+            candidates &= ((uint64)rand() << 48) ^ ((uint64)rand() << 32) ^ ((uint64)rand() << 16) ^ (uint64)rand();
+        }
+
+        uint64 expected = BenchTestEdges(BENCH_EDGES_SCALAR, is_circle, edges, word_index, candidates, a, b, radius);
+        uint64 reference = BenchTestEdges(BENCH_EDGES_REFERENCE, is_circle, edges, word_index, candidates, a, b, radius);
+        reference_differences += CountSetBits(expected ^ reference);
+        total_hits += CountSetBits(expected);
+        tests += CountSetBits(candidates);
+        for (int32 version = BENCH_EDGES_SSE2; version < BENCH_EDGES_VERSION_COUNT; ++version)
+        {
+            if (bench_simd_level < bench_edges_version_levels[version])
+            {
+                continue;
+            }
+            uint64 actual = BenchTestEdges(version, is_circle, edges, word_index, candidates, a, b, radius);
+            mismatched_tests += CountSetBits(actual ^ expected);
+        }
+    }
+
+    Vector2 *queries = (Vector2 *)malloc(BENCH_EDGES_QUERY_COUNT * 2 * sizeof(Vector2));
+    float32 *radii = (float32 *)malloc(BENCH_EDGES_QUERY_COUNT * sizeof(float32));
+    for (int32 i = 0; i < BENCH_EDGES_QUERY_COUNT; ++i)
+    {
+        BenchRandomQuery(edges, size, &queries[i * 2 + 0], &queries[i * 2 + 1], &radii[i]);
+    }
+
+    float64 tests_per_second[BENCH_EDGES_VERSION_COUNT] = {};
+    uint64 checksum = 0;
+    for (int32 run = 0; run < BENCH_RUN_COUNT; ++run)
+    {
+        for (int32 version = 0; version < BENCH_EDGES_VERSION_COUNT; ++version)
+        {
+            if (bench_simd_level < bench_edges_version_levels[version])
+            {
+                continue;
+            }
+
+            int64 passes = 0;
+            float64 start = BenchGetSeconds();
+            float64 elapsed = 0.0;
+            do
+            {
+                for (int32 i = 0; i < BENCH_EDGES_QUERY_COUNT; ++i)
+                {
+                    for (int32 word_index = 0; word_index < COLLISION_ASTEROID_EDGE_WORDS; ++word_index)
+                    {
+                        checksum += BenchTestEdges(version, is_circle, edges, word_index, all_edges[word_index],
+                                                   queries[i * 2 + 0], queries[i * 2 + 1], radii[i]);
+                    }
+                }
+                ++passes;
+                elapsed = BenchGetSeconds() - start;
+            } while (elapsed < BENCH_RUN_SECONDS);
+
+            float64 run_per_second = (float64)(passes * BENCH_EDGES_QUERY_COUNT * MAX_ASTEROIDS * MAX_ASTEROID_POINTS) / elapsed;
+            if (run_per_second > tests_per_second[version])
+            {
+                tests_per_second[version] = run_per_second;
+            }
+        }
+    }
+
+    for (int32 version = 0; version < BENCH_EDGES_VERSION_COUNT; ++version)
+    {
+        if (tests_per_second[version] > 0.0)
+        {
+            printf("| %-12s | %-11s | %7.2f Mtests/s | %5.2fx |\n",
+                   name, bench_edges_version_names[version], tests_per_second[version] / 1e6,
+                   tests_per_second[version] / tests_per_second[BENCH_EDGES_REFERENCE]);
+        }
+    }
+    printf("| %-12s | %lld of %lld tests (%lld hits) differ from the scalar test, %lld from the reference (checksum %llx) |\n",
+           "", (long long)mismatched_tests, (long long)tests, (long long)total_hits,
+           (long long)reference_differences, (unsigned long long)(checksum & 0xFFFF));
+
+    free(radii);
+    free(queries);
+    free(edges);
+}
+
+// =================================================================================================
+// CLEAR
+// =================================================================================================
+
+enum BenchClearVersion
+{
+    BENCH_CLEAR_REFERENCE, // A filled rectangle over the whole buffer, like GameRender used to.
+    BENCH_CLEAR_SSE2,
+    BENCH_CLEAR_SSE2_STREAMING,
+    BENCH_CLEAR_AVX2,
+    BENCH_CLEAR_AVX2_STREAMING,
+    BENCH_CLEAR_BUFFER, // What ClearBuffer picks for this CPU and buffer size.
+
+    BENCH_CLEAR_VERSION_COUNT
+};
+
+global char *bench_clear_version_names[BENCH_CLEAR_VERSION_COUNT] =
+{
+    "reference", "sse2", "sse2 stream", "avx2", "avx2 stream", "ClearBuffer",
+};
+
+internal void BenchClear(char *name, int32 width, int32 height)
+{
+    GameOffscreenBuffer buffer = BenchAllocateBuffer(width, height);
+    memsize pixel_count = (memsize)width * (memsize)height;
+    uint32 color = MakeColor(0.06f, 0.18f, 0.17f);
+
+    float64 bytes_per_second[BENCH_CLEAR_VERSION_COUNT] = {};
+    for (int32 run = 0; run < BENCH_RUN_COUNT; ++run)
+    {
+        for (int32 version = 0; version < BENCH_CLEAR_VERSION_COUNT; ++version)
+        {
+            if ((version == BENCH_CLEAR_AVX2 || version == BENCH_CLEAR_AVX2_STREAMING) &&
+                bench_simd_level < SIMD_LEVEL_AVX2)
+            {
+                continue;
+            }
+
+            int64 passes = 0;
+            float64 start = BenchGetSeconds();
+            float64 elapsed = 0.0;
+            do
+            {
+                uint32 *pixels = (uint32 *)buffer.memory;
+                switch (version)
+                {
+                    case BENCH_CLEAR_REFERENCE:
+                    {
+                        GameRect buffer_rect = GetBufferRect(&buffer);
+                        RasterizeRectangle(&buffer, &buffer_rect, &buffer_rect, color);
+                    } break;
+                    case BENCH_CLEAR_SSE2: { ClearSpanSSE2(pixels, pixel_count, color, false); } break;
+                    case BENCH_CLEAR_SSE2_STREAMING: { ClearSpanSSE2(pixels, pixel_count, color, true); } break;
+                    case BENCH_CLEAR_AVX2: { ClearSpanAVX2(pixels, pixel_count, color, false); } break;
+                    case BENCH_CLEAR_AVX2_STREAMING: { ClearSpanAVX2(pixels, pixel_count, color, true); } break;
+                    case BENCH_CLEAR_BUFFER: { ClearBuffer(&buffer, color, bench_simd_level); } break;
+                }
+                _mm_sfence();
+                ++passes;
+                elapsed = BenchGetSeconds() - start;
+            } while (elapsed < BENCH_RUN_SECONDS);
+
+            float64 run_bytes_per_second = (float64)(passes * (int64)(pixel_count * 4)) / elapsed;
+            if (run_bytes_per_second > bytes_per_second[version])
+            {
+                bytes_per_second[version] = run_bytes_per_second;
+            }
+        }
+    }
+
+    for (int32 version = 0; version < BENCH_CLEAR_VERSION_COUNT; ++version)
+    {
+        if (bytes_per_second[version] > 0.0)
+        {
+            printf("| %-12s | %-11s | %7.2f GB/s | %5.2fx |\n",
+                   name, bench_clear_version_names[version], bytes_per_second[version] / 1e9,
+                   bytes_per_second[version] / bytes_per_second[BENCH_CLEAR_REFERENCE]);
+        }
+    }
+
+    free(buffer.memory);
+}
+
+// =================================================================================================
+// int main()
+// =================================================================================================
+
+int main(int argc, char *argv[])
+{
+    srand(1);
+    bench_simd_level = DetectSimdLevel();
+
+    BenchLines("lines", 1366, 768);
+    BenchLines("lines cached", 256, 256);
+    BenchSmoothLines("smooth 1440p", 2560, 1440);
+
+    BenchGlyphs("glyphs 20px", 20);
+    BenchGlyphs("glyphs 32px", 32);
+
+    printf("\nsimd level: %s\n", simd_level_names[bench_simd_level]);
+    BenchEdges("segments", false);
+    BenchEdges("swept", true);
+
+    BenchClear("clear 768p", 1366, 768);
+    BenchClear("clear 1080p", 1920, 1080);
+    BenchClear("clear 4k", 3840, 2160);
+
+    return 0;
+}
@@ -4,23 +4,110 @@
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "include/stb_truetype.h"
 
+// NOTE(mara): The .ttf bytes are copied into the asset arena inside the permanent storage, and
+// GameState only remembers where (as an offset from the start of the GameState), so it can be
+// copied anywhere.
+struct FontAsset
+{
+    memsize ttf_offset;
+    uint32 ttf_size;
+};
+
+#define FONT_ATLAS_FIRST_CODEPOINT ' '
+#define FONT_ATLAS_LAST_CODEPOINT '~'
+#define FONT_ATLAS_GLYPH_COUNT (FONT_ATLAS_LAST_CODEPOINT - FONT_ATLAS_FIRST_CODEPOINT + 1)
+#define MAX_FONT_ATLASES 16
+#define FONT_GLYPH_ARENA_SIZE MEGABYTES(4)
+#define MAX_TEXT_LAYOUT_LENGTH 256
+#define TEXT_LAYOUT_CACHE_SIZE 64 // Must be a power of two.
+#define GLYPH_COVERAGE_PADDING 8 // The glyph blend reads coverage up to this far past the end.
+
+struct FontGlyph
+{
+    int32 width;
+    int32 height;
+    int32 x_offset;
+    int32 y_offset;
+    int32 advance; // Already scaled and rounded, like DrawString used to do every letter.
+    // width * height bytes, tightly packed, and GLYPH_COVERAGE_PADDING readable bytes after them.
+    // 0 when the glyph has no pixels.
+    uint8 *coverage;
+};
+
+// NOTE(mara): Every printable ASCII glyph rasterized at one pixel height, along with the scaled
+// kerning between every pair of them, so drawing text is just a lookup and a copy.
+struct FontAtlas
+{
+    float32 pixel_height;
+    float32 scale;
+    FontGlyph glyphs[FONT_ATLAS_GLYPH_COUNT];
+    int16 kerning[FONT_ATLAS_GLYPH_COUNT][FONT_ATLAS_GLYPH_COUNT];
+};
+
+// NOTE(mara): Where every letter of a string goes, relative to where the string starts. The cache
+// keeps a copy of the text, so a string that changes simply stops matching and gets laid out again.
+struct TextLayout
+{
+    uint32 hash; // 0 = empty slot.
+    float32 pixel_height;
+    float32 scale;
+    int32 ascent;
+    FontAtlas *atlas;
+
+    uint32 length;
+    char text[MAX_TEXT_LAYOUT_LENGTH];
+    int32 pen_x[MAX_TEXT_LAYOUT_LENGTH];
+};
+
+// NOTE(mara): stb_truetype keeps raw pointers into the .ttf bytes, so FontData is a cache that lives
+// in the TransientState and gets rebuilt from the FontAsset whenever the bytes might have moved.
+// Atlases are baked the first time a pixel height is drawn and live in glyph_arena from then on.
 struct FontData
 {
-    ReadFileResult ttf_file;
     stbtt_fontinfo stb_font_info;
     int32 ascent;
     int32 descent;
     int32 line_gap;
+
+    MemoryArena glyph_arena;
+    FontAtlas *atlases[MAX_FONT_ATLASES];
+    int32 atlas_count;
+
+    TextLayout *layouts; // TEXT_LAYOUT_CACHE_SIZE slots, picked by hash.
 };
 
-internal FontData LoadFont()
+internal FontAsset LoadFontAsset(PlatformAPI *platform, MemoryArena *asset_arena, void *state_base)
+{
+    FontAsset result = {};
+
+    ReadFileResult ttf_file = platform->ReadEntireFile("fonts/MapleMono-Regular.ttf");
+    if (ttf_file.content_size != 0)
+    {
+        void *ttf = PushCopy(asset_arena, ttf_file.content_size, ttf_file.content);
+        result.ttf_offset = (memsize)((uint8 *)ttf - (uint8 *)state_base);
+        result.ttf_size = ttf_file.content_size;
+
+        platform->FreeFileMemory(ttf_file.content);
+    }
+
+    return result;
+}
+
+internal FontData InitializeFont(void *ttf, MemoryArena *transient_arena)
 {
     FontData font_data = {};
-    font_data.ttf_file = global_platform.ReadEntireFile("fonts/MapleMono-Regular.ttf");
+    SubArena(&font_data.glyph_arena, transient_arena, FONT_GLYPH_ARENA_SIZE);
+    font_data.layouts = PushArray(&font_data.glyph_arena, TEXT_LAYOUT_CACHE_SIZE, TextLayout);
+
+    // The arena may have held a previous FontData, so the slots start out as whatever it left.
+    for (int32 i = 0; i < TEXT_LAYOUT_CACHE_SIZE; ++i)
+    {
+        font_data.layouts[i].hash = 0;
+    }
 
     font_data.stb_font_info = {};
-    stbtt_InitFont(&font_data.stb_font_info, (uchar8 *)font_data.ttf_file.content,
-                   stbtt_GetFontOffsetForIndex((uchar8 *)font_data.ttf_file.content, 0));
+    stbtt_InitFont(&font_data.stb_font_info, (uchar8 *)ttf,
+                   stbtt_GetFontOffsetForIndex((uchar8 *)ttf, 0));
 
     stbtt_GetFontVMetrics(&font_data.stb_font_info,
                           &font_data.ascent,
@@ -30,4 +117,93 @@ internal FontData LoadFont()
     return font_data;
 }
 
+inline bool32 IsInFontAtlas(char codepoint)
+{
+    return (codepoint >= FONT_ATLAS_FIRST_CODEPOINT && codepoint <= FONT_ATLAS_LAST_CODEPOINT);
+}
+
+internal FontAtlas *BakeFontAtlas(FontData *font, float32 pixel_height)
+{
+    stbtt_fontinfo *info = &font->stb_font_info;
+    float32 scale = stbtt_ScaleForPixelHeight(info, pixel_height);
+
+    memsize coverage_size = 0;
+    for (int32 i = 0; i < FONT_ATLAS_GLYPH_COUNT; ++i)
+    {
+        int32 x0, y0, x1, y1;
+        stbtt_GetCodepointBitmapBox(info, FONT_ATLAS_FIRST_CODEPOINT + i, scale, scale, &x0, &y0, &x1, &y1);
+        coverage_size += (memsize)(x1 - x0) * (memsize)(y1 - y0);
+    }
+
+    coverage_size += GLYPH_COVERAGE_PADDING;
+    if (GetArenaSizeRemaining(&font->glyph_arena, 16) < sizeof(FontAtlas) + coverage_size + 16)
+    {
+        return 0;
+    }
+
+    FontAtlas *atlas = PushStruct(&font->glyph_arena, FontAtlas, 16);
+    atlas->pixel_height = pixel_height;
+    atlas->scale = scale;
+
+    uint8 *coverage = (uint8 *)PushSize(&font->glyph_arena, coverage_size, 1);
+    for (int32 i = 0; i < FONT_ATLAS_GLYPH_COUNT; ++i)
+    {
+        int32 codepoint = FONT_ATLAS_FIRST_CODEPOINT + i;
+        FontGlyph *glyph = &atlas->glyphs[i];
+
+        int32 x0, y0, x1, y1;
+        stbtt_GetCodepointBitmapBox(info, codepoint, scale, scale, &x0, &y0, &x1, &y1);
+        glyph->width = x1 - x0;
+        glyph->height = y1 - y0;
+        glyph->x_offset = x0;
+        glyph->y_offset = y0;
+        glyph->coverage = 0;
+
+        if (glyph->width > 0 && glyph->height > 0)
+        {
+            glyph->coverage = coverage;
+            stbtt_MakeCodepointBitmap(info, coverage, glyph->width, glyph->height, glyph->width,
+                                      scale, scale, codepoint);
+            coverage += glyph->width * glyph->height;
+        }
+
+        int32 advance_width, left_side_bearing;
+        stbtt_GetCodepointHMetrics(info, codepoint, &advance_width, &left_side_bearing);
+        glyph->advance = RoundFloat32ToInt32((float32)advance_width * scale);
+
+        for (int32 j = 0; j < FONT_ATLAS_GLYPH_COUNT; ++j)
+        {
+            int32 kern = stbtt_GetCodepointKernAdvance(info, codepoint, FONT_ATLAS_FIRST_CODEPOINT + j);
+            atlas->kerning[i][j] = (int16)RoundFloat32ToInt32((float32)kern * scale);
+        }
+    }
+
+    return atlas;
+}
+
+// NOTE(mara): Returns 0 when there's no room left for another atlas; callers then fall back to
+// rasterizing every letter themselves.
+internal FontAtlas *GetFontAtlas(FontData *font, float32 pixel_height)
+{
+    for (int32 i = 0; i < font->atlas_count; ++i)
+    {
+        if (font->atlases[i]->pixel_height == pixel_height)
+        {
+            return font->atlases[i];
+        }
+    }
+
+    FontAtlas *atlas = 0;
+    if (font->atlas_count < MAX_FONT_ATLASES)
+    {
+        atlas = BakeFontAtlas(font, pixel_height);
+        if (atlas)
+        {
+            font->atlases[font->atlas_count++] = atlas;
+        }
+    }
+
+    return atlas;
+}
+
 #endif
@@ -34,6 +34,22 @@ inline float32 Abs(float32 value)
     return value > 0 ? value : -value;
 }
 
+inline int32 AbsInt32(int32 value)
+{
+    int32 sign = value >> 31; // All ones when negative.
+    return (value ^ sign) - sign;
+}
+
+inline int32 MinInt32(int32 a, int32 b)
+{
+    return (a < b) ? a : b;
+}
+
+inline int32 MaxInt32(int32 a, int32 b)
+{
+    return (a > b) ? a : b;
+}
+
 inline float32 Sqrt(float32 value)
 {
     // TODO(mara): Test the speed of this function w/ SIMD vs. sqrtf. See if it's actually working
@@ -55,6 +71,11 @@ inline float32 Sin(float32 radians)
     return sinf(radians);
 }
 
+inline float32 Pow(float32 base, float32 exponent)
+{
+    return powf(base, exponent);
+}
+
 inline float32 SqrMagnitude(Vector2 vector)
 {
     return (vector.x * vector.x) + (vector.y * vector.y);
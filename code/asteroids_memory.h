@@ -67,6 +67,27 @@ void *_PushSize(MemoryArena *arena, memsize size_init, memsize alignment = 4)
     return result;
 }
 
+inline void *Copy(memsize size, void *source_init, void *dest_init)
+{
+    uint8 *source = (uint8 *)source_init;
+    uint8 *dest = (uint8 *)dest_init;
+    while (size--)
+    {
+        *dest++ = *source++;
+    }
+
+    return dest_init;
+}
+
+#define PushCopy(arena, size, source, ...) Copy(size, source, _PushSize(arena, size, ## __VA_ARGS__))
+
+// NOTE(mara): Carves a fixed-size arena out of another one, so a system can fill its own memory
+// without ever running into anybody else's temporary memory.
+internal void SubArena(MemoryArena *result, MemoryArena *arena, memsize size, memsize alignment = 16)
+{
+    InitializeArena(result, size, (uint8 *)PushSize(arena, size, alignment));
+}
+
 inline TemporaryMemory BeginTemporaryMemory(MemoryArena *arena)
 {
     TemporaryMemory result;
@@ -33,7 +33,10 @@ extern "C" {
 #define GIGABYTES(value) (MEGABYTES(value) * 1024)
 #define TERABYTES(value) (GIGABYTES(value) * 1024)
 
+#define AlignPow2(value, alignment) (((value) + ((alignment) - 1)) & ~((alignment) - 1))
+
 #include <stdint.h>
+#include <stddef.h>
 
 // Unsigned integer types.
 typedef uint8_t  uint8;
@@ -94,11 +97,30 @@ typedef PLATFORM_READ_ENTIRE_FILE(PlatformReadEntireFileFunc);
 #define PLATFORM_WRITE_ENTIRE_FILE(name) bool32 name(char *filename, uint32 memory_size, void *memory)
 typedef PLATFORM_WRITE_ENTIRE_FILE(PlatformWriteEntireFileFunc);
 
+// NOTE(mara): A pool of worker threads the game can hand independent pieces of work to. The game
+// adds its entries, then calls CompleteAllWork, which helps out on the calling thread and only
+// returns once every entry has run. At most PLATFORM_MAX_WORK_ENTRIES may be added in between.
+#define PLATFORM_MAX_WORK_ENTRIES 256
+
+typedef struct PlatformWorkQueue PlatformWorkQueue;
+
+#define PLATFORM_WORK_QUEUE_CALLBACK(name) void name(PlatformWorkQueue *queue, void *data)
+typedef PLATFORM_WORK_QUEUE_CALLBACK(PlatformWorkQueueCallback);
+
+#define PLATFORM_ADD_WORK_ENTRY(name) void name(PlatformWorkQueue *queue, PlatformWorkQueueCallback *callback, void *data)
+typedef PLATFORM_ADD_WORK_ENTRY(PlatformAddWorkEntryFunc);
+
+#define PLATFORM_COMPLETE_ALL_WORK(name) void name(PlatformWorkQueue *queue)
+typedef PLATFORM_COMPLETE_ALL_WORK(PlatformCompleteAllWorkFunc);
+
 typedef struct PlatformAPI
 {
     PlatformFreeFileMemoryFunc *FreeFileMemory;
     PlatformReadEntireFileFunc *ReadEntireFile;
     PlatformWriteEntireFileFunc *WriteEntireFile;
+
+    PlatformAddWorkEntryFunc *AddWorkEntry;
+    PlatformCompleteAllWorkFunc *CompleteAllWork;
 } PlatformAPI;
 
 /*
@@ -107,22 +129,50 @@ typedef struct PlatformAPI
   ==================================================================================================
  */
 
+#define MAX_DIRTY_RECTS 512
+
+typedef struct GameRect
+{
+    int32 min_x;
+    int32 min_y;
+    int32 max_x; // Exclusive.
+    int32 max_y; // Exclusive.
+} GameRect;
+
+typedef struct GameDirtyRects
+{
+    bool32 is_everything; // Too much changed to list (or nothing can be assumed): use the whole buffer.
+    int32 count;
+    GameRect rects[MAX_DIRTY_RECTS];
+} GameDirtyRects;
+
 typedef struct GameOffscreenBuffer
 {
+    // NOTE(mara): The game only splits drawing across the render_queue when memory is 64-byte
+    // aligned and pitch is a multiple of 64, so no two threads ever write to the same cache line.
     void *memory;
     int32 width;
     int32 height;
     int32 pitch;
     int32 bytes_per_pixel;
+
+    // NOTE(mara): A platform that keeps memory intact from one GameRender to the next (same memory,
+    // same size, nothing else drawn into it) sets is_preserved, and the game then only erases and
+    // redraws what moved. Either way GameRender fills in dirty with every rectangle that may differ
+    // from the frame before, so the platform only has to upload those.
+    bool32 is_preserved;
+    GameDirtyRects dirty;
 } GameOffscreenBuffer;
 
 typedef struct SoundStream
 {
+    uint32 id; // What the game holds on to instead of a pointer. 0 is never a valid id.
     float32 volume;
 
     uint32 loaded_sound_id;
 
-    bool32 is_initialized;
+    bool32 is_initialized; // Set by the platform when it starts playing the stream.
+    bool32 is_finished;    // Set by the platform when it's done with the stream.
     bool32 is_loop;
     bool32 force_stop;
 
@@ -134,10 +184,14 @@ typedef struct SoundStream
     SoundStream *next;
 } SoundStream;
 
+// NOTE(mara): The platform hands in an empty GameSoundOutput every frame and the game links in the
+// sounds it started. The SoundStreams themselves belong to the game. One the platform picked up
+// (is_initialized) stays valid until the platform sets is_finished, which it does once a one-shot
+// has played out or a loop has been stopped (force_stop). One it never picked up is free again
+// after the frame.
 typedef struct GameSoundOutput
 {
-    SoundStream *first_playing_sound; // A linked-list of currently playing sounds.
-    SoundStream *first_free_playing_sound; // SoundStreams that are killed will go here in order to be reused.
+    SoundStream *first_playing_sound; // A linked-list of sounds started this frame.
 } GameSoundOutput;
 
 typedef struct GameButtonState
@@ -190,12 +244,35 @@ typedef struct GameTime
 {
     float64 delta_time; // Time delta for THIS FRAME.
     float64 total_time; // Time elapsed since start.
+
+    // NOTE(mara): Where GameRender should draw between the previous (0.0) and the latest (1.0)
+    // GameUpdate. Hosts that render exactly once after every update just pass 1.0.
+    float64 render_blend;
 } GameTime;
 
-typedef struct GameMemory
+// NOTE(mara): Platform-owned memory GameRender writes a frame's draw list into as text, one
+// command per line in the order they're drawn. Whatever doesn't fit is dropped and is_truncated set.
+typedef struct GameDrawListDump
 {
-    bool32 is_initialized;
+    char *memory;
+    uint32 size;
+    uint32 used_size;
+    bool32 is_truncated;
+} GameDrawListDump;
+
+// NOTE(mara): Platform-owned counters GameUpdate adds its collision work to. A candidate pair is two
+// shapes the broadphase found sharing a grid space; their entities' bounding circles are compared
+// before any segment test, and pairs whose circles are apart never get one.
+typedef struct GameCollisionCounters
+{
+    uint64 circle_tests;
+    uint64 candidate_pairs;
+    uint64 rejected_pairs; // Segment tests the bounding circles saved.
+    uint64 swept_hits; // Bullet hits the bullet's end position alone would have missed.
+} GameCollisionCounters;
 
+typedef struct GameMemory
+{
     uint64 permanent_storage_size;
     void *permanent_storage; // NOTE(mara): REQUIRED to be cleared to zero at startup.
 
@@ -203,10 +280,35 @@ typedef struct GameMemory
     void *transient_storage; // NOTE(mara): REQUIRED to be cleared to zero at startup.
 
     PlatformAPI platform_api;
+
+    // NOTE(mara): Worker threads GameRender may split the frame across. 0 when the platform has
+    // none to offer; the game then draws everything on the calling thread.
+    PlatformWorkQueue *render_queue;
+    int32 render_worker_count; // Threads taking render_queue entries, besides the one adding them.
+
+    // NOTE(mara): Draw lines anti-aliased. Off unless the platform asks for it: aliased lines are the
+    // game's look, and they're cheaper.
+    bool32 smooth_lines;
+
+    // NOTE(mara): For measuring and debugging the renderer. With skip_render_output set, GameRender
+    // records and sorts the frame's draw commands but leaves the pixels alone. draw_list_dump is 0
+    // except on frames the platform wants the draw list of.
+    bool32 skip_render_output;
+    GameDrawListDump *draw_list_dump;
+
+    // NOTE(mara): 0 unless the platform wants collision_counters kept.
+    GameCollisionCounters *collision_counters;
 } GameMemory;
 
-#define GAME_UPDATE_AND_RENDER(name) void name(GameMemory *memory, GameTime *time, GameInput *input, GameOffscreenBuffer *buffer, GameSoundOutput *game_sound)
-typedef GAME_UPDATE_AND_RENDER(GameUpdateAndRenderFunc);
+// NOTE(mara): GameUpdate advances the simulation by one step and never touches the pixels in the
+// buffer; it only needs the buffer's dimensions (the play field wraps around them). GameRender draws
+// the current state into the buffer and never changes the simulation. Hosts that don't need
+// pictures (e.g. headless runs) can skip GameRender entirely.
+#define GAME_UPDATE(name) void name(GameMemory *memory, GameTime *time, GameInput *input, GameOffscreenBuffer *buffer, GameSoundOutput *game_sound)
+typedef GAME_UPDATE(GameUpdateFunc);
+
+#define GAME_RENDER(name) void name(GameMemory *memory, GameTime *time, GameOffscreenBuffer *buffer)
+typedef GAME_RENDER(GameRenderFunc);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,119 @@
+#ifndef ASTEROIDS_RENDER_H
+#define ASTEROIDS_RENDER_H
+
+// NOTE(mara): GameRender doesn't write pixels while it walks the game state. Every Draw* call
+// records a RenderCommand instead, and RenderGroupToOutput plays them back at the end of the frame,
+// either all at once on the calling thread or screen tile by screen tile on the render_queue.
+// Both run exactly the same rasterizers in the same order, so they produce the same pixels.
+#define RENDER_TILE_SIZE 64 // 256 bytes wide at 4 bytes a pixel: tiles never share a cache line.
+#define MAX_RENDER_COMMANDS 8192
+#define MAX_RENDER_WORK_ITEMS 128 // No more than PLATFORM_MAX_WORK_ENTRIES.
+#define RENDER_WORK_ITEMS_PER_THREAD 4
+
+enum RenderCommandType
+{
+    RENDER_COMMAND_CLEAR,
+    RENDER_COMMAND_LINE,
+    RENDER_COMMAND_SMOOTH_LINE, // Anti-aliased; same payload as LINE.
+    RENDER_COMMAND_CIRCLE,
+    RENDER_COMMAND_RECTANGLE,
+    RENDER_COMMAND_RECTANGLE_OUTLINE,
+    RENDER_COMMAND_GLYPH,
+    RENDER_COMMAND_PIXEL,
+
+    RENDER_COMMAND_TYPE_COUNT,
+};
+
+// NOTE(mara): Layers are drawn back to front. Inside a layer the commands are drawn in the order
+// they were recorded, so a layer stacks exactly the way drawing straight to the screen would; only
+// runs of the same type that were recorded back to back get batched.
+enum RenderLayer
+{
+    RENDER_LAYER_BACKGROUND, // Clears.
+    RENDER_LAYER_BACKDROP,
+    RENDER_LAYER_WORLD,
+    RENDER_LAYER_HUD,
+
+    RENDER_LAYER_COUNT,
+};
+
+struct RenderCommand
+{
+    uint16 type;
+    uint16 layer;
+    uint32 color;
+
+    // Every pixel the command may write, before wrapping around the buffer edges. The dirty
+    // rectangles and the tile bins both come from this.
+    GameRect bounds;
+
+    union
+    {
+        struct
+        {
+            int32 x0, y0; // In subpixels, see LINE_SUBPIXEL_BITS.
+            int32 x1, y1;
+        } line;
+        struct
+        {
+            int32 x, y;
+            int32 radius;
+        } circle;
+        struct
+        {
+            GameRect rect; // Already clipped to the buffer. Also used by CLEAR and RECTANGLE_OUTLINE.
+        } rectangle;
+        struct
+        {
+            FontGlyph *glyph;
+            int32 x, y;
+        } glyph;
+        struct
+        {
+            int32 x, y; // Already wrapped into the buffer.
+        } pixel;
+    };
+};
+
+// NOTE(mara): Lives in the transient arena for one GameRender. The commands arrays are pushed first
+// and never grow; everything a command points at (letters that aren't in an atlas) is pushed
+// after them, so the arena only has to be rewound once at the end of the frame.
+struct RenderGroup
+{
+    GameOffscreenBuffer *buffer;
+    MemoryArena *arena;
+    PlatformAPI *platform;
+    PlatformWorkQueue *queue;
+    int32 worker_count;
+    SimdLevel simd_level;
+
+    uint32 current_layer;
+    bool32 is_output_skipped; // Record and sort, but never rasterize.
+    bool32 is_line_smoothing; // DrawLine records SMOOTH_LINE commands instead of LINE.
+    GameDrawListDump *draw_list_dump;
+
+    uint32 command_count;
+    uint32 max_command_count;
+    RenderCommand *commands;
+    RenderCommand *sorted_commands; // Where SortRenderCommands puts them; the two get swapped.
+};
+
+// NOTE(mara): The commands that touch each tile, in the order they were recorded. Tile i's
+// command indices are command_indices[first_command[i]] up to command_indices[first_command[i + 1]].
+struct RenderTileBins
+{
+    int32 tile_count_x;
+    int32 tile_count_y;
+    uint32 *first_command;
+    uint32 *command_indices;
+};
+
+struct RenderTileWork
+{
+    RenderGroup *group;
+    RenderTileBins *bins;
+    uint32 *tile_indices;
+    uint32 tile_index_count;
+};
+
+#endif
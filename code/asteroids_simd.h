@@ -0,0 +1,116 @@
+#ifndef ASTEROIDS_SIMD_H
+#define ASTEROIDS_SIMD_H
+
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+// NOTE(mara): The game is built for plain x86-64, so SSE2 is always there. Wider kernels are
+// compiled per function and only called after DetectSimdLevel() says the CPU (and the OS, for the
+// wider registers) supports them. MSVC lets any intrinsic through without flags, GCC/Clang need
+// the target attribute on the function using them.
+#if defined(_MSC_VER)
+#define SIMD_TARGET_AVX2
+#define SIMD_TARGET_AVX512
+#else
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#define SIMD_TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw,avx512vl")))
+#endif
+
+enum SimdLevel
+{
+    SIMD_LEVEL_SSE2,
+    SIMD_LEVEL_AVX2,
+    SIMD_LEVEL_AVX512, // F + BW + VL.
+
+    SIMD_LEVEL_COUNT
+};
+
+global char *simd_level_names[SIMD_LEVEL_COUNT] = { "sse2", "avx2", "avx512" };
+
+inline void GetCpuid(uint32 leaf, uint32 subleaf, uint32 *registers)
+{
+#if defined(_MSC_VER)
+    __cpuidex((int *)registers, (int)leaf, (int)subleaf);
+#else
+    __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// Which register states the OS saves on a context switch.
+inline uint64 GetEnabledRegisterStates()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32 eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64)edx << 32) | eax;
+#endif
+}
+
+internal SimdLevel DetectSimdLevel()
+{
+    SimdLevel result = SIMD_LEVEL_SSE2;
+
+    uint32 registers[4]; // eax, ebx, ecx, edx
+    GetCpuid(0, 0, registers);
+    uint32 max_leaf = registers[0];
+
+    GetCpuid(1, 0, registers);
+    bool32 has_osxsave = (registers[2] >> 27) & 1;
+    bool32 has_avx = (registers[2] >> 28) & 1;
+
+    if (has_osxsave && has_avx && max_leaf >= 7)
+    {
+        uint64 states = GetEnabledRegisterStates();
+        bool32 os_saves_ymm = ((states & 0x06) == 0x06); // SSE + AVX.
+        bool32 os_saves_zmm = ((states & 0xE6) == 0xE6); // ... + opmask + both halves of zmm.
+
+        GetCpuid(7, 0, registers);
+        bool32 has_avx2 = (registers[1] >> 5) & 1;
+        bool32 has_avx512f = (registers[1] >> 16) & 1;
+        bool32 has_avx512bw = (registers[1] >> 30) & 1;
+        bool32 has_avx512vl = (registers[1] >> 31) & 1;
+
+        if (os_saves_ymm && has_avx2)
+        {
+            result = SIMD_LEVEL_AVX2;
+
+            if (os_saves_zmm && has_avx512f && has_avx512bw && has_avx512vl)
+            {
+                result = SIMD_LEVEL_AVX512;
+            }
+        }
+    }
+
+    return result;
+}
+
+// Index of the lowest set bit. value must not be 0.
+inline int32 FindLeastSignificantSetBit(uint64 value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return (int32)index;
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+// NOTE(mara): popcnt isn't part of plain x86-64 either, so bits are added up in parallel: pairs,
+// then nibbles, then bytes, and the multiply sums the bytes into the top one.
+inline int32 CountSetBits(uint64 value)
+{
+    value = value - ((value >> 1) & 0x5555555555555555ull);
+    value = (value & 0x3333333333333333ull) + ((value >> 2) & 0x3333333333333333ull);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (int32)((value * 0x0101010101010101ull) >> 56);
+}
+
+#endif
@@ -65,14 +65,14 @@ internal SoundData LoadSoundOGG(MemoryArena *sound_arena, char *filename)
 
 #pragma pack(push, 1)
 
+// NOTE(mara): Lives in GameState, so the samples are referred to by their offset from the start of
+// the GameState rather than by pointer. See GetStateMemory.
 struct WAVESoundData
 {
-    ReadFileResult wav_file;
-
     uint32 buffer_size;
     uint32 sample_count;
     uint32 channel_count;
-    int16 *samples;
+    memsize samples_offset;
 };
 
 struct WAVEHeader
@@ -166,14 +166,17 @@ inline uint32 GetChunkDataSize(RIFFIterator iter)
     return result;
 }
 
-internal WAVESoundData LoadSoundWAV(MemoryArena *sound_arena, char *filename)
+// NOTE(mara): The samples are copied into the asset arena, which has to live inside the same block
+// as state_base, and the file is freed again.
+internal WAVESoundData LoadSoundWAV(PlatformAPI *platform, MemoryArena *asset_arena, void *state_base,
+                                    char *filename)
 {
     WAVESoundData result = {};
 
-    result.wav_file = global_platform.ReadEntireFile(filename);
-    if (result.wav_file.content_size != 0)
+    ReadFileResult wav_file = platform->ReadEntireFile(filename);
+    if (wav_file.content_size != 0)
     {
-        WAVEHeader *header = (WAVEHeader *)result.wav_file.content;
+        WAVEHeader *header = (WAVEHeader *)wav_file.content;
         Assert(header->riff_id == WAVE_CHUNK_ID_RIFF);
         Assert(header->wave_id == WAVE_CHUNK_ID_WAVE);
 
@@ -210,8 +213,10 @@ internal WAVESoundData LoadSoundWAV(MemoryArena *sound_arena, char *filename)
         result.sample_count = sample_data_size / (channel_count * sizeof(int16));
         result.channel_count = channel_count;
 
-        //result.samples = (int16 *)PushSize(sound_arena, sample_data_size / channel_count);
-        result.samples = sample_data;
+        int16 *samples = (int16 *)PushCopy(asset_arena, sample_data_size, sample_data);
+        result.samples_offset = (memsize)((uint8 *)samples - (uint8 *)state_base);
+
+        platform->FreeFileMemory(wav_file.content);
     }
 
     return result;
@@ -0,0 +1,63 @@
+#!/bin/bash
+
+# Set the following variables to 1 to build specific platforms / libraries.
+BUILD_LINUX_HEADLESS=1
+BUILD_SDL3=0
+BUILD_BENCH=1
+BUILD_STB_VORBIS=1
+
+set -e
+
+cd "$(dirname "$0")"
+CODE_DIR="$(pwd)"
+
+# Make the build folder.
+mkdir -p ../build
+pushd ../build > /dev/null
+
+# Setup config variables.
+WARNINGS="-Werror -Wall -Wno-write-strings -Wno-unused-variable -Wno-unused-but-set-variable -Wno-unused-function -Wno-sign-compare -Wno-format -Wno-missing-braces -Wno-comment"
+DEFINES="-DASTEROIDS_DEBUG=1 -DASSERTIONS_ENABLED=1 -DASTEROIDS_LINUX=1"
+LINK_PLATFORM="-ldl -lpthread"
+LINK_GAME="-shared -Wl,--no-undefined"
+
+# NOTE(mara): No FMA contraction: the SIMD collision kernels have to round exactly like the scalar
+# tests, and the AVX-512 target would let the compiler fuse their multiplies and adds.
+OPTIMIZATIONS="-O2 -g -fno-exceptions -fno-rtti -fPIC -ffp-contract=off"
+# OPTIMIZATIONS="-O0 -g -fno-exceptions -fno-rtti -fPIC -ffp-contract=off"
+
+# Compile stb_vorbis.
+if [ $BUILD_STB_VORBIS -eq 1 ]; then
+    gcc $OPTIMIZATIONS -w -c "$CODE_DIR/include/stb_vorbis.c" -o stb_vorbis.o
+fi
+
+# LINUX HEADLESS BUILD
+if [ $BUILD_LINUX_HEADLESS -eq 1 ]; then
+    mkdir -p linux
+    pushd linux > /dev/null
+    g++ $WARNINGS $DEFINES $OPTIMIZATIONS "$CODE_DIR/asteroids.cpp" ../stb_vorbis.o -o asteroids.so $LINK_GAME
+    g++ $WARNINGS $DEFINES $OPTIMIZATIONS "$CODE_DIR/linux_headless_asteroids.cpp" -o linux_headless_asteroids $LINK_PLATFORM
+    popd > /dev/null
+fi
+
+# BENCHMARKS
+if [ $BUILD_BENCH -eq 1 ]; then
+    mkdir -p linux
+    pushd linux > /dev/null
+    g++ $WARNINGS $DEFINES $OPTIMIZATIONS "$CODE_DIR/asteroids_bench.cpp" ../stb_vorbis.o -o asteroids_bench $LINK_PLATFORM -lm
+    popd > /dev/null
+fi
+
+# SDL BUILD
+# NOTE(mara): The game code is linked under a temp name and moved into place, so the running game's
+# watcher only ever sees a finished asteroids.so.
+if [ $BUILD_SDL3 -eq 1 ]; then
+    mkdir -p sdl3
+    pushd sdl3 > /dev/null
+    g++ $WARNINGS $DEFINES $OPTIMIZATIONS "$CODE_DIR/asteroids.cpp" ../stb_vorbis.o -o asteroids.so.tmp $LINK_GAME
+    mv asteroids.so.tmp asteroids.so
+    g++ $WARNINGS $DEFINES $OPTIMIZATIONS "$CODE_DIR/sdl3_asteroids.cpp" -o sdl3_asteroids $(pkg-config --cflags --libs sdl3) $LINK_PLATFORM
+    popd > /dev/null
+fi
+
+popd > /dev/null
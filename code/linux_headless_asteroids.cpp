@@ -0,0 +1,1010 @@
+// NOTE(mara): A platform layer with no window, no audio device and no frame limiter. It loads the
+// game shared object, hands it a block of memory and steps it as fast as the CPU allows at a fixed
+// delta_time, then reports how many frames per second it managed. Useful for tracking simulation
+// throughput from build to build on machines without a display.
+#include "asteroids.h"
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "linux_headless_asteroids.h"
+
+// =================================================================================================
+// PLATFORM FILE API
+// =================================================================================================
+
+// (void *memory)
+PLATFORM_FREE_FILE_MEMORY(PlatformFreeFileMemory)
+{
+    if (memory)
+    {
+        free(memory);
+    }
+}
+
+// (char *filename)
+PLATFORM_READ_ENTIRE_FILE(PlatformReadEntireFile)
+{
+    ReadFileResult result = {};
+
+    int file_handle = open(filename, O_RDONLY);
+    if (file_handle >= 0)
+    {
+        struct stat file_status;
+        if (fstat(file_handle, &file_status) == 0)
+        {
+            uint32 file_size_32 = SafeTruncateUInt64(file_status.st_size);
+            result.content = malloc(file_size_32);
+            if (result.content)
+            {
+                ssize_t bytes_read = read(file_handle, result.content, file_size_32);
+                if (bytes_read == file_size_32)
+                {
+                    // NOTE(mara): File read successfully.
+                    result.content_size = file_size_32;
+                }
+                else
+                {
+                    fprintf(stderr, "[PlatformReadEntireFile] Short read on %s.\n", filename);
+                    PlatformFreeFileMemory(result.content);
+                    result.content = 0;
+                }
+            }
+        }
+
+        close(file_handle);
+    }
+    else
+    {
+        fprintf(stderr, "[PlatformReadEntireFile] Could not open %s.\n", filename);
+    }
+
+    return result;
+}
+
+// (char *filename, uint32 memory_size, void *memory)
+PLATFORM_WRITE_ENTIRE_FILE(PlatformWriteEntireFile)
+{
+    // NOTE(mara): Headless runs never persist anything (e.g. highscores.ahs), so that a pile of
+    // bulk simulations can't clobber the table of someone who actually played the game.
+    return false;
+}
+
+// =================================================================================================
+// WORK QUEUE
+// =================================================================================================
+
+// (PlatformWorkQueue *queue, PlatformWorkQueueCallback *callback, void *data)
+PLATFORM_ADD_WORK_ENTRY(LinuxAddWorkEntry)
+{
+    uint32 next_entry_to_write = queue->next_entry_to_write;
+    uint32 new_next_entry_to_write = (next_entry_to_write + 1) % ArrayCount(queue->entries);
+    Assert(new_next_entry_to_write != __atomic_load_n(&queue->next_entry_to_read, __ATOMIC_ACQUIRE));
+
+    PlatformWorkQueueEntry *entry = &queue->entries[next_entry_to_write];
+    entry->callback = callback;
+    entry->data = data;
+    ++queue->completion_goal;
+
+    // Publish the entry only once it's completely written.
+    __atomic_store_n(&queue->next_entry_to_write, new_next_entry_to_write, __ATOMIC_RELEASE);
+    sem_post(&queue->semaphore);
+}
+
+// Returns false when there was nothing left to take, so the caller may as well sleep.
+internal bool32 LinuxDoNextWorkEntry(PlatformWorkQueue *queue)
+{
+    bool32 found_work = false;
+
+    uint32 original_next_entry_to_read = __atomic_load_n(&queue->next_entry_to_read, __ATOMIC_ACQUIRE);
+    uint32 next_entry_to_write = __atomic_load_n(&queue->next_entry_to_write, __ATOMIC_ACQUIRE);
+    if (original_next_entry_to_read != next_entry_to_write)
+    {
+        found_work = true;
+
+        PlatformWorkQueueEntry entry = queue->entries[original_next_entry_to_read];
+        uint32 new_next_entry_to_read = (original_next_entry_to_read + 1) % ArrayCount(queue->entries);
+        if (__atomic_compare_exchange_n(&queue->next_entry_to_read, &original_next_entry_to_read,
+                                        new_next_entry_to_read, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            entry.callback(queue, entry.data);
+            __atomic_add_fetch(&queue->completion_count, 1, __ATOMIC_RELEASE);
+        }
+    }
+
+    return found_work;
+}
+
+// (PlatformWorkQueue *queue)
+PLATFORM_COMPLETE_ALL_WORK(LinuxCompleteAllWork)
+{
+    while (queue->completion_goal != __atomic_load_n(&queue->completion_count, __ATOMIC_ACQUIRE))
+    {
+        LinuxDoNextWorkEntry(queue);
+    }
+
+    queue->completion_goal = 0;
+    __atomic_store_n(&queue->completion_count, 0, __ATOMIC_RELAXED);
+}
+
+internal void *LinuxWorkQueueThreadProc(void *parameter)
+{
+    LinuxWorkQueueThread *thread = (LinuxWorkQueueThread *)parameter;
+
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(thread->core_index, &cpu_set);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+
+    for (;;)
+    {
+        if (!LinuxDoNextWorkEntry(thread->queue))
+        {
+            sem_wait(&thread->queue->semaphore);
+        }
+    }
+
+    return 0;
+}
+
+// NOTE(mara): The threads live as long as the process does.
+internal bool32 LinuxStartWorkQueue(PlatformWorkQueue *queue, LinuxWorkQueueThread *threads,
+                                    int32 thread_count, int32 first_core_index, int32 core_count)
+{
+    if (sem_init(&queue->semaphore, 0, 0) != 0)
+    {
+        return false;
+    }
+
+    for (int32 thread_index = 0; thread_index < thread_count; ++thread_index)
+    {
+        LinuxWorkQueueThread *thread = &threads[thread_index];
+        thread->queue = queue;
+        thread->core_index = (first_core_index + thread_index) % core_count;
+        if (pthread_create(&thread->thread, 0, LinuxWorkQueueThreadProc, thread) != 0)
+        {
+            return false;
+        }
+        pthread_detach(thread->thread);
+    }
+
+    return true;
+}
+
+// =================================================================================================
+// GAME CODE LOADING
+// =================================================================================================
+
+internal void LinuxGetEXEFileName(LinuxHeadlessState *state)
+{
+    ssize_t length = readlink("/proc/self/exe", state->exe_filename, sizeof(state->exe_filename) - 1);
+    if (length < 0)
+    {
+        length = 0;
+    }
+    state->exe_filename[length] = 0;
+
+    state->one_past_last_exe_filename_slash = state->exe_filename;
+    for (char *scan = state->exe_filename; *scan; ++scan)
+    {
+        if (*scan == '/')
+        {
+            state->one_past_last_exe_filename_slash = scan + 1;
+        }
+    }
+}
+
+internal void LinuxBuildEXEPath(LinuxHeadlessState *state, char *filename, int dest_count, char *dest)
+{
+    ConcatenateStrings(state->one_past_last_exe_filename_slash - state->exe_filename, state->exe_filename,
+                       GetStringLength(filename), filename,
+                       dest_count, dest);
+}
+
+internal LinuxGameCode LinuxLoadGameCode(char *so_name)
+{
+    LinuxGameCode result = {};
+
+    result.game_code_so = dlopen(so_name, RTLD_NOW | RTLD_LOCAL);
+    if (result.game_code_so)
+    {
+        result.Update = (GameUpdateFunc *)dlsym(result.game_code_so, "GameUpdate");
+        result.Render = (GameRenderFunc *)dlsym(result.game_code_so, "GameRender");
+
+        result.is_valid = (result.Update && result.Render);
+    }
+    else
+    {
+        fprintf(stderr, "[LinuxLoadGameCode] %s\n", dlerror());
+    }
+
+    if (!result.is_valid)
+    {
+        result.Update = 0;
+        result.Render = 0;
+    }
+
+    return result;
+}
+
+internal void LinuxUnloadGameCode(LinuxGameCode *game_code)
+{
+    if (game_code->game_code_so)
+    {
+        dlclose(game_code->game_code_so);
+        game_code->game_code_so = 0;
+    }
+
+    game_code->is_valid = false;
+    game_code->Update = 0;
+    game_code->Render = 0;
+}
+
+// =================================================================================================
+// INPUT
+// =================================================================================================
+
+internal void LinuxHeadlessProcessButton(bool32 is_down, GameButtonState *prev_state, GameButtonState *new_state)
+{
+    new_state->ended_down = is_down;
+    new_state->half_transition_count = (prev_state->ended_down != new_state->ended_down) ? 1 : 0;
+}
+
+// NOTE(mara): A tiny scripted pilot so that headless runs actually exercise gameplay (bullets,
+// collisions, UFOs, name entry) instead of idling in attract mode forever. It's a pure function
+// of the frame index so two runs with the same settings press exactly the same buttons.
+internal void LinuxHeadlessSynthesizeInput(int64 frame_index, GameInput *old_input, GameInput *new_input)
+{
+    GameControllerInput *old_keyboard = GetController(old_input, 0);
+    GameControllerInput *new_keyboard = GetController(new_input, 0);
+    new_keyboard->is_connected = true;
+
+    // Hyperspace every four seconds: this starts a game from attract mode and occasionally jumps
+    // the ship out of trouble during play.
+    LinuxHeadlessProcessButton((frame_index % 240) < 2, &old_keyboard->move_down, &new_keyboard->move_down);
+
+    // Tap fire on and off, a few shots per second.
+    LinuxHeadlessProcessButton((frame_index % 8) < 4, &old_keyboard->action_down, &new_keyboard->action_down);
+
+    // Sweep the ship around and thrust in bursts.
+    int64 turn_phase = (frame_index / 90) % 3;
+    LinuxHeadlessProcessButton(turn_phase == 0, &old_keyboard->move_left, &new_keyboard->move_left);
+    LinuxHeadlessProcessButton(turn_phase == 1, &old_keyboard->move_right, &new_keyboard->move_right);
+    LinuxHeadlessProcessButton(((frame_index / 45) % 4) == 0, &old_keyboard->move_up, &new_keyboard->move_up);
+
+    GameControllerInput *new_controller = GetController(new_input, 1);
+    new_controller->is_connected = false;
+}
+
+// =================================================================================================
+// TIMING
+// =================================================================================================
+
+inline uint64 LinuxGetTimeCounter()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64)now.tv_sec * 1000000000ull + (uint64)now.tv_nsec;
+}
+
+inline float64 LinuxGetSecondsElapsed(uint64 start, uint64 end)
+{
+    return (float64)(end - start) / 1000000000.0;
+}
+
+// =================================================================================================
+// INPUT RECORDING & PLAYBACK
+// =================================================================================================
+
+internal void LinuxHeadlessGetInputFileLocation(LinuxHeadlessState *state, int32 world_index,
+                                                int dest_count, char *dest)
+{
+    char filename[64];
+    sprintf_s(filename, "loop_edit_%d.ai", world_index);
+    LinuxBuildEXEPath(state, filename, dest_count, dest);
+}
+
+internal void LinuxHeadlessBeginRecordingInput(LinuxHeadlessState *state, LinuxHeadlessWorld *world)
+{
+    char filename[LINUX_STATE_FILE_NAME_COUNT];
+    LinuxHeadlessGetInputFileLocation(state, world->world_index, sizeof(filename), filename);
+
+    world->recording_fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (world->recording_fd >= 0)
+    {
+        GameMemory *game_memory = &world->game_memory;
+        ssize_t bytes_written = write(world->recording_fd, game_memory->permanent_storage,
+                                      (size_t)game_memory->permanent_storage_size);
+        if (bytes_written == (ssize_t)game_memory->permanent_storage_size)
+        {
+            world->is_recording = true;
+            world->recorded_frame_count = 0;
+        }
+        else
+        {
+            fprintf(stderr, "[LinuxHeadlessBeginRecordingInput] Could not write snapshot to %s.\n", filename);
+            close(world->recording_fd);
+        }
+    }
+    else
+    {
+        fprintf(stderr, "[LinuxHeadlessBeginRecordingInput] Could not open %s.\n", filename);
+    }
+}
+
+internal void LinuxHeadlessEndRecordingInput(LinuxHeadlessWorld *world)
+{
+    close(world->recording_fd);
+    world->recording_fd = -1;
+    world->is_recording = false;
+}
+
+internal bool32 LinuxHeadlessRestoreSnapshot(LinuxHeadlessWorld *world)
+{
+    GameMemory *game_memory = &world->game_memory;
+
+    lseek(world->playback_fd, 0, SEEK_SET);
+    ssize_t bytes_read = read(world->playback_fd, game_memory->permanent_storage,
+                              (size_t)game_memory->permanent_storage_size);
+
+    return (bytes_read == (ssize_t)game_memory->permanent_storage_size);
+}
+
+internal void LinuxHeadlessBeginInputPlayback(LinuxHeadlessState *state, LinuxHeadlessWorld *world)
+{
+    char filename[LINUX_STATE_FILE_NAME_COUNT];
+    LinuxHeadlessGetInputFileLocation(state, world->world_index, sizeof(filename), filename);
+
+    world->playback_fd = open(filename, O_RDONLY);
+    if (world->playback_fd >= 0)
+    {
+        if (LinuxHeadlessRestoreSnapshot(world))
+        {
+            world->is_playing_back = true;
+        }
+        else
+        {
+            fprintf(stderr, "[LinuxHeadlessBeginInputPlayback] Could not read snapshot from %s.\n", filename);
+            close(world->playback_fd);
+        }
+    }
+    else
+    {
+        fprintf(stderr, "[LinuxHeadlessBeginInputPlayback] Could not open %s.\n", filename);
+    }
+}
+
+internal void LinuxHeadlessEndInputPlayback(LinuxHeadlessWorld *world)
+{
+    close(world->playback_fd);
+    world->playback_fd = -1;
+    world->is_playing_back = false;
+}
+
+internal void LinuxHeadlessRecordInput(LinuxHeadlessWorld *world, GameInput *new_input)
+{
+    write(world->recording_fd, new_input, sizeof(*new_input));
+    ++world->recorded_frame_count;
+}
+
+internal void LinuxHeadlessPlaybackInput(LinuxHeadlessWorld *world, GameInput *new_input)
+{
+    if (read(world->playback_fd, new_input, sizeof(*new_input)) != sizeof(*new_input))
+    {
+        // We've hit the end of the stream, so go back to the beginning and restore the snapshot.
+        LinuxHeadlessRestoreSnapshot(world);
+        read(world->playback_fd, new_input, sizeof(*new_input));
+    }
+}
+
+// =================================================================================================
+// WORLDS
+// =================================================================================================
+
+// NOTE(mara): Anonymous mappings come back zeroed, which the game requires, and pages are only
+// committed once they're touched, so a world only ever pays for the memory it actually uses.
+internal void *LinuxHeadlessAllocateGameMemory(LinuxHeadlessWorld *world, bool32 huge_pages)
+{
+    world->memory_backing = LINUX_MEMORY_BACKING_PAGES;
+
+    if (huge_pages)
+    {
+        uint64 size = AlignPow2(world->total_size, LINUX_HUGE_PAGE_SIZE);
+        void *block = mmap(0, (size_t)size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (block != MAP_FAILED)
+        {
+            world->memory_backing = LINUX_MEMORY_BACKING_HUGETLB;
+            return block;
+        }
+
+        // NOTE(mara): No huge pages reserved (the usual case). Transparent huge pages only cover
+        // 2MB-aligned ranges, so map an extra huge page and keep the aligned part of it.
+        uint64 mapped_size = size + LINUX_HUGE_PAGE_SIZE;
+        uint8 *mapped = (uint8 *)mmap(0, (size_t)mapped_size, PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped != MAP_FAILED)
+        {
+            uint8 *aligned = (uint8 *)AlignPow2((uint64)mapped, LINUX_HUGE_PAGE_SIZE);
+            if (aligned > mapped)
+            {
+                munmap(mapped, aligned - mapped);
+            }
+            uint8 *tail = aligned + size;
+            uint8 *mapped_end = mapped + mapped_size;
+            if (mapped_end > tail)
+            {
+                munmap(tail, mapped_end - tail);
+            }
+
+            if (madvise(aligned, (size_t)size, MADV_HUGEPAGE) == 0)
+            {
+                world->memory_backing = LINUX_MEMORY_BACKING_TRANSPARENT_HUGE_PAGES;
+            }
+            return aligned;
+        }
+    }
+
+    void *block = mmap(0, (size_t)world->total_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (block == MAP_FAILED)
+    {
+        return 0;
+    }
+
+    return block;
+}
+
+internal bool32 LinuxHeadlessInitializeWorld(LinuxHeadlessWorld *world, LinuxHeadlessOptions *options)
+{
+    // NOTE(mara): The update only needs the dimensions of the play field. Pixels are only
+    // allocated when --render asks for the draw path to be exercised too; nobody ever looks at them.
+    LinuxHeadlessOffscreenBuffer *backbuffer = &world->backbuffer;
+    // Rows start on a cache line (and mmap hands out whole pages), so the game may render it in tiles.
+    backbuffer->width = options->buffer_width;
+    backbuffer->height = options->buffer_height;
+    backbuffer->bytes_per_pixel = BITMAP_BYTES_PER_PIXEL;
+    backbuffer->pitch = AlignPow2(backbuffer->width * backbuffer->bytes_per_pixel, 64);
+    backbuffer->memory = 0;
+    if (options->render)
+    {
+        backbuffer->memory = mmap(0, (size_t)backbuffer->pitch * backbuffer->height,
+                                  PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+
+    // Memory initialization.
+    GameMemory *game_memory = &world->game_memory;
+    *game_memory = {};
+    game_memory->permanent_storage_size = MEGABYTES(32);
+    game_memory->transient_storage_size = MEGABYTES(32);
+
+    world->total_size = game_memory->permanent_storage_size + game_memory->transient_storage_size;
+    world->game_memory_block = LinuxHeadlessAllocateGameMemory(world, options->huge_pages);
+
+    if (backbuffer->memory == MAP_FAILED || !world->game_memory_block)
+    {
+        return false;
+    }
+
+    game_memory->permanent_storage = world->game_memory_block;
+    game_memory->transient_storage = ((uint8 *)game_memory->permanent_storage + game_memory->permanent_storage_size);
+
+    // Load the platform file API.
+    game_memory->platform_api.FreeFileMemory = PlatformFreeFileMemory;
+    game_memory->platform_api.ReadEntireFile = PlatformReadEntireFile;
+    game_memory->platform_api.WriteEntireFile = PlatformWriteEntireFile;
+    game_memory->platform_api.AddWorkEntry = LinuxAddWorkEntry;
+    game_memory->platform_api.CompleteAllWork = LinuxCompleteAllWork;
+    game_memory->skip_render_output = options->skip_raster;
+    game_memory->smooth_lines = options->smooth_lines;
+    game_memory->collision_counters = options->collision_stats ? &world->collision_counters : 0;
+
+    world->new_input = &world->input[0];
+    world->old_input = &world->input[1];
+
+    world->game_time = {};
+    world->game_time.delta_time = 1.0 / options->update_hz;
+    world->game_time.render_blend = 1.0;
+
+    world->frames_simulated = 0;
+
+    world->recording_fd = -1;
+    world->playback_fd = -1;
+    world->is_recording = false;
+    world->is_playing_back = false;
+
+    return true;
+}
+
+internal void LinuxHeadlessWriteDrawList(LinuxHeadlessState *state, LinuxHeadlessWorld *world,
+                                        GameDrawListDump *dump)
+{
+    char filename[64];
+    sprintf_s(filename, "draw_list_%d_%lld.txt", world->world_index, (long long)world->frames_simulated);
+    char full_path[LINUX_STATE_FILE_NAME_COUNT];
+    LinuxBuildEXEPath(state, filename, sizeof(full_path), full_path);
+
+    FILE *file = fopen(full_path, "wb");
+    if (file)
+    {
+        fprintf(file, "# world %d, frame %lld, %dx%d%s\n",
+                world->world_index, (long long)world->frames_simulated,
+                world->backbuffer.width, world->backbuffer.height,
+                dump->is_truncated ? ", truncated" : "");
+        fwrite(dump->memory, 1, dump->used_size, file);
+        fclose(file);
+    }
+    else
+    {
+        fprintf(stderr, "[LinuxHeadlessWriteDrawList] Could not write %s.\n", full_path);
+    }
+}
+
+internal void LinuxHeadlessStepWorld(LinuxHeadlessState *state, LinuxHeadlessWorld *world,
+                                    LinuxGameCode *game_code, LinuxHeadlessOptions *options)
+{
+    // NOTE(mara): The game seeds its first round from the clock while it initializes during the
+    // first update, so recordings start from the second frame to keep every loop identical.
+    if (options->record_frame_count > 0 && world->frames_simulated == 1)
+    {
+        LinuxHeadlessBeginRecordingInput(state, world);
+    }
+
+    LinuxHeadlessSynthesizeInput(world->frames_simulated, world->old_input, world->new_input);
+
+    if (world->is_recording)
+    {
+        LinuxHeadlessRecordInput(world, world->new_input);
+    }
+
+    if (world->is_playing_back)
+    {
+        LinuxHeadlessPlaybackInput(world, world->new_input);
+    }
+
+    GameOffscreenBuffer offscreen_buffer = {};
+    offscreen_buffer.memory = world->backbuffer.memory;
+    offscreen_buffer.width = world->backbuffer.width;
+    offscreen_buffer.height = world->backbuffer.height;
+    offscreen_buffer.pitch = world->backbuffer.pitch;
+    offscreen_buffer.bytes_per_pixel = world->backbuffer.bytes_per_pixel;
+    // Nothing but GameRender ever touches the backbuffer, and it renders every frame or never.
+    offscreen_buffer.is_preserved = (options->render && !options->full_redraw && world->frames_simulated > 0);
+
+    // NOTE(mara): There's no audio device here, so the sounds started this frame are simply dropped.
+    GameSoundOutput game_sound = {};
+
+    game_code->Update(&world->game_memory, &world->game_time, world->new_input,
+                      &offscreen_buffer, &game_sound);
+
+    if (options->render)
+    {
+        GameDrawListDump draw_list_dump = {};
+        if (world->frames_simulated == options->dump_frame)
+        {
+            draw_list_dump.memory = (char *)malloc(LINUX_HEADLESS_DRAW_LIST_DUMP_SIZE);
+            draw_list_dump.size = draw_list_dump.memory ? LINUX_HEADLESS_DRAW_LIST_DUMP_SIZE : 0;
+            world->game_memory.draw_list_dump = &draw_list_dump;
+        }
+
+        game_code->Render(&world->game_memory, &world->game_time, &offscreen_buffer);
+
+        if (world->game_memory.draw_list_dump)
+        {
+            LinuxHeadlessWriteDrawList(state, world, &draw_list_dump);
+            free(draw_list_dump.memory);
+            world->game_memory.draw_list_dump = 0;
+        }
+    }
+
+    world->game_time.total_time += world->game_time.delta_time;
+    ++world->frames_simulated;
+
+    GameInput *temp = world->new_input;
+    world->new_input = world->old_input;
+    world->old_input = temp;
+
+    if (world->is_recording && world->recorded_frame_count == options->record_frame_count)
+    {
+        LinuxHeadlessEndRecordingInput(world);
+        LinuxHeadlessBeginInputPlayback(state, world);
+    }
+}
+
+internal void *LinuxHeadlessWorkerProc(void *parameter)
+{
+    LinuxHeadlessWorker *worker = (LinuxHeadlessWorker *)parameter;
+
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(worker->core_index, &cpu_set);
+    worker->is_pinned = (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0);
+
+    // NOTE(mara): Worlds are allocated from the worker that steps them, after it has been pinned,
+    // so that first-touch puts their pages on the memory node closest to that core.
+    worker->initialized_successfully = true;
+    for (int32 world_index = 0; world_index < worker->world_count; ++world_index)
+    {
+        if (!LinuxHeadlessInitializeWorld(&worker->worlds[world_index], worker->options))
+        {
+            worker->initialized_successfully = false;
+        }
+        worker->worlds[world_index].game_memory.render_queue = worker->render_queue;
+        worker->worlds[world_index].game_memory.render_worker_count = (worker->render_queue ?
+                                                                       worker->options->render_thread_count : 0);
+    }
+
+    pthread_barrier_wait(worker->start_barrier);
+
+    if (worker->initialized_successfully)
+    {
+        // NOTE(mara): Each world runs start to finish before the next one begins, so only one
+        // world's working set is hot in this core's caches at a time.
+        for (int32 world_index = 0; world_index < worker->world_count; ++world_index)
+        {
+            LinuxHeadlessWorld *world = &worker->worlds[world_index];
+            while (world->frames_simulated < worker->options->frame_count)
+            {
+                LinuxHeadlessStepWorld(worker->state, world, worker->game_code, worker->options);
+            }
+
+            if (world->is_recording)
+            {
+                LinuxHeadlessEndRecordingInput(world);
+            }
+            if (world->is_playing_back)
+            {
+                LinuxHeadlessEndInputPlayback(world);
+            }
+        }
+    }
+
+    return 0;
+}
+
+// =================================================================================================
+// COMMAND LINE
+// =================================================================================================
+
+internal void LinuxHeadlessPrintUsage(char *exe_name)
+{
+    fprintf(stderr,
+            "Usage: %s [--frames N] [--hz H] [--worlds W] [--threads T] [--data DIR] [--render] [--record R]\n"
+            "          [--huge-pages] [--size WxH] [--render-threads R] [--smooth-lines]\n"
+            "          [--skip-raster] [--full-redraw] [--dump-draw-list F] [--collision-stats]\n"
+            "  --frames N   Number of frames to simulate in each world (default %d).\n"
+            "  --hz H       Fixed update rate; every frame advances by 1/H seconds (default %.0f).\n"
+            "  --worlds W   Number of independent games to run side by side (default 1).\n"
+            "  --threads T  Worker threads, each pinned to its own core (default: one per core, at most W).\n"
+            "  --data DIR   Directory containing fonts/ and sounds/ (default ../../data next to the exe).\n"
+            "  --render     Also run GameRender every frame into an offscreen buffer (default off).\n"
+            "  --record R   Record R frames of each world to loop_edit_<world>.ai next to the exe, then\n"
+            "               loop that recording (snapshot + inputs) for the rest of the run.\n"
+            "  --huge-pages Back game memory with huge pages: MAP_HUGETLB if any are reserved,\n"
+            "               transparent huge pages otherwise (default off).\n"
+            "  --size WxH   Size of the play field and the offscreen buffer (default %dx%d).\n"
+            "  --render-threads R\n"
+            "               Extra threads GameRender splits each frame across, in tiles. Only with a\n"
+            "               single world (default 0: everything is drawn on the world's own thread).\n"
+            "  --smooth-lines\n"
+            "               Draw lines anti-aliased (default off).\n"
+            "  --skip-raster\n"
+            "               Run GameRender, but only record and sort its draw commands; no pixels are\n"
+            "               written. Implies --render.\n"
+            "  --full-redraw\n"
+            "               Never tell the game the backbuffer still holds the last frame, so it draws\n"
+            "               every frame in full instead of only what changed. Implies --render.\n"
+            "  --dump-draw-list F\n"
+            "               Write every world's draw commands for frame F to draw_list_<world>_<F>.txt\n"
+            "               next to the exe. Implies --render.\n"
+            "  --collision-stats\n"
+            "               Count the collision tests every world makes and print the totals.\n",
+            exe_name, LINUX_HEADLESS_DEFAULT_FRAME_COUNT, LINUX_HEADLESS_DEFAULT_UPDATE_HZ,
+            LINUX_HEADLESS_DEFAULT_BUFFER_WIDTH, LINUX_HEADLESS_DEFAULT_BUFFER_HEIGHT);
+}
+
+internal bool32 LinuxHeadlessParseOptions(int argc, char *argv[], LinuxHeadlessOptions *options)
+{
+    options->frame_count = LINUX_HEADLESS_DEFAULT_FRAME_COUNT;
+    options->update_hz = LINUX_HEADLESS_DEFAULT_UPDATE_HZ;
+    options->world_count = 1;
+    options->thread_count = 0;
+    options->data_directory = 0;
+    options->render = false;
+    options->record_frame_count = 0;
+    options->huge_pages = false;
+    options->buffer_width = LINUX_HEADLESS_DEFAULT_BUFFER_WIDTH;
+    options->buffer_height = LINUX_HEADLESS_DEFAULT_BUFFER_HEIGHT;
+    options->render_thread_count = 0;
+    options->smooth_lines = false;
+    options->skip_raster = false;
+    options->full_redraw = false;
+    options->dump_frame = -1;
+    options->collision_stats = false;
+
+    for (int arg_index = 1; arg_index < argc; ++arg_index)
+    {
+        char *arg = argv[arg_index];
+        bool32 has_value = (arg_index + 1 < argc);
+
+        if (strcmp(arg, "--frames") == 0 && has_value)
+        {
+            options->frame_count = strtoll(argv[++arg_index], 0, 10);
+        }
+        else if (strcmp(arg, "--hz") == 0 && has_value)
+        {
+            options->update_hz = strtod(argv[++arg_index], 0);
+        }
+        else if (strcmp(arg, "--worlds") == 0 && has_value)
+        {
+            options->world_count = atoi(argv[++arg_index]);
+        }
+        else if (strcmp(arg, "--threads") == 0 && has_value)
+        {
+            options->thread_count = atoi(argv[++arg_index]);
+        }
+        else if (strcmp(arg, "--data") == 0 && has_value)
+        {
+            options->data_directory = argv[++arg_index];
+        }
+        else if (strcmp(arg, "--render") == 0)
+        {
+            options->render = true;
+        }
+        else if (strcmp(arg, "--record") == 0 && has_value)
+        {
+            options->record_frame_count = strtoll(argv[++arg_index], 0, 10);
+        }
+        else if (strcmp(arg, "--huge-pages") == 0)
+        {
+            options->huge_pages = true;
+        }
+        else if (strcmp(arg, "--size") == 0 && has_value)
+        {
+            if (sscanf(argv[++arg_index], "%dx%d", &options->buffer_width, &options->buffer_height) != 2)
+            {
+                return false;
+            }
+        }
+        else if (strcmp(arg, "--render-threads") == 0 && has_value)
+        {
+            options->render_thread_count = atoi(argv[++arg_index]);
+        }
+        else if (strcmp(arg, "--smooth-lines") == 0)
+        {
+            options->smooth_lines = true;
+        }
+        else if (strcmp(arg, "--skip-raster") == 0)
+        {
+            options->render = true;
+            options->skip_raster = true;
+        }
+        else if (strcmp(arg, "--full-redraw") == 0)
+        {
+            options->render = true;
+            options->full_redraw = true;
+        }
+        else if (strcmp(arg, "--dump-draw-list") == 0 && has_value)
+        {
+            options->render = true;
+            options->dump_frame = strtoll(argv[++arg_index], 0, 10);
+        }
+        else if (strcmp(arg, "--collision-stats") == 0)
+        {
+            options->collision_stats = true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    int32 core_count = (int32)sysconf(_SC_NPROCESSORS_ONLN);
+    if (core_count < 1)
+    {
+        core_count = 1;
+    }
+    if (options->thread_count <= 0)
+    {
+        options->thread_count = core_count;
+    }
+    if (options->thread_count > options->world_count)
+    {
+        options->thread_count = options->world_count;
+    }
+
+    // NOTE(mara): Worlds on different threads would all be adding to (and waiting on) the same
+    // render queue, so extra render threads only go with a single world.
+    return (options->frame_count > 0 && options->update_hz > 0.0 &&
+            options->world_count > 0 && options->world_count <= LINUX_HEADLESS_MAX_WORLDS &&
+            options->buffer_width > 0 && options->buffer_height > 0 &&
+            options->render_thread_count >= 0 && options->render_thread_count <= LINUX_MAX_RENDER_THREADS &&
+            (options->render_thread_count == 0 || options->world_count == 1));
+}
+
+// =================================================================================================
+// int main()
+// =================================================================================================
+
+int main(int argc, char *argv[])
+{
+    LinuxHeadlessOptions options = {};
+    if (!LinuxHeadlessParseOptions(argc, argv, &options))
+    {
+        LinuxHeadlessPrintUsage(argv[0]);
+        return 1;
+    }
+
+    LinuxHeadlessState linux_state = {};
+    LinuxGetEXEFileName(&linux_state);
+
+    char game_code_so_full_path[LINUX_STATE_FILE_NAME_COUNT];
+    LinuxBuildEXEPath(&linux_state, "asteroids.so",
+                      sizeof(game_code_so_full_path), game_code_so_full_path);
+
+    // NOTE(mara): The game loads its assets relative to the working directory, same as the
+    // windowed builds being launched from the data folder.
+    char default_data_directory[LINUX_STATE_FILE_NAME_COUNT];
+    LinuxBuildEXEPath(&linux_state, "../../data",
+                      sizeof(default_data_directory), default_data_directory);
+    char *data_directory = options.data_directory ? options.data_directory : default_data_directory;
+    if (chdir(data_directory) != 0)
+    {
+        fprintf(stderr, "Could not change to data directory %s.\n", data_directory);
+        return 2;
+    }
+
+    LinuxGameCode game_code = LinuxLoadGameCode(game_code_so_full_path);
+    if (!game_code.is_valid)
+    {
+        fprintf(stderr, "Could not load game code from %s.\n", game_code_so_full_path);
+        return 2;
+    }
+
+    LinuxHeadlessWorld *worlds = (LinuxHeadlessWorld *)calloc(options.world_count, sizeof(LinuxHeadlessWorld));
+    LinuxHeadlessWorker *workers = (LinuxHeadlessWorker *)calloc(options.thread_count, sizeof(LinuxHeadlessWorker));
+    if (!worlds || !workers)
+    {
+        fprintf(stderr, "Could not allocate worlds.\n");
+        return 3;
+    }
+
+    for (int32 world_index = 0; world_index < options.world_count; ++world_index)
+    {
+        worlds[world_index].world_index = world_index;
+    }
+
+    int32 core_count = (int32)sysconf(_SC_NPROCESSORS_ONLN);
+    if (core_count < 1)
+    {
+        core_count = 1;
+    }
+
+    // The render threads take the cores after the one the (single) world is pinned to.
+    PlatformWorkQueue *render_queue = 0;
+    if (options.render_thread_count > 0)
+    {
+        local_persist LinuxWorkQueueThread render_threads[LINUX_MAX_RENDER_THREADS];
+        render_queue = (PlatformWorkQueue *)calloc(1, sizeof(PlatformWorkQueue));
+        if (!render_queue ||
+            !LinuxStartWorkQueue(render_queue, render_threads, options.render_thread_count, 1, core_count))
+        {
+            fprintf(stderr, "Could not start the render threads.\n");
+            return 3;
+        }
+    }
+
+    // Hand out the worlds as evenly as possible; the first (world_count % thread_count) workers
+    // take one extra.
+    pthread_barrier_t start_barrier;
+    pthread_barrier_init(&start_barrier, 0, options.thread_count + 1);
+
+    int32 worlds_per_worker = options.world_count / options.thread_count;
+    int32 leftover_worlds = options.world_count % options.thread_count;
+    int32 next_world_index = 0;
+    for (int32 worker_index = 0; worker_index < options.thread_count; ++worker_index)
+    {
+        LinuxHeadlessWorker *worker = &workers[worker_index];
+        worker->core_index = worker_index % core_count;
+        worker->worlds = &worlds[next_world_index];
+        worker->world_count = worlds_per_worker + ((worker_index < leftover_worlds) ? 1 : 0);
+        worker->state = &linux_state;
+        worker->game_code = &game_code;
+        worker->options = &options;
+        worker->start_barrier = &start_barrier;
+        worker->render_queue = render_queue;
+        next_world_index += worker->world_count;
+
+        if (pthread_create(&worker->thread, 0, LinuxHeadlessWorkerProc, worker) != 0)
+        {
+            fprintf(stderr, "Could not create worker thread %d.\n", worker_index);
+            return 3;
+        }
+    }
+
+    pthread_barrier_wait(&start_barrier);
+    uint64 start_time_counter = LinuxGetTimeCounter();
+
+    bool32 all_workers_succeeded = true;
+    int32 pinned_worker_count = 0;
+    for (int32 worker_index = 0; worker_index < options.thread_count; ++worker_index)
+    {
+        pthread_join(workers[worker_index].thread, 0);
+        all_workers_succeeded &= workers[worker_index].initialized_successfully;
+        pinned_worker_count += workers[worker_index].is_pinned ? 1 : 0;
+    }
+    uint64 end_time_counter = LinuxGetTimeCounter();
+
+    pthread_barrier_destroy(&start_barrier);
+
+    if (!all_workers_succeeded)
+    {
+        fprintf(stderr, "Could not allocate game memory for every world.\n");
+        return 3;
+    }
+
+    int64 total_frames = 0;
+    float64 total_simulated_seconds = 0.0;
+    int32 backing_counts[LINUX_MEMORY_BACKING_COUNT] = {};
+    for (int32 world_index = 0; world_index < options.world_count; ++world_index)
+    {
+        total_frames += worlds[world_index].frames_simulated;
+        total_simulated_seconds += worlds[world_index].game_time.total_time;
+        ++backing_counts[worlds[world_index].memory_backing];
+    }
+
+    if (options.huge_pages)
+    {
+        printf("Game memory: %d worlds on MAP_HUGETLB, %d on transparent huge pages, %d on regular pages.\n",
+               backing_counts[LINUX_MEMORY_BACKING_HUGETLB],
+               backing_counts[LINUX_MEMORY_BACKING_TRANSPARENT_HUGE_PAGES],
+               backing_counts[LINUX_MEMORY_BACKING_PAGES]);
+    }
+
+    float64 seconds_elapsed = LinuxGetSecondsElapsed(start_time_counter, end_time_counter);
+    float64 frames_per_second = (float64)total_frames / seconds_elapsed;
+    // NOTE(mara): Wall time per frame of any world, over every frame of every world. With W worlds
+    // a step of the whole batch takes W times this.
+    float64 ms_per_frame = (1000.0 * seconds_elapsed) / (float64)total_frames;
+    printf("| %s | %dx%d | %d worlds | %d threads (%d pinned) + %d render | %lld frames | %.3fs | %.02ff/s | %.02ff/s/world | %.04fms/f | %.02fx realtime |\n",
+           !options.render ? "update only" : options.skip_raster ? "update+record" : "update+render",
+           options.buffer_width, options.buffer_height,
+           options.world_count, options.thread_count, pinned_worker_count, options.render_thread_count,
+           (long long)total_frames, seconds_elapsed,
+           frames_per_second, frames_per_second / (float64)options.world_count,
+           ms_per_frame, total_simulated_seconds / seconds_elapsed);
+
+    if (options.collision_stats)
+    {
+        GameCollisionCounters totals = {};
+        for (int32 world_index = 0; world_index < options.world_count; ++world_index)
+        {
+            GameCollisionCounters *counters = &worlds[world_index].collision_counters;
+            totals.circle_tests += counters->circle_tests;
+            totals.candidate_pairs += counters->candidate_pairs;
+            totals.rejected_pairs += counters->rejected_pairs;
+            totals.swept_hits += counters->swept_hits;
+        }
+        uint64 segment_tests = totals.candidate_pairs - totals.rejected_pairs;
+        printf("| collision | %llu candidate pairs | %llu circle tests | %llu segment tests | %llu avoided (%.1f%%) |\n",
+               (unsigned long long)totals.candidate_pairs, (unsigned long long)totals.circle_tests,
+               (unsigned long long)segment_tests, (unsigned long long)totals.rejected_pairs,
+               totals.candidate_pairs ? 100.0 * (float64)totals.rejected_pairs / (float64)totals.candidate_pairs : 0.0);
+        printf("| collision | %llu swept bullet hits |\n", (unsigned long long)totals.swept_hits);
+    }
+
+    LinuxUnloadGameCode(&game_code);
+
+    return 0;
+}
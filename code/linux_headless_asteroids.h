@@ -0,0 +1,151 @@
+#ifndef LINUX_HEADLESS_ASTEROIDS_H
+#define LINUX_HEADLESS_ASTEROIDS_H
+
+#define LINUX_HEADLESS_DEFAULT_BUFFER_WIDTH 1366
+#define LINUX_HEADLESS_DEFAULT_BUFFER_HEIGHT 768
+
+#define LINUX_HEADLESS_DEFAULT_FRAME_COUNT 100000
+#define LINUX_HEADLESS_DEFAULT_UPDATE_HZ 60.0
+#define LINUX_HEADLESS_MAX_WORLDS 4096
+
+#define LINUX_STATE_FILE_NAME_COUNT 4096
+
+#define LINUX_HUGE_PAGE_SIZE MEGABYTES(2)
+
+#define LINUX_MAX_RENDER_THREADS 64
+#define LINUX_HEADLESS_DRAW_LIST_DUMP_SIZE MEGABYTES(4)
+
+enum LinuxMemoryBacking
+{
+    LINUX_MEMORY_BACKING_PAGES,
+    LINUX_MEMORY_BACKING_TRANSPARENT_HUGE_PAGES, // Asked for with madvise; the kernel may still say no.
+    LINUX_MEMORY_BACKING_HUGETLB,
+
+    LINUX_MEMORY_BACKING_COUNT
+};
+
+struct LinuxHeadlessOffscreenBuffer
+{
+    void *memory;
+    int32 width;
+    int32 height;
+    int32 pitch;
+    int32 bytes_per_pixel;
+};
+
+struct PlatformWorkQueueEntry
+{
+    PlatformWorkQueueCallback *callback;
+    void *data;
+};
+
+// NOTE(mara): A ring of entries that one thread adds to and any number of threads take from.
+// Whoever wins the compare-and-swap on next_entry_to_read runs the entry; the workers sleep on the
+// semaphore, which is signalled once for every entry added.
+struct PlatformWorkQueue
+{
+    uint32 volatile completion_goal; // Only touched by the thread adding entries.
+    uint32 volatile completion_count;
+
+    uint32 volatile next_entry_to_write;
+    uint32 volatile next_entry_to_read;
+
+    sem_t semaphore;
+
+    PlatformWorkQueueEntry entries[PLATFORM_MAX_WORK_ENTRIES];
+};
+
+struct LinuxWorkQueueThread
+{
+    pthread_t thread;
+    int32 core_index;
+    PlatformWorkQueue *queue;
+};
+
+struct LinuxGameCode
+{
+    void *game_code_so;
+
+    // IMPORTANT(mara): These could be 0! You have to check before calling them.
+    GameUpdateFunc *Update;
+    GameRenderFunc *Render;
+
+    bool32 is_valid;
+};
+
+struct LinuxHeadlessOptions
+{
+    int64 frame_count; // Frames to simulate, per world.
+    float64 update_hz; // Fixed simulation rate. Every frame advances by exactly 1 / update_hz.
+    int32 world_count;
+    int32 thread_count;
+    char *data_directory;
+    bool32 render; // Run GameRender after every GameUpdate. Off by default: nobody sees the pixels.
+    int64 record_frame_count; // Record this many frames per world, then loop them. 0 = off.
+    bool32 huge_pages; // Back game memory with huge pages: MAP_HUGETLB if reserved, else THP.
+    int32 buffer_width;
+    int32 buffer_height;
+    int32 render_thread_count; // Extra threads GameRender may split a frame across. Needs 1 world.
+    bool32 smooth_lines; // Anti-aliased lines.
+    bool32 skip_raster; // GameRender records its draw commands but never rasterizes them.
+    bool32 full_redraw; // The backbuffer is never reported as preserved, so every frame is drawn in full.
+    int64 dump_frame; // Write every world's draw list for this frame next to the exe. -1 = off.
+    bool32 collision_stats; // Have the game count its collision work, and print the totals.
+};
+
+// NOTE(mara): One completely independent game: its own memory block, backbuffer, input and sound
+// lists. Worlds never share anything but the (read-only) game code.
+struct LinuxHeadlessWorld
+{
+    int32 world_index;
+
+    uint64 total_size;
+    void *game_memory_block;
+    LinuxMemoryBacking memory_backing;
+
+    GameMemory game_memory;
+    LinuxHeadlessOffscreenBuffer backbuffer;
+
+    GameInput input[2];
+    GameInput *new_input;
+    GameInput *old_input;
+
+    GameTime game_time;
+
+    int64 frames_simulated;
+    GameCollisionCounters collision_counters;
+
+    // NOTE(mara): Input recording. A recording is a snapshot of the permanent storage followed by
+    // every GameInput the world was updated with, one per frame.
+    int recording_fd;
+    int playback_fd;
+    bool32 is_recording;
+    bool32 is_playing_back;
+    int64 recorded_frame_count;
+};
+
+struct LinuxHeadlessState
+{
+    char exe_filename[LINUX_STATE_FILE_NAME_COUNT];
+    char *one_past_last_exe_filename_slash;
+};
+
+struct LinuxHeadlessWorker
+{
+    pthread_t thread;
+    int32 core_index;
+    bool32 is_pinned;
+
+    LinuxHeadlessWorld *worlds;
+    int32 world_count;
+
+    LinuxHeadlessState *state;
+    LinuxGameCode *game_code;
+    LinuxHeadlessOptions *options;
+    pthread_barrier_t *start_barrier;
+    PlatformWorkQueue *render_queue;
+
+    bool32 initialized_successfully;
+};
+
+#endif
@@ -1,5 +1,13 @@
 #include <SDL3/SDL.h>
 
+#if ASTEROIDS_LINUX
+#include <errno.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
 #include "asteroids.h"
 
 #include "sdl3_asteroids.h"
@@ -49,6 +57,158 @@ PLATFORM_WRITE_ENTIRE_FILE(PlatformWriteEntireFile)
     return result;
 }
 
+// =================================================================================================
+// GAME MEMORY
+// =================================================================================================
+
+#if ASTEROIDS_LINUX
+// NOTE(mara): Anonymous mappings come back zeroed and only get committed as they're touched, so
+// there's no memset and an instance only pays for what it uses. Setting ASTEROIDS_HUGE_PAGES=1 asks
+// for huge pages: MAP_HUGETLB if any are reserved, transparent huge pages otherwise.
+internal void *SDL3AllocateGameMemory(uint64 size)
+{
+    const char *huge_pages = SDL_getenv("ASTEROIDS_HUGE_PAGES");
+    if (huge_pages && huge_pages[0] == '1')
+    {
+        uint64 huge_size = AlignPow2(size, SDL3_HUGE_PAGE_SIZE);
+        void *block = mmap(0, (size_t)huge_size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (block != MAP_FAILED)
+        {
+            return block;
+        }
+
+        // Transparent huge pages only cover 2MB-aligned ranges, so map an extra huge page and
+        // keep the aligned part of it.
+        uint64 mapped_size = huge_size + SDL3_HUGE_PAGE_SIZE;
+        uint8 *mapped = (uint8 *)mmap(0, (size_t)mapped_size, PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped != MAP_FAILED)
+        {
+            uint8 *aligned = (uint8 *)AlignPow2((uint64)mapped, SDL3_HUGE_PAGE_SIZE);
+            if (aligned > mapped)
+            {
+                munmap(mapped, aligned - mapped);
+            }
+            uint8 *tail = aligned + huge_size;
+            uint8 *mapped_end = mapped + mapped_size;
+            if (mapped_end > tail)
+            {
+                munmap(tail, mapped_end - tail);
+            }
+
+            madvise(aligned, (size_t)huge_size, MADV_HUGEPAGE);
+            return aligned;
+        }
+    }
+
+    void *block = mmap(0, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return (block == MAP_FAILED) ? 0 : block;
+}
+#else
+internal void *SDL3AllocateGameMemory(uint64 size)
+{
+    // SDL_malloc memory not initialized to 0 by default.
+    return SDL_calloc(1, (size_t)size);
+}
+#endif
+
+// =================================================================================================
+// WORK QUEUE
+// =================================================================================================
+
+// (PlatformWorkQueue *queue, PlatformWorkQueueCallback *callback, void *data)
+PLATFORM_ADD_WORK_ENTRY(SDL3AddWorkEntry)
+{
+    uint32 next_entry_to_write = (uint32)SDL_GetAtomicInt(&queue->next_entry_to_write);
+    uint32 new_next_entry_to_write = (next_entry_to_write + 1) % ArrayCount(queue->entries);
+    Assert(new_next_entry_to_write != (uint32)SDL_GetAtomicInt(&queue->next_entry_to_read));
+
+    PlatformWorkQueueEntry *entry = &queue->entries[next_entry_to_write];
+    entry->callback = callback;
+    entry->data = data;
+    ++queue->completion_goal;
+
+    // Publish the entry only once it's completely written.
+    SDL_MemoryBarrierRelease();
+    SDL_SetAtomicInt(&queue->next_entry_to_write, (int)new_next_entry_to_write);
+    SDL_SignalSemaphore(queue->semaphore);
+}
+
+// Returns false when there was nothing left to take, so the caller may as well sleep.
+internal bool32 SDL3DoNextWorkEntry(PlatformWorkQueue *queue)
+{
+    bool32 found_work = false;
+
+    int original_next_entry_to_read = SDL_GetAtomicInt(&queue->next_entry_to_read);
+    int next_entry_to_write = SDL_GetAtomicInt(&queue->next_entry_to_write);
+    if (original_next_entry_to_read != next_entry_to_write)
+    {
+        found_work = true;
+
+        SDL_MemoryBarrierAcquire();
+        PlatformWorkQueueEntry entry = queue->entries[original_next_entry_to_read];
+        int new_next_entry_to_read = (original_next_entry_to_read + 1) % ArrayCount(queue->entries);
+        if (SDL_CompareAndSwapAtomicInt(&queue->next_entry_to_read,
+                                        original_next_entry_to_read, new_next_entry_to_read))
+        {
+            entry.callback(queue, entry.data);
+            SDL_AddAtomicInt(&queue->completion_count, 1);
+        }
+    }
+
+    return found_work;
+}
+
+// (PlatformWorkQueue *queue)
+PLATFORM_COMPLETE_ALL_WORK(SDL3CompleteAllWork)
+{
+    while (queue->completion_goal != (uint32)SDL_GetAtomicInt(&queue->completion_count))
+    {
+        SDL3DoNextWorkEntry(queue);
+    }
+
+    queue->completion_goal = 0;
+    SDL_SetAtomicInt(&queue->completion_count, 0);
+}
+
+internal int SDL3WorkQueueThreadProc(void *data)
+{
+    PlatformWorkQueue *queue = (PlatformWorkQueue *)data;
+
+    for (;;)
+    {
+        if (!SDL3DoNextWorkEntry(queue))
+        {
+            SDL_WaitSemaphore(queue->semaphore);
+        }
+    }
+
+    return 0;
+}
+
+// NOTE(mara): The threads live as long as the process does. Returns false if not even the
+// semaphore could be made, in which case the game has to draw on the main thread.
+internal bool32 SDL3StartWorkQueue(PlatformWorkQueue *queue, int32 thread_count)
+{
+    queue->semaphore = SDL_CreateSemaphore(0);
+    if (!queue->semaphore)
+    {
+        return false;
+    }
+
+    for (int32 thread_index = 0; thread_index < thread_count; ++thread_index)
+    {
+        SDL_Thread *thread = SDL_CreateThread(SDL3WorkQueueThreadProc, "RenderWorker", queue);
+        if (thread)
+        {
+            SDL_DetachThread(thread);
+        }
+    }
+
+    return true;
+}
+
 // =================================================================================================
 // GAME CODE HOT-RELOADING
 // =================================================================================================
@@ -66,7 +226,7 @@ internal void SDL3GetEXEFileName(SDL3State *state)
     state->one_past_last_exe_filenmae_slash = state->exe_filename;
     for (char *scan = state->exe_filename; *scan; ++scan)
     {
-        if (*scan == '\\')
+        if (*scan == '\\' || *scan == '/')
         {
             state->one_past_last_exe_filenmae_slash = scan + 1;
         }
@@ -104,14 +264,16 @@ internal SDL3GameCode SDL3LoadGameCode(char *source_dll_name, char *temp_dll_nam
     result.game_code_dll = SDL_LoadObject(temp_dll_name);
     if (result.game_code_dll)
     {
-        result.UpdateAndRender = (GameUpdateAndRenderFunc *)SDL_LoadFunction(result.game_code_dll, "GameUpdateAndRender");
+        result.Update = (GameUpdateFunc *)SDL_LoadFunction(result.game_code_dll, "GameUpdate");
+        result.Render = (GameRenderFunc *)SDL_LoadFunction(result.game_code_dll, "GameRender");
 
-        result.is_valid = (result.UpdateAndRender != 0);
+        result.is_valid = (result.Update && result.Render);
     }
 
     if (!result.is_valid)
     {
-        result.UpdateAndRender = 0;
+        result.Update = 0;
+        result.Render = 0;
     }
 
     return result;
@@ -126,7 +288,178 @@ internal void SDL3UnloadGameCode(SDL3GameCode *game_code)
     }
 
     game_code->is_valid = false;
-    game_code->UpdateAndRender = 0;
+    game_code->Update = 0;
+    game_code->Render = 0;
+}
+
+#if ASTEROIDS_LINUX
+internal int SDL3GameCodeWatcherProc(void *data)
+{
+    SDL3GameCodeWatcher *watcher = (SDL3GameCodeWatcher *)data;
+
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;)
+    {
+        // NOTE(mara): Blocks until something in the directory is written, so this thread costs
+        // nothing while the game code doesn't change.
+        ssize_t bytes_read = read(watcher->inotify_fd, events, sizeof(events));
+        if (bytes_read <= 0)
+        {
+            if (bytes_read < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+
+        bool32 was_game_code_written = false;
+        for (char *at = events; at < events + bytes_read;)
+        {
+            struct inotify_event *event = (struct inotify_event *)at;
+            if (event->len && SDL_strcmp(event->name, SDL3_GAME_CODE_FILE_NAME) == 0)
+            {
+                was_game_code_written = true;
+            }
+            at += sizeof(struct inotify_event) + event->len;
+        }
+
+        if (was_game_code_written)
+        {
+            // Wait for the main loop to swap in the last build before touching the temp copies.
+            while (SDL_GetAtomicInt(&watcher->is_reload_pending))
+            {
+                SDL_Delay(1);
+            }
+
+            SDL3GameCode game_code =
+                SDL3LoadGameCode(watcher->source_dll_full_path,
+                                 watcher->temp_dll_full_paths[watcher->next_temp_dll_index]);
+            if (game_code.is_valid)
+            {
+                watcher->next_temp_dll_index = !watcher->next_temp_dll_index;
+                watcher->pending_game_code = game_code;
+                SDL_SetAtomicInt(&watcher->is_reload_pending, 1);
+            }
+            else
+            {
+                // NOTE(mara): Keep running the old build. A broken one will be followed by another
+                // write once it's fixed.
+                SDL3UnloadGameCode(&game_code);
+            }
+        }
+    }
+
+    return 0;
+}
+
+// NOTE(mara): The temp copy at temp_dll_full_paths[0] must be the one that's currently loaded.
+internal bool32 SDL3StartGameCodeWatcher(SDL3State *state, SDL3GameCodeWatcher *watcher)
+{
+    SDL3BuildPathFromEXE(state, "", sizeof(watcher->directory), watcher->directory);
+    SDL3BuildPathFromEXE(state, SDL3_GAME_CODE_FILE_NAME,
+                         sizeof(watcher->source_dll_full_path), watcher->source_dll_full_path);
+    SDL3BuildPathFromEXE(state, SDL3_GAME_CODE_TEMP_FILE_NAME_0,
+                         sizeof(watcher->temp_dll_full_paths[0]), watcher->temp_dll_full_paths[0]);
+    SDL3BuildPathFromEXE(state, SDL3_GAME_CODE_TEMP_FILE_NAME_1,
+                         sizeof(watcher->temp_dll_full_paths[1]), watcher->temp_dll_full_paths[1]);
+    watcher->next_temp_dll_index = 1;
+    SDL_SetAtomicInt(&watcher->is_reload_pending, 0);
+
+    // NOTE(mara): Watch the directory rather than the file. Linkers often write a new file and
+    // rename it over the old one, which a watch on the file itself would never see.
+    watcher->inotify_fd = inotify_init1(IN_CLOEXEC);
+    if (watcher->inotify_fd < 0)
+    {
+        return false;
+    }
+
+    if (inotify_add_watch(watcher->inotify_fd, watcher->directory[0] ? watcher->directory : ".",
+                          IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        close(watcher->inotify_fd);
+        watcher->inotify_fd = -1;
+        return false;
+    }
+
+    watcher->thread = SDL_CreateThread(SDL3GameCodeWatcherProc, "GameCodeWatcher", watcher);
+    if (!watcher->thread)
+    {
+        close(watcher->inotify_fd);
+        watcher->inotify_fd = -1;
+        return false;
+    }
+
+    // The thread lives as long as the process does.
+    SDL_DetachThread(watcher->thread);
+
+    return true;
+}
+#endif
+
+// =================================================================================================
+// INPUT RECORDING & PLAYBACK
+// =================================================================================================
+
+internal void SDL3GetInputFileLocation(SDL3State *state, int dest_count, char *dest)
+{
+    SDL3BuildPathFromEXE(state, "loop_edit.ai", dest_count, dest);
+}
+
+internal void SDL3BeginRecordingInput(SDL3State *state)
+{
+    char filename[SDL3_STATE_FILE_NAME_COUNT];
+    SDL3GetInputFileLocation(state, sizeof(filename), filename);
+
+    state->recording_handle = SDL_IOFromFile(filename, "wb");
+    if (state->recording_handle)
+    {
+        // The game memory block starts with the permanent storage.
+        SDL_WriteIO(state->recording_handle, state->game_memory_block, (size_t)state->permanent_storage_size);
+        state->is_recording = true;
+    }
+}
+
+internal void SDL3EndRecordingInput(SDL3State *state)
+{
+    SDL_CloseIO(state->recording_handle);
+    state->recording_handle = 0;
+    state->is_recording = false;
+}
+
+internal void SDL3BeginInputPlayback(SDL3State *state)
+{
+    char filename[SDL3_STATE_FILE_NAME_COUNT];
+    SDL3GetInputFileLocation(state, sizeof(filename), filename);
+
+    state->playback_handle = SDL_IOFromFile(filename, "rb");
+    if (state->playback_handle)
+    {
+        SDL_ReadIO(state->playback_handle, state->game_memory_block, (size_t)state->permanent_storage_size);
+        state->is_playing_back = true;
+    }
+}
+
+internal void SDL3EndInputPlayback(SDL3State *state)
+{
+    SDL_CloseIO(state->playback_handle);
+    state->playback_handle = 0;
+    state->is_playing_back = false;
+}
+
+internal void SDL3RecordInput(SDL3State *state, GameInput *new_input)
+{
+    SDL_WriteIO(state->recording_handle, new_input, sizeof(*new_input));
+}
+
+internal void SDL3PlaybackInput(SDL3State *state, GameInput *new_input)
+{
+    if (SDL_ReadIO(state->playback_handle, new_input, sizeof(*new_input)) != sizeof(*new_input))
+    {
+        // We've hit the end of the stream, so go back to the beginning and restore the snapshot.
+        SDL_SeekIO(state->playback_handle, 0, SDL_IO_SEEK_SET);
+        SDL_ReadIO(state->playback_handle, state->game_memory_block, (size_t)state->permanent_storage_size);
+        SDL_ReadIO(state->playback_handle, new_input, sizeof(*new_input));
+    }
 }
 
 // =================================================================================================
@@ -159,6 +492,23 @@ internal void SDL3ProcessGamepadButton(bool32 is_pressed,
     new_state->half_transition_count = (prev_state->ended_down != new_state->ended_down) ? 1 : 0;
 }
 
+internal void SDL3ClearHalfTransitionCounts(GameInput *input)
+{
+    for (int button_index = 0; button_index < ArrayCount(input->mouse_buttons); ++button_index)
+    {
+        input->mouse_buttons[button_index].half_transition_count = 0;
+    }
+
+    for (int controller_index = 0; controller_index < ArrayCount(input->controllers); ++controller_index)
+    {
+        GameControllerInput *controller = GetController(input, controller_index);
+        for (int button_index = 0; button_index < ArrayCount(controller->buttons); ++button_index)
+        {
+            controller->buttons[button_index].half_transition_count = 0;
+        }
+    }
+}
+
 internal float32 SDL3ProcessGamepadStickValue(int16 value, int16 deadzone)
 {
     float32 result = 0;
@@ -191,17 +541,156 @@ internal SDL3WindowDimensions SDL3GetWindowDimensions(SDL_Renderer *renderer)
     return result;
 }
 
-internal void SDL3ResizeWindow(SDL3OffscreenBuffer *buffer, int32 new_width, int32 new_height)
+// Where each output pixel's centre lands in the source, in 16.16, clamped so index + 1 is always a
+// real pixel. Pixels past output_size (the padding SIMD rounds up to) get the last source pixel.
+internal void SDL3ComputeUpscaleTaps(SDL3UpscaleTap *taps, int32 tap_count, int32 output_size, int32 source_size)
+{
+    for (int32 i = 0; i < tap_count; ++i)
+    {
+        int64 position = ((((int64)(2 * i + 1) * source_size) << 16) / (2 * output_size)) - 32768;
+        if (position < 0)
+        {
+            position = 0;
+        }
+
+        int32 index = (int32)(position >> 16);
+        int32 weight = (int32)((position >> 8) & 0xFF);
+        if (index >= source_size - 1)
+        {
+            index = source_size - 2;
+            weight = 256;
+        }
+
+        taps[i].index = index;
+        taps[i].weight = weight;
+    }
+}
+
+// NOTE(mara): output_width x output_height is the window's size in pixels. The game's buffer is
+// render_scale percent of that, rounded up to a whole number of game pixels per output pixel when
+// the scale allows it.
+internal void SDL3ResizeWindow(SDL3OffscreenBuffer *buffer, int32 output_width, int32 output_height)
 {
     if (buffer->memory)
     {
-        SDL_free(buffer->memory);
+        SDL_aligned_free(buffer->memory);
+        buffer->memory = 0;
+    }
+    if (buffer->output_memory)
+    {
+        SDL_aligned_free(buffer->output_memory);
+        buffer->output_memory = 0;
+    }
+    if (buffer->column_taps)
+    {
+        SDL_free(buffer->column_taps);
+        buffer->column_taps = 0;
+        buffer->row_taps = 0;
+    }
+    if (buffer->column_weights)
+    {
+        SDL_aligned_free(buffer->column_weights);
+        buffer->column_weights = 0;
+    }
+    if (buffer->filtered_rows)
+    {
+        SDL_aligned_free(buffer->filtered_rows);
+        buffer->filtered_rows = 0;
     }
 
-    buffer->width = new_width;
-    buffer->height = new_height;
+    int32 render_scale = buffer->render_scale;
+    buffer->output_width = output_width;
+    buffer->output_height = output_height;
+    buffer->integer_scale = (100 % render_scale == 0) ? 100 / render_scale : 0;
+
+    if (buffer->integer_scale)
+    {
+        buffer->width = (output_width + buffer->integer_scale - 1) / buffer->integer_scale;
+        buffer->height = (output_height + buffer->integer_scale - 1) / buffer->integer_scale;
+    }
+    else
+    {
+        // The bilinear filter needs two pixels to go between.
+        buffer->width = MaxInt32(output_width * render_scale / 100, 2);
+        buffer->height = MaxInt32(output_height * render_scale / 100, 2);
+    }
     buffer->bytes_per_pixel = BITMAP_BYTES_PER_PIXEL;
 
+    // NOTE(mara): Rows start on cache lines so the render workers can split the buffer into tiles.
+    buffer->pitch = (int32)AlignPow2(buffer->width * buffer->bytes_per_pixel, 64);
+
+    int bitmap_memory_size = buffer->pitch * buffer->height;
+    buffer->memory = SDL_aligned_alloc(64, bitmap_memory_size);
+    memset(buffer->memory, 0, bitmap_memory_size); // SDL_aligned_alloc memory not initialized to 0 by default.
+    buffer->is_preserved = false;
+
+    if (render_scale < 100)
+    {
+        // The upscalers work in groups of four pixels, so output rows have room for the last group
+        // of game pixels scaled up, even where that goes past the edge of the window.
+        int32 output_row_width = MaxInt32((int32)AlignPow2(output_width, 4),
+                                          (int32)AlignPow2(buffer->width, 4) * MaxInt32(buffer->integer_scale, 1));
+        buffer->output_pitch = (int32)AlignPow2(output_row_width * buffer->bytes_per_pixel, 64);
+        buffer->output_memory = SDL_aligned_alloc(64, buffer->output_pitch * output_height);
+
+        if (!buffer->integer_scale)
+        {
+            int32 column_tap_count = (int32)AlignPow2(output_width, 4);
+            buffer->column_taps = (SDL3UpscaleTap *)SDL_malloc((column_tap_count + output_height) * sizeof(SDL3UpscaleTap));
+            buffer->row_taps = buffer->column_taps + column_tap_count;
+            SDL3ComputeUpscaleTaps(buffer->column_taps, column_tap_count, output_width, buffer->width);
+            SDL3ComputeUpscaleTaps(buffer->row_taps, output_height, output_height, buffer->height);
+
+            buffer->column_weights = (__m128i *)SDL_aligned_alloc(64, column_tap_count * sizeof(__m128i));
+            for (int32 i = 0; i < column_tap_count; ++i)
+            {
+                int16 weight = (int16)buffer->column_taps[i].weight;
+                buffer->column_weights[i] = _mm_unpacklo_epi64(_mm_set1_epi16(256 - weight), _mm_set1_epi16(weight));
+            }
+
+            // NOTE(mara): At 75%, when the width divides evenly, every four output columns read the
+            // four game pixels three along from the last four, with the same weights. Count how many
+            // groups really do, starting from the second (the first is bent by the clamp at the left
+            // edge), and those get filtered without looking at their taps at all.
+            buffer->fixed_ratio_group_count = 0;
+            SDL3UpscaleTap *first_group = buffer->column_taps + 4;
+            for (int32 group_x = 4; group_x + 4 <= output_width; group_x += 4)
+            {
+                SDL3UpscaleTap *group = buffer->column_taps + group_x;
+                int32 group_index = first_group[0].index + 3 * buffer->fixed_ratio_group_count;
+
+                bool32 is_fixed_ratio = true;
+                for (int32 j = 0; j < 4; ++j)
+                {
+                    if (group[j].index != group_index + j || group[j].weight != first_group[j].weight)
+                    {
+                        is_fixed_ratio = false;
+                    }
+                }
+                if (!is_fixed_ratio)
+                {
+                    break;
+                }
+                ++buffer->fixed_ratio_group_count;
+            }
+
+            if (buffer->fixed_ratio_group_count)
+            {
+                for (int32 half = 0; half < 2; ++half)
+                {
+                    int16 weight0 = (int16)first_group[2 * half].weight;
+                    int16 weight1 = (int16)first_group[2 * half + 1].weight;
+                    buffer->fixed_ratio_weights[half] = _mm_unpacklo_epi64(_mm_set1_epi16(256 - weight0),
+                                                                           _mm_set1_epi16(256 - weight1));
+                    buffer->fixed_ratio_weights[2 + half] = _mm_unpacklo_epi64(_mm_set1_epi16(weight0),
+                                                                               _mm_set1_epi16(weight1));
+                }
+            }
+
+            buffer->filtered_rows = (uint8 *)SDL_aligned_alloc(64, 2 * buffer->output_pitch);
+        }
+    }
+
     if (buffer->sdl_texture)
     {
         SDL_DestroyTexture(buffer->sdl_texture);
@@ -209,32 +698,379 @@ internal void SDL3ResizeWindow(SDL3OffscreenBuffer *buffer, int32 new_width, int
 
     buffer->sdl_texture = SDL_CreateTexture(buffer->sdl_renderer,
                                             SDL_PIXELFORMAT_BGRX32, SDL_TEXTUREACCESS_STREAMING,
-                                            WINDOW_WIDTH, WINDOW_HEIGHT);
+                                            output_width, output_height);
+}
 
-    int bitmap_memory_size = (buffer->width * buffer->height) * buffer->bytes_per_pixel;
-    buffer->memory = SDL_malloc(bitmap_memory_size);
-    memset(buffer->memory, 0, bitmap_memory_size); // SDL_malloc memory not initialized to 0 by default.
+// =================================================================================================
+// UPSCALING
+// =================================================================================================
 
-    buffer->pitch = buffer->width * buffer->bytes_per_pixel;
+// NOTE(mara): SSE2, which every x86-64 has. Counts are rounded up to groups of four, which the rows
+// are padded for (game rows to 64 bytes, output rows in SDL3ResizeWindow), so there are no tails.
+// The bilinear weights are out of 256, so two weighted channels always add up to 16 bits unsigned.
+
+internal void SDL3RepeatPixelsSSE2(uint32 *dest, uint32 *source, int32 count, int32 factor)
+{
+    if (factor == 2)
+    {
+        for (int32 i = 0; i < count; i += 4)
+        {
+            __m128i pixels = _mm_load_si128((__m128i *)(source + i));
+            _mm_store_si128((__m128i *)(dest + 2 * i), _mm_unpacklo_epi32(pixels, pixels));
+            _mm_store_si128((__m128i *)(dest + 2 * i + 4), _mm_unpackhi_epi32(pixels, pixels));
+        }
+    }
+    else if (factor == 4)
+    {
+        for (int32 i = 0; i < count; i += 4)
+        {
+            __m128i pixels = _mm_load_si128((__m128i *)(source + i));
+            _mm_store_si128((__m128i *)(dest + 4 * i), _mm_shuffle_epi32(pixels, 0x00));
+            _mm_store_si128((__m128i *)(dest + 4 * i + 4), _mm_shuffle_epi32(pixels, 0x55));
+            _mm_store_si128((__m128i *)(dest + 4 * i + 8), _mm_shuffle_epi32(pixels, 0xAA));
+            _mm_store_si128((__m128i *)(dest + 4 * i + 12), _mm_shuffle_epi32(pixels, 0xFF));
+        }
+    }
+    else
+    {
+        for (int32 i = 0; i < count; ++i)
+        {
+            for (int32 j = 0; j < factor; ++j)
+            {
+                dest[i * factor + j] = source[i];
+            }
+        }
+    }
 }
 
-internal void SDL3DisplayBufferInWindow(SDL3OffscreenBuffer *buffer)
+internal void SDL3BlendRowsSSE2(uint32 *dest, uint32 *top, uint32 *bottom, int32 count, int32 weight)
 {
-    char *dest;
-    int32 tex_pitch;
-    SDL_LockTexture(buffer->sdl_texture, 0, (void **)&dest, &tex_pitch);
+    __m128i zero = _mm_setzero_si128();
+    __m128i top_weight = _mm_set1_epi16((int16)(256 - weight));
+    __m128i bottom_weight = _mm_set1_epi16((int16)weight);
+    __m128i round = _mm_set1_epi16(128);
 
-    size_t byte_width = buffer->width * BITMAP_BYTES_PER_PIXEL;
-    char *src = (char *)buffer->memory;
-    for (int y = 0; y < buffer->height; ++y)
+    for (int32 i = 0; i < count; i += 4)
     {
-        memcpy(dest, src, byte_width);
+        __m128i top_pixels = _mm_load_si128((__m128i *)(top + i));
+        __m128i bottom_pixels = _mm_load_si128((__m128i *)(bottom + i));
+
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(top_pixels, zero), top_weight),
+                                    _mm_mullo_epi16(_mm_unpacklo_epi8(bottom_pixels, zero), bottom_weight));
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(top_pixels, zero), top_weight),
+                                     _mm_mullo_epi16(_mm_unpackhi_epi8(bottom_pixels, zero), bottom_weight));
+        low = _mm_srli_epi16(_mm_add_epi16(low, round), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(high, round), 8);
 
-        dest += tex_pitch;
-        src += buffer->pitch;
+        _mm_store_si128((__m128i *)(dest + i), _mm_packus_epi16(low, high));
     }
+}
+
+// Two output pixels, each from the pair of source pixels at its column, in 16-bit channels.
+inline __m128i SDL3FilterPixelPairSSE2(uint32 *source, int32 first, int32 second,
+                                       __m128i first_weights, __m128i second_weights)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i first_pair = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(source + first)), zero);
+    __m128i second_pair = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(source + second)), zero);
+    first_pair = _mm_mullo_epi16(first_pair, first_weights);
+    second_pair = _mm_mullo_epi16(second_pair, second_weights);
+
+    __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(first_pair, second_pair),
+                                _mm_unpackhi_epi64(first_pair, second_pair));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+}
+
+internal void SDL3FilterRowSSE2(uint32 *dest, uint32 *source, SDL3UpscaleTap *taps, __m128i *weights,
+                                int32 min_x, int32 max_x)
+{
+    for (int32 i = min_x; i < max_x; i += 4)
+    {
+        __m128i low = SDL3FilterPixelPairSSE2(source, taps[i].index, taps[i + 1].index,
+                                              weights[i], weights[i + 1]);
+        __m128i high = SDL3FilterPixelPairSSE2(source, taps[i + 2].index, taps[i + 3].index,
+                                               weights[i + 2], weights[i + 3]);
+        _mm_store_si128((__m128i *)(dest + i), _mm_packus_epi16(low, high));
+    }
+}
+
+// NOTE(mara): Groups of four output pixels that read game pixels index to index + 4, three further
+// along each group, always with the same weights (see SDL3ResizeWindow). Two loads cover a whole
+// group, so it's the same sums as SDL3FilterRowSSE2 without any of its loads per pixel.
+internal void SDL3FilterRowFixedRatioSSE2(uint32 *dest, uint32 *source, int32 index, int32 group_count,
+                                          __m128i *weights)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i round = _mm_set1_epi16(128);
+
+    for (int32 group = 0; group < group_count; ++group)
+    {
+        __m128i first = _mm_loadu_si128((__m128i *)(source + index + 3 * group));
+        __m128i second = _mm_loadu_si128((__m128i *)(source + index + 3 * group + 1));
+
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(first, zero), weights[0]),
+                                    _mm_mullo_epi16(_mm_unpacklo_epi8(second, zero), weights[2]));
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(first, zero), weights[1]),
+                                     _mm_mullo_epi16(_mm_unpackhi_epi8(second, zero), weights[3]));
+        low = _mm_srli_epi16(_mm_add_epi16(low, round), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(high, round), 8);
+
+        _mm_store_si128((__m128i *)(dest + 4 * group), _mm_packus_epi16(low, high));
+    }
+}
+
+// Scales one game row across into output columns [min_x, max_x), both multiples of four.
+internal void SDL3FilterRow(SDL3OffscreenBuffer *buffer, uint32 *dest, uint32 *source, int32 min_x, int32 max_x)
+{
+    int32 fixed_min_x = MinInt32(MaxInt32(min_x, 4), max_x);
+    int32 fixed_max_x = MaxInt32(MinInt32(4 + 4 * buffer->fixed_ratio_group_count, max_x), fixed_min_x);
+
+    SDL3FilterRowSSE2(dest, source, buffer->column_taps, buffer->column_weights, min_x, fixed_min_x);
+    if (fixed_min_x < fixed_max_x)
+    {
+        SDL3FilterRowFixedRatioSSE2(dest + fixed_min_x, source, buffer->column_taps[fixed_min_x].index,
+                                    (fixed_max_x - fixed_min_x) / 4, buffer->fixed_ratio_weights);
+    }
+    SDL3FilterRowSSE2(dest, source, buffer->column_taps, buffer->column_weights, fixed_max_x, max_x);
+}
+
+// Scales the game's pixels in rect up into output_memory. Returns the output pixels that changed.
+internal GameRect SDL3UpscaleRect(SDL3OffscreenBuffer *buffer, GameRect rect)
+{
+    GameRect result;
+
+    // The upscalers work in groups of four game or output pixels.
+    int32 min_x = rect.min_x & ~3;
+    int32 max_x = (int32)AlignPow2(rect.max_x, 4);
+
+    if (buffer->integer_scale)
+    {
+        int32 factor = buffer->integer_scale;
+        result.min_x = min_x * factor;
+        result.min_y = rect.min_y * factor;
+        result.max_x = MinInt32(max_x * factor, buffer->output_width);
+        result.max_y = MinInt32(rect.max_y * factor, buffer->output_height);
+
+        int32 output_span_size = (result.max_x - result.min_x) * buffer->bytes_per_pixel;
+        for (int32 y = rect.min_y; y < rect.max_y; ++y)
+        {
+            uint8 *source_row = (uint8 *)buffer->memory + y * buffer->pitch;
+            uint8 *output_row = ((uint8 *)buffer->output_memory + y * factor * buffer->output_pitch +
+                                 result.min_x * buffer->bytes_per_pixel);
+            SDL3RepeatPixelsSSE2((uint32 *)output_row, (uint32 *)source_row + min_x, max_x - min_x, factor);
+
+            int32 repeat_count = MinInt32(factor, buffer->output_height - y * factor);
+            for (int32 repeat = 1; repeat < repeat_count; ++repeat)
+            {
+                memcpy(output_row + repeat * buffer->output_pitch, output_row, output_span_size);
+            }
+        }
+    }
+    else
+    {
+        // NOTE(mara): An output pixel reads the game's pixels index and index + 1 both ways, so it
+        // changed if any of them is in the rectangle. These bounds are a little generous, never short.
+        result.min_x = MaxInt32((min_x - 1) * buffer->output_width / buffer->width, 0) & ~3;
+        result.min_y = MaxInt32((rect.min_y - 1) * buffer->output_height / buffer->height, 0);
+        result.max_x = MinInt32(((max_x + 1) * buffer->output_width + buffer->width - 1) / buffer->width,
+                                buffer->output_width);
+        result.max_y = MinInt32(((rect.max_y + 1) * buffer->output_height + buffer->height - 1) / buffer->height,
+                                buffer->output_height);
+        int32 output_max_x = (int32)AlignPow2(result.max_x, 4);
+
+        // NOTE(mara): Across first, then down. Neighbouring output rows mostly read the same two
+        // game rows, so the last two scaled across are kept and each game row is only done once.
+        int32 filtered_indices[2] = { -1, -1 };
+        for (int32 y = result.min_y; y < result.max_y; ++y)
+        {
+            SDL3UpscaleTap tap = buffer->row_taps[y];
+
+            uint32 *filtered[2];
+            for (int32 pair_index = 0; pair_index < 2; ++pair_index)
+            {
+                int32 index = tap.index + pair_index;
+                int32 slot = (filtered_indices[1] == index) ? 1 : 0;
+                if (filtered_indices[slot] != index)
+                {
+                    // Replace whichever slot doesn't hold the other row of this pair.
+                    int32 other_index = tap.index + (1 - pair_index);
+                    slot = (filtered_indices[0] == other_index) ? 1 : 0;
+                    SDL3FilterRow(buffer, (uint32 *)(buffer->filtered_rows + slot * buffer->output_pitch),
+                                  (uint32 *)((uint8 *)buffer->memory + index * buffer->pitch),
+                                  result.min_x, output_max_x);
+                    filtered_indices[slot] = index;
+                }
+                filtered[pair_index] = (uint32 *)(buffer->filtered_rows + slot * buffer->output_pitch);
+            }
+
+            SDL3BlendRowsSSE2((uint32 *)((uint8 *)buffer->output_memory + y * buffer->output_pitch) + result.min_x,
+                              filtered[0] + result.min_x, filtered[1] + result.min_x,
+                              output_max_x - result.min_x, tap.weight);
+        }
+    }
+
+    return result;
+}
+
+// =================================================================================================
+// PRESENTING
+// =================================================================================================
+
+// Uploads the game's pixels in rect, scaled up first when the game draws smaller than the window.
+internal void SDL3UploadRect(SDL3OffscreenBuffer *buffer, GameRect rect)
+{
+    if (buffer->output_memory)
+    {
+        GameRect output = SDL3UpscaleRect(buffer, rect);
+
+        SDL_Rect span = { output.min_x, output.min_y, output.max_x - output.min_x, output.max_y - output.min_y };
+        SDL_UpdateTexture(buffer->sdl_texture, &span,
+                          ((uint8 *)buffer->output_memory + output.min_y * buffer->output_pitch +
+                           output.min_x * buffer->bytes_per_pixel),
+                          buffer->output_pitch);
+    }
+    else
+    {
+        SDL_Rect span = { rect.min_x, rect.min_y, rect.max_x - rect.min_x, rect.max_y - rect.min_y };
+        SDL_UpdateTexture(buffer->sdl_texture, &span,
+                          ((uint8 *)buffer->memory + rect.min_y * buffer->pitch +
+                           rect.min_x * buffer->bytes_per_pixel),
+                          buffer->pitch);
+    }
+}
+
+// NOTE(mara): Uploads only the rows the game says changed, merged into runs of whole rows (which
+// are contiguous in memory). Used for frames too big for SDL3UploadDirtyTiles' grid.
+internal void SDL3UploadDirtyRows(SDL3OffscreenBuffer *buffer, GameDirtyRects *dirty)
+{
+    // Sort the rectangles' row ranges by their first row (insertion sort: there are only a few
+    // hundred and they mostly arrive in order already), then upload each run of overlapping ones.
+    local_persist GameRect rows[MAX_DIRTY_RECTS];
+    int32 row_count = dirty->count;
+    for (int32 i = 0; i < row_count; ++i)
+    {
+        GameRect rect = dirty->rects[i];
+        int32 j = i;
+        while (j > 0 && rows[j - 1].min_y > rect.min_y)
+        {
+            rows[j] = rows[j - 1];
+            --j;
+        }
+        rows[j] = rect;
+    }
+
+    GameRect span = { 0, rows[0].min_y, buffer->width, rows[0].max_y };
+    for (int32 i = 1; i <= row_count; ++i)
+    {
+        if (i < row_count && rows[i].min_y <= span.max_y)
+        {
+            if (rows[i].max_y > span.max_y)
+            {
+                span.max_y = rows[i].max_y;
+            }
+        }
+        else
+        {
+            SDL3UploadRect(buffer, span);
+
+            if (i < row_count)
+            {
+                span.min_y = rows[i].min_y;
+                span.max_y = rows[i].max_y;
+            }
+        }
+    }
+}
+
+// NOTE(mara): Whole rows would still copy most of the frame, because something changes on nearly
+// every row somewhere. So the rectangles get snapped to a grid of tiles, and every row of tiles
+// goes up as runs of neighbouring dirty tiles. The copy follows how much of the screen changed,
+// in at most a call per run instead of one per rectangle. The tiles are in game pixels, so when
+// the frame gets scaled up only the output around each run is scaled, too.
+internal void SDL3UploadDirtyTiles(SDL3OffscreenBuffer *buffer, GameDirtyRects *dirty)
+{
+    int32 tile_columns = (buffer->width + SDL3_UPLOAD_TILE_SIZE - 1) / SDL3_UPLOAD_TILE_SIZE;
+    int32 tile_rows = (buffer->height + SDL3_UPLOAD_TILE_SIZE - 1) / SDL3_UPLOAD_TILE_SIZE;
+    if (tile_columns > SDL3_MAX_UPLOAD_TILE_COLUMNS || tile_rows > SDL3_MAX_UPLOAD_TILE_ROWS)
+    {
+        SDL3UploadDirtyRows(buffer, dirty);
+        return;
+    }
+
+    local_persist uint8 is_tile_dirty[SDL3_MAX_UPLOAD_TILE_ROWS][SDL3_MAX_UPLOAD_TILE_COLUMNS];
+    for (int32 tile_y = 0; tile_y < tile_rows; ++tile_y)
+    {
+        for (int32 tile_x = 0; tile_x < tile_columns; ++tile_x)
+        {
+            is_tile_dirty[tile_y][tile_x] = false;
+        }
+    }
+
+    for (int32 i = 0; i < dirty->count; ++i)
+    {
+        GameRect rect = dirty->rects[i];
+        int32 min_x = MaxInt32(rect.min_x, 0);
+        int32 min_y = MaxInt32(rect.min_y, 0);
+        int32 max_x = MinInt32(rect.max_x, buffer->width);
+        int32 max_y = MinInt32(rect.max_y, buffer->height);
+        if (min_x >= max_x || min_y >= max_y)
+        {
+            continue;
+        }
+
+        int32 last_tile_x = (max_x - 1) / SDL3_UPLOAD_TILE_SIZE;
+        int32 last_tile_y = (max_y - 1) / SDL3_UPLOAD_TILE_SIZE;
+        for (int32 tile_y = min_y / SDL3_UPLOAD_TILE_SIZE; tile_y <= last_tile_y; ++tile_y)
+        {
+            for (int32 tile_x = min_x / SDL3_UPLOAD_TILE_SIZE; tile_x <= last_tile_x; ++tile_x)
+            {
+                is_tile_dirty[tile_y][tile_x] = true;
+            }
+        }
+    }
+
+    for (int32 tile_y = 0; tile_y < tile_rows; ++tile_y)
+    {
+        int32 min_y = tile_y * SDL3_UPLOAD_TILE_SIZE;
+        int32 max_y = MinInt32(min_y + SDL3_UPLOAD_TILE_SIZE, buffer->height);
+
+        int32 tile_x = 0;
+        while (tile_x < tile_columns)
+        {
+            if (!is_tile_dirty[tile_y][tile_x])
+            {
+                ++tile_x;
+                continue;
+            }
+
+            int32 run_start = tile_x;
+            while (tile_x < tile_columns && is_tile_dirty[tile_y][tile_x])
+            {
+                ++tile_x;
+            }
+
+            GameRect span = { run_start * SDL3_UPLOAD_TILE_SIZE, min_y,
+                              MinInt32(tile_x * SDL3_UPLOAD_TILE_SIZE, buffer->width), max_y };
+            SDL3UploadRect(buffer, span);
+        }
+    }
+}
+
+// NOTE(mara): The texture keeps everything the game didn't change from the frames before, just
+// like the buffer does, so from here on the game can be told the buffer is preserved.
+internal void SDL3DisplayBufferInWindow(SDL3OffscreenBuffer *buffer, GameDirtyRects *dirty)
+{
+    if (dirty->is_everything || !buffer->is_preserved)
+    {
+        GameRect everything = { 0, 0, buffer->width, buffer->height };
+        SDL3UploadRect(buffer, everything);
+    }
+    else if (dirty->count > 0)
+    {
+        SDL3UploadDirtyTiles(buffer, dirty);
+    }
+    buffer->is_preserved = true;
 
-    SDL_UnlockTexture(buffer->sdl_texture);
     SDL_RenderTexture(buffer->sdl_renderer, buffer->sdl_texture, NULL, NULL);
     SDL_RenderPresent(buffer->sdl_renderer);
 }
@@ -253,11 +1089,126 @@ inline float64 SDL3GetSecondsElapsed(float64 perf_count_frequency, uint64 start,
     return ((float64)(end - start) / perf_count_frequency);
 }
 
+#if ASTEROIDS_LINUX
+inline uint64 SDL3GetPacerTimeNS()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64)now.tv_sec * 1000000000ull + (uint64)now.tv_nsec;
+}
+
+internal void SDL3SleepUntilNS(uint64 wake_time_ns)
+{
+    struct timespec wake_time;
+    wake_time.tv_sec = (time_t)(wake_time_ns / 1000000000ull);
+    wake_time.tv_nsec = (long)(wake_time_ns % 1000000000ull);
+
+    // NOTE(mara): An absolute deadline, so a signal that interrupts the sleep can just sleep again
+    // without the error piling up.
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake_time, 0) == EINTR)
+    {
+    }
+}
+#else
+inline uint64 SDL3GetPacerTimeNS()
+{
+    return SDL_GetTicksNS();
+}
+
+internal void SDL3SleepUntilNS(uint64 wake_time_ns)
+{
+    uint64 now = SDL_GetTicksNS();
+    if (wake_time_ns > now)
+    {
+        SDL_DelayNS(wake_time_ns - now);
+    }
+}
+#endif
+
+internal void SDL3InitializeFramePacer(SDL3FramePacer *pacer, float64 target_seconds_per_frame)
+{
+    *pacer = {};
+    pacer->frame_duration_ns = (uint64)(target_seconds_per_frame * 1000000000.0);
+    pacer->spin_ns = 4 * SDL3_PACER_MIN_SPIN_NS;
+    pacer->next_deadline_ns = SDL3GetPacerTimeNS() + pacer->frame_duration_ns;
+}
+
+// NOTE(mara): Deadlines are absolute, one frame_duration apart, so sleeping a little long one frame
+// doesn't push every following frame back. A frame that is already late starts a new schedule
+// from now instead of trying to catch up.
+internal void SDL3WaitForNextFrame(SDL3FramePacer *pacer)
+{
+    uint64 deadline = pacer->next_deadline_ns;
+    uint64 now = SDL3GetPacerTimeNS();
+
+    if (now < deadline)
+    {
+        uint64 wake_time = deadline - pacer->spin_ns;
+        if (now < wake_time)
+        {
+            SDL3SleepUntilNS(wake_time);
+
+            // Track how late the OS wakes us, and wake up early by about twice that.
+            uint64 woke = SDL3GetPacerTimeNS();
+            uint64 oversleep = (woke > wake_time) ? (woke - wake_time) : 0;
+            pacer->oversleep_estimate_ns = (7 * pacer->oversleep_estimate_ns + oversleep) / 8;
+
+            pacer->spin_ns = 2 * pacer->oversleep_estimate_ns;
+            if (pacer->spin_ns < SDL3_PACER_MIN_SPIN_NS)
+            {
+                pacer->spin_ns = SDL3_PACER_MIN_SPIN_NS;
+            }
+            if (pacer->spin_ns > SDL3_PACER_MAX_SPIN_NS)
+            {
+                pacer->spin_ns = SDL3_PACER_MAX_SPIN_NS;
+            }
+        }
+
+        uint64 spin_start = SDL3GetPacerTimeNS();
+        do
+        {
+            now = SDL3GetPacerTimeNS();
+        } while (now < deadline);
+        pacer->spin_sum_ns += (spin_start < deadline) ? (now - spin_start) : 0;
+
+        pacer->next_deadline_ns = deadline + pacer->frame_duration_ns;
+    }
+    else
+    {
+        ++pacer->missed_frame_count;
+        pacer->next_deadline_ns = now + pacer->frame_duration_ns;
+    }
+
+    uint64 wake_error = now - deadline;
+    pacer->wake_error_sum_ns += wake_error;
+    if (wake_error > pacer->wake_error_max_ns)
+    {
+        pacer->wake_error_max_ns = wake_error;
+    }
+
+    if (++pacer->frame_count == SDL3_PACER_REPORT_FRAMES)
+    {
+#if ASTEROIDS_DEBUG
+        SDL_Log("Frame pacer: %llu frames, %llu missed, wake error avg %.1fus max %.1fus, spin avg %.1fus\n",
+                (unsigned long long)pacer->frame_count,
+                (unsigned long long)pacer->missed_frame_count,
+                (float64)pacer->wake_error_sum_ns / (1000.0 * pacer->frame_count),
+                (float64)pacer->wake_error_max_ns / 1000.0,
+                (float64)pacer->spin_sum_ns / (1000.0 * pacer->frame_count));
+#endif
+        pacer->frame_count = 0;
+        pacer->missed_frame_count = 0;
+        pacer->wake_error_sum_ns = 0;
+        pacer->wake_error_max_ns = 0;
+        pacer->spin_sum_ns = 0;
+    }
+}
+
 // =================================================================================================
 // WINDOW EVENT PROCESSING
 // =================================================================================================
 
-internal void SDL3ProcessPendingMessages(GameControllerInput *keyboard_input)
+internal void SDL3ProcessPendingMessages(SDL3State *state, GameControllerInput *keyboard_input)
 {
     SDL_Event event;
     while (SDL_PollEvent(&event))
@@ -320,6 +1271,23 @@ internal void SDL3ProcessPendingMessages(GameControllerInput *keyboard_input)
                 {
                     global_is_paused = !global_is_paused;
                 }
+                else if (key_code == SDLK_L && is_down && !event.key.repeat)
+                {
+                    // L cycles: record -> loop the recording -> back to live input.
+                    if (state->is_playing_back)
+                    {
+                        SDL3EndInputPlayback(state);
+                    }
+                    else if (state->is_recording)
+                    {
+                        SDL3EndRecordingInput(state);
+                        SDL3BeginInputPlayback(state);
+                    }
+                    else
+                    {
+                        SDL3BeginRecordingInput(state);
+                    }
+                }
 #endif
 
                 // Handle ALT-F4 case. Might not be necessary but I think it's good practice to have
@@ -358,18 +1326,34 @@ int main(int argc, char *argv[])
                                         SDL_WINDOW_RESIZABLE,
                                         &window, &backbuffer.sdl_renderer))
         {
-            SDL3ResizeWindow(&backbuffer, WINDOW_WIDTH, WINDOW_HEIGHT);
+            // The game draws at ASTEROIDS_RENDER_SCALE percent of the window's size, all of it by
+            // default. Whole fractions (50, 25) scale up by repeating pixels, others bilinearly.
+            backbuffer.render_scale = SDL3_MAX_RENDER_SCALE;
+            const char *render_scale = SDL_getenv("ASTEROIDS_RENDER_SCALE");
+            if (render_scale)
+            {
+                backbuffer.render_scale = MinInt32(MaxInt32(SDL_atoi(render_scale), SDL3_MIN_RENDER_SCALE),
+                                                   SDL3_MAX_RENDER_SCALE);
+            }
+
+            SDL3WindowDimensions dimension = SDL3GetWindowDimensions(backbuffer.sdl_renderer);
+            if (dimension.width <= 0 || dimension.height <= 0)
+            {
+                dimension.width = WINDOW_WIDTH;
+                dimension.height = WINDOW_HEIGHT;
+            }
+            SDL3ResizeWindow(&backbuffer, dimension.width, dimension.height);
 
             // Build paths for game dlls.
             SDL3GetEXEFileName(&sdl3_state);
 
             char source_game_code_dll_full_path[SDL3_STATE_FILE_NAME_COUNT];
-            SDL3BuildPathFromEXE(&sdl3_state, "asteroids.dll",
+            SDL3BuildPathFromEXE(&sdl3_state, SDL3_GAME_CODE_FILE_NAME,
                                  sizeof(source_game_code_dll_full_path),
                                  source_game_code_dll_full_path);
 
             char temp_game_code_dll_full_path[SDL3_STATE_FILE_NAME_COUNT];
-            SDL3BuildPathFromEXE(&sdl3_state, "asteroids_temp.dll",
+            SDL3BuildPathFromEXE(&sdl3_state, SDL3_GAME_CODE_TEMP_FILE_NAME_0,
                                  sizeof(temp_game_code_dll_full_path),
                                  temp_game_code_dll_full_path);
 
@@ -381,8 +1365,7 @@ int main(int argc, char *argv[])
             {
                 monitor_refresh_hz = display_mode->refresh_rate;
             }
-            float32 game_update_hz = monitor_refresh_hz/* / 2.0f */;
-            float32 target_seconds_per_frame = 1.0f / game_update_hz;
+            float32 target_seconds_per_frame = 1.0f / monitor_refresh_hz;
 
             // Sound Initialization
             SDL3SoundOutput sound_output = {};
@@ -408,9 +1391,9 @@ int main(int argc, char *argv[])
             game_memory.transient_storage_size = MEGABYTES(32);
 
             sdl3_state.total_size = game_memory.permanent_storage_size + game_memory.transient_storage_size;
-            sdl3_state.game_memory_block = SDL_malloc((size_t)sdl3_state.total_size);
-            memset(sdl3_state.game_memory_block, 0, sdl3_state.total_size); // SDL_malloc memory not initialized to 0 by default.
+            sdl3_state.game_memory_block = SDL3AllocateGameMemory(sdl3_state.total_size);
 
+            sdl3_state.permanent_storage_size = game_memory.permanent_storage_size;
             game_memory.permanent_storage = sdl3_state.game_memory_block;
             game_memory.transient_storage = ((uint8 *)game_memory.permanent_storage + game_memory.permanent_storage_size);
 
@@ -418,6 +1401,26 @@ int main(int argc, char *argv[])
             game_memory.platform_api.FreeFileMemory = PlatformFreeFileMemory;
             game_memory.platform_api.ReadEntireFile = PlatformReadEntireFile;
             game_memory.platform_api.WriteEntireFile = PlatformWriteEntireFile;
+            game_memory.platform_api.AddWorkEntry = SDL3AddWorkEntry;
+            game_memory.platform_api.CompleteAllWork = SDL3CompleteAllWork;
+
+            // Anti-aliased lines are opt-in: ASTEROIDS_SMOOTH_LINES=1.
+            const char *smooth_lines = SDL_getenv("ASTEROIDS_SMOOTH_LINES");
+            game_memory.smooth_lines = (smooth_lines && smooth_lines[0] == '1');
+
+            // NOTE(mara): The main thread renders too while it waits, so one helper per other core.
+            // On a single core there's nobody to help and the game just draws on the main thread.
+            local_persist PlatformWorkQueue render_queue = {};
+            int32 render_thread_count = SDL_GetNumLogicalCPUCores() - 1;
+            if (render_thread_count > SDL3_MAX_RENDER_THREADS)
+            {
+                render_thread_count = SDL3_MAX_RENDER_THREADS;
+            }
+            if (render_thread_count > 0 && SDL3StartWorkQueue(&render_queue, render_thread_count))
+            {
+                game_memory.render_queue = &render_queue;
+                game_memory.render_worker_count = render_thread_count;
+            }
 
             global_is_running = true;
 
@@ -430,34 +1433,64 @@ int main(int argc, char *argv[])
                 GameTime game_time = {};
                 uint64 last_time_counter = SDL3GetTimeCounter();
                 uint64 flip_time_counter = SDL3GetTimeCounter();
-                game_time.delta_time = target_seconds_per_frame; // We should actually calculate this.
+                game_time.delta_time = 1.0 / SDL3_GAME_UPDATE_HZ;
+
+                // Start with one tick's worth of time so the very first frame has something to draw.
+                float64 tick_accumulator = game_time.delta_time;
+                bool32 was_input_consumed = true;
 
                 SDL3GameCode game_code = SDL3LoadGameCode(source_game_code_dll_full_path,
                                                           temp_game_code_dll_full_path);
 
+#if ASTEROIDS_LINUX
+                SDL3GameCodeWatcher game_code_watcher = {};
+                bool32 is_watching_game_code = SDL3StartGameCodeWatcher(&sdl3_state, &game_code_watcher);
+#endif
+
+                SDL3FramePacer frame_pacer;
+                SDL3InitializeFramePacer(&frame_pacer, target_seconds_per_frame);
+
                 uint64 last_cycle_count = SDL3GetTimeCounter();
                 while (global_is_running)
                 {
+#if ASTEROIDS_LINUX
+                    // NOTE(mara): The watcher has already loaded the new build, so swapping it in
+                    // here between frames is just an atomic load when nothing changed.
+                    if (is_watching_game_code &&
+                        SDL_GetAtomicInt(&game_code_watcher.is_reload_pending))
+                    {
+                        SDL3UnloadGameCode(&game_code);
+                        game_code = game_code_watcher.pending_game_code;
+                        SDL_SetAtomicInt(&game_code_watcher.is_reload_pending, 0);
+                    }
+#else
                     SDL_Time new_dll_write_time = SDL3GetLastFileWriteTime(source_game_code_dll_full_path);
                     if (new_dll_write_time != game_code.dll_last_write_time)
                     {
                         SDL3UnloadGameCode(&game_code);
                         game_code = SDL3LoadGameCode(source_game_code_dll_full_path, temp_game_code_dll_full_path);
                     }
+#endif
 
                     GameControllerInput *old_keyboard_controller = GetController(old_input, 0);
                     GameControllerInput *new_keyboard_controller = GetController(new_input, 0);
-                    *new_keyboard_controller = {};
-                    new_keyboard_controller->is_connected = true;
-                    for (int button_index = 0;
-                         button_index < ArrayCount(new_keyboard_controller->buttons);
-                         ++button_index)
+
+                    // NOTE(mara): If no update ran last frame, the game hasn't seen the presses in
+                    // new_input yet. Keep adding to it instead of starting over, or they'd be lost.
+                    if (was_input_consumed)
                     {
-                        new_keyboard_controller->buttons[button_index].ended_down =
-                            old_keyboard_controller->buttons[button_index].ended_down;
+                        *new_keyboard_controller = {};
+                        new_keyboard_controller->is_connected = true;
+                        for (int button_index = 0;
+                             button_index < ArrayCount(new_keyboard_controller->buttons);
+                             ++button_index)
+                        {
+                            new_keyboard_controller->buttons[button_index].ended_down =
+                                old_keyboard_controller->buttons[button_index].ended_down;
+                        }
                     }
 
-                    SDL3ProcessPendingMessages(new_keyboard_controller);
+                    SDL3ProcessPendingMessages(&sdl3_state, new_keyboard_controller);
 
                     if (!global_is_paused)
                     {
@@ -560,9 +1593,20 @@ int main(int argc, char *argv[])
                             new_controller->is_connected = false;
                         }
 
-                        // Game update and render step.
+                        // NOTE(mara): The buffer follows the window's size in pixels, so the
+                        // playfield does too. A minimized window reports nothing, keep the old size.
+                        SDL3WindowDimensions dimension = SDL3GetWindowDimensions(backbuffer.sdl_renderer);
+                        if (dimension.width > 0 && dimension.height > 0 &&
+                            (dimension.width != backbuffer.output_width ||
+                             dimension.height != backbuffer.output_height))
+                        {
+                            SDL3ResizeWindow(&backbuffer, dimension.width, dimension.height);
+                        }
+
+                        // NOTE(mara): Updates never touch the pixels, so there's nothing to point
+                        // them at until the texture is locked for rendering.
                         GameOffscreenBuffer offscreen_buffer = {};
-                        offscreen_buffer.memory = backbuffer.memory;
+                        offscreen_buffer.memory = 0;
                         offscreen_buffer.width = backbuffer.width;
                         offscreen_buffer.height = backbuffer.height;
                         offscreen_buffer.pitch = backbuffer.pitch;
@@ -570,66 +1614,81 @@ int main(int argc, char *argv[])
 
                         GameSoundOutput game_sound = {};
 
-                        if (game_code.UpdateAndRender)
+                        // Game update step. Run as many fixed ticks as the time since the last frame
+                        // pays for; whatever is left over carries into the next frame.
+                        int32 ticks_this_frame = 0;
+                        while (tick_accumulator >= game_time.delta_time)
                         {
-                            game_code.UpdateAndRender(&game_memory, &game_time, new_input, &offscreen_buffer, &game_sound);
-                        }
-
-                        // Sound Processing.
-                        SDL3UpdateSound(&sound_output, &game_sound, sdl_audio_stream);
-
-                        // Perform timing calculations and sleep.
-                        uint64 time_now = SDL3GetTimeCounter();
-                        float64 frame_time = SDL3GetSecondsElapsed(perf_count_frequency,
-                                                                   last_time_counter, time_now);
+                            if (ticks_this_frame > 0)
+                            {
+                                // Only the first tick of a frame should see this frame's presses.
+                                SDL3ClearHalfTransitionCounts(new_input);
+                            }
 
-                        if (frame_time < target_seconds_per_frame)
-                        {
-                            int32 sleep_ms = (int32)(1000 * (target_seconds_per_frame - frame_time));
-                            if (sleep_ms > 0)
+                            if (sdl3_state.is_recording)
                             {
-                                SDL_Delay(sleep_ms);
+                                SDL3RecordInput(&sdl3_state, new_input);
                             }
 
-                            // Make sure that we slept here if we needed it this frame.
-                            float64 test_frame_time = SDL3GetSecondsElapsed(perf_count_frequency,
-                                                                            last_time_counter,
-                                                                            SDL3GetTimeCounter());
-                            if (test_frame_time < target_seconds_per_frame)
+                            if (sdl3_state.is_playing_back)
                             {
-                                SDL_LogWarn(SDL_LOG_CATEGORY_SYSTEM, "Missed sleep!\n");
+                                SDL3PlaybackInput(&sdl3_state, new_input);
                             }
 
-                            // Finally, just spin out in a while loop if we missed the sleep.
-                            while (frame_time < target_seconds_per_frame)
+                            if (game_code.Update)
                             {
-                                frame_time = SDL3GetSecondsElapsed(perf_count_frequency,
-                                                                   last_time_counter,
-                                                                   SDL3GetTimeCounter());
+                                game_code.Update(&game_memory, &game_time, new_input, &offscreen_buffer, &game_sound);
                             }
+
+                            game_time.total_time += game_time.delta_time;
+                            tick_accumulator -= game_time.delta_time;
+                            ++ticks_this_frame;
                         }
-                        else
+                        was_input_consumed = (ticks_this_frame > 0);
+
+                        // Game render step. Draw the fraction of the way into the next tick that the
+                        // accumulator is at, so motion stays smooth when the refresh rate isn't a
+                        // multiple of the update rate.
+                        game_time.render_blend = tick_accumulator / game_time.delta_time;
+
+                        offscreen_buffer.memory = backbuffer.memory;
+                        offscreen_buffer.is_preserved = backbuffer.is_preserved;
+
+                        if (game_code.Render)
                         {
-                            // TODO(mara): Proper logging for the fact we missed the target fps!
-                            SDL_Log("Missed target FPS!\n");
+                            game_code.Render(&game_memory, &game_time, &offscreen_buffer);
                         }
 
-                        game_time.total_time += frame_time;
+                        // Sound Processing.
+                        SDL3UpdateSound(&sound_output, &game_sound, sdl_audio_stream);
+
+                        // Sleep until this frame's deadline.
+                        SDL3WaitForNextFrame(&frame_pacer);
 
                         uint64 end_time_counter = SDL3GetTimeCounter();
-                        float64 ms_per_frame = 1000.0 * SDL3GetSecondsElapsed(perf_count_frequency,
-                                                                              last_time_counter,
-                                                                              end_time_counter);
+                        float64 seconds_this_frame = SDL3GetSecondsElapsed(perf_count_frequency,
+                                                                           last_time_counter,
+                                                                           end_time_counter);
+                        float64 ms_per_frame = 1000.0 * seconds_this_frame;
                         last_time_counter = end_time_counter;
 
-                        // Blit to the screen's texture.
-                        SDL3DisplayBufferInWindow(&backbuffer);
+                        if (seconds_this_frame > SDL3_MAX_FRAME_SECONDS)
+                        {
+                            seconds_this_frame = SDL3_MAX_FRAME_SECONDS;
+                        }
+                        tick_accumulator += seconds_this_frame;
+
+                        // Upload what changed and present.
+                        SDL3DisplayBufferInWindow(&backbuffer, &offscreen_buffer.dirty);
 
                         flip_time_counter = SDL3GetTimeCounter();
 
-                        GameInput *temp = new_input;
-                        new_input = old_input;
-                        old_input = temp;
+                        if (was_input_consumed)
+                        {
+                            GameInput *temp = new_input;
+                            new_input = old_input;
+                            old_input = temp;
+                        }
 
                         // TODO(mara): Figure out FPS and output that.
                     }
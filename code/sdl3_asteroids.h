@@ -6,8 +6,44 @@
 
 #define SDL3_STATE_FILE_NAME_COUNT 260
 
+#define SDL3_HUGE_PAGE_SIZE MEGABYTES(2)
+
 #define SDL3_GAMEPAD_AXIS_DEADZONE 7849
 
+// NOTE(mara): The simulation always ticks at this rate, whatever the monitor refreshes at. Frames
+// that took longer than the maximum (breakpoints, window drags) only count for that long, so we
+// never try to catch up on seconds of simulation in one go.
+#define SDL3_GAME_UPDATE_HZ 60
+#define SDL3_MAX_FRAME_SECONDS 0.25
+
+// NOTE(mara): The pacer sleeps until a little before each deadline and spins the rest of the way.
+// How early it wakes follows how late the OS has been waking us up, within these bounds.
+#define SDL3_PACER_MIN_SPIN_NS 50000ull
+#define SDL3_PACER_MAX_SPIN_NS 2000000ull
+#define SDL3_PACER_REPORT_FRAMES 600
+
+#define SDL3_MAX_RENDER_THREADS 64
+
+// NOTE(mara): The game can draw at a percentage of the window's size (ASTEROIDS_RENDER_SCALE) and
+// get scaled up on the way to the texture: whole multiples by repeating pixels, anything else
+// bilinearly.
+#define SDL3_MIN_RENDER_SCALE 25
+#define SDL3_MAX_RENDER_SCALE 100
+
+// NOTE(mara): Dirty rectangles are uploaded as runs of tiles this big. Bigger frames than the grid
+// can hold fall back to uploading whole rows.
+#define SDL3_UPLOAD_TILE_SIZE 32
+#define SDL3_MAX_UPLOAD_TILE_COLUMNS 128
+#define SDL3_MAX_UPLOAD_TILE_ROWS 128
+
+// One output column (or row) of the bilinear upscale: it lies weight/256 of the way from source
+// pixel index to index + 1.
+struct SDL3UpscaleTap
+{
+    int32 index;
+    int32 weight;
+};
+
 struct SDL3OffscreenBuffer
 {
     SDL_Renderer *sdl_renderer;
@@ -17,6 +53,27 @@ struct SDL3OffscreenBuffer
     int32 height;
     int32 pitch;
     int32 bytes_per_pixel;
+
+    // NOTE(mara): memory still holds the last frame, and the texture matches it. Locking the texture
+    // can't promise that (locked pixels start out undefined), so the game draws into memory of our
+    // own and only the rows it changed get uploaded.
+    bool32 is_preserved;
+
+    // NOTE(mara): The window's size in pixels and what the game's frame gets scaled up to before
+    // it's uploaded. At a render scale of 100 the game draws at this size and output_memory is 0.
+    int32 render_scale; // Percent.
+    int32 output_width;
+    int32 output_height;
+    int32 output_pitch;
+    void *output_memory;
+
+    int32 integer_scale; // Output pixels per game pixel when that's a whole number, 0 otherwise.
+    SDL3UpscaleTap *column_taps;
+    __m128i *column_weights; // Each column's 256 - weight for four channels, then weight for four.
+    int32 fixed_ratio_group_count; // Groups of four columns from column 4 on that SDL3FilterRowFixedRatioSSE2 can do.
+    __m128i fixed_ratio_weights[4]; // Their 256 - weights for columns 0-1 and 2-3, then weights for 0-1 and 2-3.
+    SDL3UpscaleTap *row_taps;
+    uint8 *filtered_rows; // Two of the game's rows already scaled across, output_pitch apart.
 };
 
 struct SDL3WindowDimensions
@@ -33,21 +90,92 @@ struct SDL3SoundOutput
     uint32 buffer_size; // Audio buffer size in bytes.
 };
 
+struct SDL3FramePacer
+{
+    uint64 frame_duration_ns;
+    uint64 next_deadline_ns;
+    uint64 spin_ns; // Wake up this long before the deadline and spin for the rest.
+    uint64 oversleep_estimate_ns;
+
+    // Stats since the last report. A wake error is how far past its deadline a frame was let go.
+    uint64 frame_count;
+    uint64 missed_frame_count; // Frames that were already past their deadline before we waited.
+    uint64 wake_error_sum_ns;
+    uint64 wake_error_max_ns;
+    uint64 spin_sum_ns;
+};
+
 struct SDL3GameCode
 {
     SDL_SharedObject *game_code_dll;
     SDL_Time dll_last_write_time;
 
-    GameUpdateAndRenderFunc *UpdateAndRender;
+    GameUpdateFunc *Update;
+    GameRenderFunc *Render;
 
     bool32 is_valid;
 };
 
+#if ASTEROIDS_LINUX
+#define SDL3_GAME_CODE_FILE_NAME "asteroids.so"
+#define SDL3_GAME_CODE_TEMP_FILE_NAME_0 "asteroids_temp_0.so"
+#define SDL3_GAME_CODE_TEMP_FILE_NAME_1 "asteroids_temp_1.so"
+
+// NOTE(mara): Watches the game code on its own thread and loads new builds there, so the main loop
+// never stats the file or waits on the loader. A loaded build is handed over through
+// is_reload_pending and the main loop swaps it in between frames. Until it has, the watcher holds on
+// to any newer build, so it never overwrites the temp copy that's still loaded.
+struct SDL3GameCodeWatcher
+{
+    SDL_Thread *thread;
+    int inotify_fd;
+
+    char directory[SDL3_STATE_FILE_NAME_COUNT];
+    char source_dll_full_path[SDL3_STATE_FILE_NAME_COUNT];
+    char temp_dll_full_paths[2][SDL3_STATE_FILE_NAME_COUNT];
+    int32 next_temp_dll_index;
+
+    SDL3GameCode pending_game_code;
+    SDL_AtomicInt is_reload_pending;
+};
+#else
+#define SDL3_GAME_CODE_FILE_NAME "asteroids.dll"
+#define SDL3_GAME_CODE_TEMP_FILE_NAME_0 "asteroids_temp.dll"
+#endif
+
+struct PlatformWorkQueueEntry
+{
+    PlatformWorkQueueCallback *callback;
+    void *data;
+};
+
+// NOTE(mara): One thread adds entries, any thread (the adding one included, while it waits in
+// CompleteAllWork) takes them. The ring indices are the only thing the threads fight over.
+struct PlatformWorkQueue
+{
+    uint32 completion_goal; // Only touched by the adding thread.
+    SDL_AtomicInt completion_count;
+
+    SDL_AtomicInt next_entry_to_write;
+    SDL_AtomicInt next_entry_to_read;
+    SDL_Semaphore *semaphore;
+
+    PlatformWorkQueueEntry entries[PLATFORM_MAX_WORK_ENTRIES];
+};
+
 struct SDL3State
 {
     uint64 total_size;
     void *game_memory_block;
 
+    // NOTE(mara): Input recording. A recording is a snapshot of the permanent storage followed by
+    // every GameInput the game was updated with, one per tick.
+    uint64 permanent_storage_size;
+    SDL_IOStream *recording_handle;
+    SDL_IOStream *playback_handle;
+    bool32 is_recording;
+    bool32 is_playing_back;
+
     char exe_filename[SDL3_STATE_FILE_NAME_COUNT];
     char *one_past_last_exe_filenmae_slash;
 };
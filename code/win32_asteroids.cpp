@@ -156,14 +156,16 @@ internal Win32GameCode Win32LoadGameCode(char *source_dll_name, char *temp_dll_n
     result.game_code_dll = LoadLibraryA(temp_dll_name);
     if (result.game_code_dll)
     {
-        result.UpdateAndRender = (GameUpdateAndRenderFunc *)GetProcAddress(result.game_code_dll, "GameUpdateAndRender");
+        result.Update = (GameUpdateFunc *)GetProcAddress(result.game_code_dll, "GameUpdate");
+        result.Render = (GameRenderFunc *)GetProcAddress(result.game_code_dll, "GameRender");
 
-        result.is_valid = (result.UpdateAndRender != 0);
+        result.is_valid = (result.Update && result.Render);
     }
 
     if (!result.is_valid)
     {
-        result.UpdateAndRender = 0;
+        result.Update = 0;
+        result.Render = 0;
     }
 
     return result;
@@ -178,7 +180,8 @@ internal void Win32UnloadGameCode(Win32GameCode *game_code)
     }
 
     game_code->is_valid = false;
-    game_code->UpdateAndRender = 0;
+    game_code->Update = 0;
+    game_code->Render = 0;
 }
 
 // =================================================================================================
@@ -423,12 +426,10 @@ void Win32UpdateSound(Win32SoundOutput *sound_output,
         {
             if (audio_voice->playing_sound->force_stop || audio_voice->voice_callback.is_completed)
             {
-                audio_voice->playing_sound->next = game_sound->first_free_playing_sound;
-                game_sound->first_free_playing_sound = audio_voice->playing_sound;
-
                 Assert(audio_voice->source_voice);
                 audio_voice->source_voice->Stop(0, XAUDIO2_COMMIT_NOW);
                 audio_voice->source_voice->FlushSourceBuffers();
+                audio_voice->playing_sound->is_finished = true;
                 audio_voice->playing_sound = 0;
                 audio_voice->voice_callback.is_completed = false;
             }
@@ -777,6 +778,7 @@ int CALLBACK WinMain(HINSTANCE instance,
                 LARGE_INTEGER last_time_counter = Win32GetTimeCounter();
                 LARGE_INTEGER flip_time_counter = Win32GetTimeCounter();
                 time.delta_time = target_seconds_per_frame; // NOTE(mara): Intentionally fixed.
+                time.render_blend = 1.0; // Rendered once after every update, so never blended.
 
                 Win32GameCode game = Win32LoadGameCode(source_game_code_dll_full_path,
                                                        temp_game_code_dll_full_path);
@@ -921,9 +923,14 @@ int CALLBACK WinMain(HINSTANCE instance,
 
                         GameSoundOutput game_sound = {};
 
-                        if (game.UpdateAndRender)
+                        if (game.Update)
+                        {
+                            game.Update(&game_memory, &time, new_input, &offscreen_buffer, &game_sound);
+                        }
+
+                        if (game.Render)
                         {
-                            game.UpdateAndRender(&game_memory, &time, new_input, &offscreen_buffer, &game_sound);
+                            game.Render(&game_memory, &time, &offscreen_buffer);
                         }
 
                         Win32UpdateSound(&sound_output, &xaudio2_container, &game_sound);
@@ -71,7 +71,8 @@ struct Win32GameCode
 
     // Function Pointers
     // IMPORTANT(mara): These could be 0! You have to check before calling them.
-    GameUpdateAndRenderFunc *UpdateAndRender;
+    GameUpdateFunc *Update;
+    GameRenderFunc *Render;
 
     bool32 is_valid;
 };